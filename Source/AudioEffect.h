@@ -1,23 +1,175 @@
 #pragma once
 #include <juce_dsp/juce_dsp.h>
 #include <juce_data_structures/juce_data_structures.h>
+#include <limits>
 
 /**
- * Base class for all modular effects.
+ * A parameter modulation can drive, resolved from its preset key once when
+ * the preset is built: the effect's own index for it, handed back to
+ * setModulatedParameter(), and the range the effect accepts. Routes are
+ * clamped to the range.
  */
-class AudioEffect
+struct ModulationTarget
+{
+    int index = -1;
+    float minValue = std::numeric_limits<float>::lowest();
+    float maxValue = std::numeric_limits<float>::max();
+
+    bool isValid() const { return index >= 0; }
+};
+
+/**
+ * A modulated value gliding linearly to each control value over the slice it
+ * was sent for. Processors that only take a parameter between calls run the
+ * slice in chunks of controlChunk samples and move the parameter at each one
+ * (see AudioEffectBase::processInChunks()).
+ */
+class ParameterRamp
+{
+public:
+    static constexpr int controlChunk = 32;
+
+    void setValue(float newValue)
+    {
+        current = target = newValue;
+        remaining = 0;
+    }
+
+    void glideTo(float newTarget, int numSamples)
+    {
+        if (numSamples <= 0)
+        {
+            setValue(newTarget);
+            return;
+        }
+
+        target = newTarget;
+        step = (target - current) / (float) numSamples;
+        remaining = numSamples;
+    }
+
+    bool isGliding() const { return remaining > 0; }
+    float getValue() const { return current; }
+
+    // Moves numSamples along the ramp and returns the value there
+    float advance(int numSamples)
+    {
+        if (numSamples >= remaining)
+        {
+            current = target;
+            remaining = 0;
+        }
+        else
+        {
+            current += step * (float) numSamples;
+            remaining -= numSamples;
+        }
+
+        return current;
+    }
+
+private:
+    float current = 0.0f, target = 0.0f, step = 0.0f;
+    int remaining = 0;
+};
+
+/**
+ * Base class for all modular effects, templated on the sample type they process.
+ */
+template <typename SampleType>
+class AudioEffectBase
 {
 public:
-    virtual ~AudioEffect() = default;
+    virtual ~AudioEffectBase() = default;
 
     virtual void prepare(const juce::dsp::ProcessSpec& spec) = 0;
-    virtual void process(const juce::dsp::ProcessContextReplacing<float>& context) = 0;
+    virtual void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) = 0;
     virtual void reset() = 0;
 
     // Configure from JUCE ValueTree
     virtual void configure(const juce::ValueTree& config) = 0;
 
+    // Why the configuration can't play, e.g. a missing file, or empty when it
+    // can. Checked after configure() when a preset is built; a message fails
+    // the load.
+    virtual juce::String getConfigurationError() const { return {}; }
+
+    // How many samples the output lags the input, once prepared. The chain
+    // delays parallel paths to match and reports the total to the host.
+    virtual int getLatencySamples() const { return 0; }
+
+    // Widest block the effect can handle (0 = any). On wider buses the chain
+    // runs one instance per group of this many channels.
+    virtual int getMaximumChannels() const { return 0; }
+
+    // Sidechain ("key: sidechain"): effects that want it are handed the current
+    // slice of the sidechain bus before each process() call. The block is empty
+    // when the host hasn't connected one.
+    virtual bool wantsSidechain() const { return false; }
+    virtual void setSidechain(const juce::dsp::AudioBlock<const SampleType>& key) { juce::ignoreUnused(key); }
+
+    // Modulation. When the preset is built, each "mod:" key is resolved to a
+    // target; an invalid one (the default) fails the build. Then, on the audio
+    // thread before each slice, setModulatedParameter() is handed the target's
+    // index and the value to glide to, linearly, over the rampSamples of the
+    // slice. It must not allocate or lock.
+    virtual ModulationTarget getModulationTarget(const juce::Identifier& id) const
+    {
+        juce::ignoreUnused(id);
+        return {};
+    }
+
+    virtual void setModulatedParameter(int index, float value, int rampSamples)
+    {
+        juce::ignoreUnused(index, value, rampSamples);
+    }
+
 protected:
+    // Runs process() over the context in chunks of ParameterRamp::controlChunk
+    // samples while gliding, calling update(numSamples) before each so it can
+    // advance its ramps; otherwise in one go
+    template <typename Update, typename Process>
+    static void processInChunks(const juce::dsp::ProcessContextReplacing<SampleType>& context, bool gliding,
+                                Update&& update, Process&& process)
+    {
+        if (!gliding)
+        {
+            process(context);
+            return;
+        }
+
+        auto& block = context.getOutputBlock();
+        const auto numSamples = (int) block.getNumSamples();
+
+        for (int start = 0; start < numSamples; start += ParameterRamp::controlChunk)
+        {
+            const auto length = juce::jmin(ParameterRamp::controlChunk, numSamples - start);
+            update(length);
+
+            auto chunk = block.getSubBlock((size_t) start, (size_t) length);
+            juce::dsp::ProcessContextReplacing<SampleType> chunkContext(chunk);
+            chunkContext.isBypassed = context.isBypassed;
+            process(chunkContext);
+        }
+    }
+
+    // Has a juce::SmoothedValue glide from where it is to value over exactly
+    // numSamples; reset() on its own would jump to the old target first
+    template <typename Smoothed>
+    static void glideTo(Smoothed& smoothed, float value, int numSamples)
+    {
+        if (numSamples <= 0)
+        {
+            smoothed.setCurrentAndTargetValue(value);
+            return;
+        }
+
+        const auto current = smoothed.getCurrentValue();
+        smoothed.reset(numSamples);
+        smoothed.setCurrentAndTargetValue(current);
+        smoothed.setTargetValue(value);
+    }
+
     // Helper to extract a float value whether it's a direct property or a nested "value" property
     static float getParameterValue(const juce::ValueTree& config, const juce::Identifier& id, float defaultValue = 0.0f)
     {
@@ -37,3 +189,6 @@ protected:
         return defaultValue;
     }
 };
+
+// Single-precision effects (e.g. Reverb, Convolution) derive from this directly
+using AudioEffect = AudioEffectBase<float>;
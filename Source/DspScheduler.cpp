@@ -0,0 +1,233 @@
+#include "DspScheduler.h"
+
+#if JUCE_LINUX || JUCE_BSD
+ #include <semaphore.h>
+ #include <cerrno>
+#elif JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+#endif
+
+namespace
+{
+    // One worker per spare physical core, up to this many
+    constexpr int maxWorkers = 8;
+
+    // Work due sooner than this goes in the urgent lane
+    constexpr double urgentSlackSeconds = 0.001;
+
+    // How long an idle worker keeps polling before it sleeps. Long enough to
+    // catch the next task of a block in progress, short enough not to burn a
+    // core between blocks.
+    constexpr double spinSeconds = 0.0002;
+}
+
+// A counting semaphore. Posting must not take a lock, since the audio thread
+// posts when it submits work: juce::WaitableEvent locks a mutex, the
+// platform semaphores don't.
+class DspScheduler::WakeSignal
+{
+public:
+   #if JUCE_LINUX || JUCE_BSD
+    WakeSignal()  { sem_init(&semaphore, 0, 0); }
+    ~WakeSignal() { sem_destroy(&semaphore); }
+
+    void post() { sem_post(&semaphore); }
+    void wait() { while (sem_wait(&semaphore) != 0 && errno == EINTR) {} }
+
+   private:
+    sem_t semaphore;
+   #elif JUCE_MAC || JUCE_IOS
+    WakeSignal()  : semaphore(dispatch_semaphore_create(0)) {}
+    ~WakeSignal() { dispatch_release(semaphore); }
+
+    void post() { dispatch_semaphore_signal(semaphore); }
+    void wait() { dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER); }
+
+   private:
+    dispatch_semaphore_t semaphore;
+   #elif JUCE_WINDOWS
+    WakeSignal()  : semaphore(CreateSemaphoreW(nullptr, 0, 0x7fffffff, nullptr)) {}
+    ~WakeSignal() { CloseHandle(semaphore); }
+
+    void post() { ReleaseSemaphore(semaphore, 1, nullptr); }
+    void wait() { WaitForSingleObject(semaphore, INFINITE); }
+
+   private:
+    HANDLE semaphore;
+   #else
+    void post() { event.signal(); }
+    void wait() { event.wait(); }
+
+   private:
+    juce::WaitableEvent event;
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE(WakeSignal)
+};
+
+class DspScheduler::Worker : public juce::Thread
+{
+public:
+    Worker(DspScheduler& o, size_t queueIndex)
+        : juce::Thread("DSP Worker " + juce::String((int) queueIndex + 1)), owner(o), index(queueIndex) {}
+
+    void run() override
+    {
+        // The host's denormal handling only applies to its own audio thread
+        juce::ScopedNoDenormals noDenormals;
+
+        const auto spinTicks = juce::Time::secondsToHighResolutionTicks(spinSeconds);
+        auto idleSince = juce::Time::getHighResolutionTicks();
+
+        while (!owner.stopping.load(std::memory_order_acquire))
+        {
+            if (runAny())
+            {
+                idleSince = juce::Time::getHighResolutionTicks();
+                continue;
+            }
+
+            if (juce::Time::getHighResolutionTicks() - idleSince < spinTicks)
+            {
+                juce::Thread::yield();
+                continue;
+            }
+
+            // Announce the sleep before the last look at the queues, so a
+            // task submitted in between either is seen here or posts a wake-up
+            owner.sleepers.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            const auto ranTask = !owner.stopping.load() && runAny();
+            if (!ranTask && !owner.stopping.load())
+                owner.wakeSignal->wait();
+
+            owner.sleepers.fetch_sub(1);
+            idleSince = juce::Time::getHighResolutionTicks();
+        }
+    }
+
+private:
+    bool runAny() { return owner.runOne(urgent, index) || owner.runOne(relaxed, index); }
+
+    DspScheduler& owner;
+    const size_t index;
+};
+
+DspScheduler::DspScheduler()
+    : wakeSignal(std::make_unique<WakeSignal>())
+{
+    const auto numWorkers = juce::jlimit(0, maxWorkers, juce::SystemStats::getNumPhysicalCpus() - 1);
+
+    for (int i = 0; i < numWorkers; ++i)
+        queues.push_back(std::make_unique<WorkerQueues>());
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        workers.push_back(std::make_unique<Worker>(*this, (size_t) i));
+
+        // Realtime scheduling can be refused (e.g. no rtprio limit on Linux)
+        if (!workers.back()->startRealtimeThread(juce::Thread::RealtimeOptions{}.withPriority(10)))
+            workers.back()->startThread(juce::Thread::Priority::highest);
+    }
+}
+
+DspScheduler::~DspScheduler()
+{
+    stopping.store(true, std::memory_order_release);
+
+    for (auto& worker : workers)
+        worker->signalThreadShouldExit();
+
+    for (size_t i = 0; i < workers.size(); ++i)
+        wakeSignal->post();
+
+    for (auto& worker : workers)
+        worker->stopThread(2000);
+
+    // The queues are empty here: every holder waits for its own tasks before
+    // letting go of the scheduler
+}
+
+bool DspScheduler::submit(const Task& task)
+{
+    const auto numQueues = queues.size();
+
+    if (numQueues > 0)
+    {
+        const auto slack = task.deadline - juce::Time::getHighResolutionTicks();
+        const auto lane = (task.batch != nullptr || slack < juce::Time::secondsToHighResolutionTicks(urgentSlackSeconds)) ? urgent : relaxed;
+
+        if (task.batch != nullptr)
+            task.batch->pending.fetch_add(1, std::memory_order_relaxed);
+
+        const auto first = nextQueue.fetch_add(1, std::memory_order_relaxed);
+
+        for (size_t i = 0; i < numQueues; ++i)
+        {
+            if (queues[(first + i) % numQueues]->lanes[(size_t) lane].push(task))
+            {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                if (sleepers.load() > 0)
+                    wakeSignal->post();
+
+                return true;
+            }
+        }
+
+        if (task.batch != nullptr)
+            task.batch->pending.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    tasksRejected.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void DspScheduler::wait(Batch& batch)
+{
+    // Only urgent work is taken here: relaxed tasks can run for a whole
+    // partition period, which the waiting thread doesn't have
+    const auto first = nextQueue.load(std::memory_order_relaxed);
+
+    while (batch.pending.load(std::memory_order_acquire) > 0)
+        if (!runOne(urgent, first))
+            juce::Thread::yield();
+}
+
+bool DspScheduler::runOne(Lane lane, size_t first)
+{
+    const auto numQueues = queues.size();
+    Task task;
+
+    for (size_t i = 0; i < numQueues; ++i)
+    {
+        if (queues[(first + i) % numQueues]->lanes[(size_t) lane].pop(task))
+        {
+            execute(task);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void DspScheduler::execute(const Task& task)
+{
+    task.run(task.context);
+
+    tasksRun.fetch_add(1, std::memory_order_relaxed);
+    if (task.deadline != 0 && juce::Time::getHighResolutionTicks() > task.deadline)
+        tasksLate.fetch_add(1, std::memory_order_relaxed);
+
+    // Last: the waiter may return and destroy the batch straight away
+    if (task.batch != nullptr)
+        task.batch->pending.fetch_sub(1, std::memory_order_release);
+}
+
+DspScheduler::Stats DspScheduler::getStats() const
+{
+    return { tasksRun.load(), tasksLate.load(), tasksRejected.load() };
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/**
+ * A fixed pool of realtime-priority worker threads shared by every EffectChain
+ * in the process, so the number of DSP threads stays the same however many
+ * plugin instances are loaded.
+ *
+ * Hold it through juce::SharedResourcePointer<DspScheduler>: the workers start
+ * with the first holder and stop with the last, so they never outlive the
+ * plugin binary.
+ *
+ * Work is submitted as plain Tasks (a function pointer, a context and a
+ * deadline hint). Submitting never allocates, locks or blocks. Each worker
+ * has its own queues, and a worker whose queues are empty steals from the
+ * others. Each queue has two lanes. Work that a thread is waiting on, or
+ * that is due within a millisecond, goes in the urgent lane. Everything else
+ * goes in the relaxed lane. No worker takes relaxed work while urgent work is
+ * queued anywhere.
+ */
+class DspScheduler
+{
+public:
+    // Lets the submitting thread wait for a set of tasks, helping to run
+    // urgent work while it does
+    struct Batch
+    {
+        std::atomic<int> pending { 0 };
+    };
+
+    struct Task
+    {
+        void (*run)(void* context) = nullptr;
+        void* context = nullptr;
+        juce::int64 deadline = 0;       // juce::Time::getHighResolutionTicks()
+        Batch* batch = nullptr;         // counted down when the task has run
+    };
+
+    struct Stats
+    {
+        juce::uint64 tasksRun = 0;
+        juce::uint64 tasksLate = 0;     // finished after their deadline
+        juce::uint64 tasksRejected = 0; // queues full; the caller ran them
+    };
+
+    DspScheduler();
+    ~DspScheduler();
+
+    int getNumWorkers() const { return (int) workers.size(); }
+
+    // Queues a task. Returns false if there are no workers or every queue is
+    // full, in which case the caller should run it itself. Any thread.
+    bool submit(const Task& task);
+
+    // Runs urgent tasks on this thread until every task of the batch is done
+    void wait(Batch& batch);
+
+    Stats getStats() const;
+
+    static juce::int64 deadlineAfter(double seconds)
+    {
+        return juce::Time::getHighResolutionTicks() + juce::Time::secondsToHighResolutionTicks(seconds);
+    }
+
+private:
+    // Bounded multi-producer, multi-consumer ring (Vyukov): lock-free, and
+    // never allocates after construction
+    class TaskQueue
+    {
+    public:
+        static constexpr size_t capacity = 256;
+
+        TaskQueue()
+        {
+            for (size_t i = 0; i < capacity; ++i)
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        bool push(const Task& task)
+        {
+            auto pos = enqueuePos.load(std::memory_order_relaxed);
+
+            for (;;)
+            {
+                auto& cell = cells[pos & mask];
+                const auto seq = cell.sequence.load(std::memory_order_acquire);
+                const auto diff = (std::intptr_t) seq - (std::intptr_t) pos;
+
+                if (diff == 0)
+                {
+                    if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        cell.task = task;
+                        cell.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool pop(Task& task)
+        {
+            auto pos = dequeuePos.load(std::memory_order_relaxed);
+
+            for (;;)
+            {
+                auto& cell = cells[pos & mask];
+                const auto seq = cell.sequence.load(std::memory_order_acquire);
+                const auto diff = (std::intptr_t) seq - (std::intptr_t) (pos + 1);
+
+                if (diff == 0)
+                {
+                    if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        task = cell.task;
+                        cell.sequence.store(pos + capacity, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = dequeuePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+    private:
+        static constexpr size_t mask = capacity - 1;
+
+        struct Cell
+        {
+            std::atomic<size_t> sequence { 0 };
+            Task task;
+        };
+
+        std::array<Cell, capacity> cells;
+        alignas(64) std::atomic<size_t> enqueuePos { 0 };
+        alignas(64) std::atomic<size_t> dequeuePos { 0 };
+    };
+
+    enum Lane { urgent, relaxed, numLanes };
+
+    struct WorkerQueues
+    {
+        std::array<TaskQueue, numLanes> lanes;
+    };
+
+    class Worker;
+    class WakeSignal;
+
+    // Takes one task from `lane`, starting with queue `first` and stealing
+    // round the others; runs it if found
+    bool runOne(Lane lane, size_t first);
+    void execute(const Task& task);
+
+    std::vector<std::unique_ptr<WorkerQueues>> queues;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::unique_ptr<WakeSignal> wakeSignal;
+
+    std::atomic<int> sleepers { 0 };
+    std::atomic<size_t> nextQueue { 0 };
+    std::atomic<bool> stopping { false };
+
+    std::atomic<juce::uint64> tasksRun { 0 }, tasksLate { 0 }, tasksRejected { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(DspScheduler)
+};
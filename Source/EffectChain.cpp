@@ -11,7 +11,13 @@
 #include "Effects/NoiseGateEffect.h"
 #include "Effects/LadderFilterEffect.h"
 #include "Effects/PannerEffect.h"
+#include "Effects/ConvolutionEffect.h"
+#include "SharedResourceCache.h"
+#include "PresetAnalyzer.h"
+#include "Modulation.h"
+#include "RealtimeCheck.h"
 #include <yaml-cpp/yaml.h>
+#include <map>
 
 // ============================
 // Internal Node Graph Types
@@ -22,287 +28,2240 @@ struct EffectChain::Node
     virtual ~Node() = default;
     virtual void prepare(const juce::dsp::ProcessSpec& spec) = 0;
     virtual void process(juce::AudioBuffer<float>& buffer) = 0;
+    virtual void process(juce::AudioBuffer<double>& buffer) = 0;
     virtual void reset() = 0;
+
+    // Samples the output lags the input by, once prepared
+    virtual int getLatencySamples() const { return 0; }
+};
+
+// A built node tree plus how it is driven. Published to the audio thread as a
+// whole, so processing settings always match how the nodes were prepared.
+struct EffectChain::Graph
+{
+    // Host blocks longer than this are run through the whole graph in slices of
+    // this many samples, so each effect's state stays in cache across the
+    // graph; 0 processes host blocks whole.
+    int subBlockSize = 0;
+
+    std::unique_ptr<Node> root;
+
+    // The number each effect was built with ("Delay #3"), by the child index
+    // path of its node in the preset; nodes that built no effect are missing
+    std::map<std::vector<int>, int> effectNumbers;
+
+    // Modulation matrix. Sources live here; the nodes that feed envelope
+    // followers only hold pointers to them.
+    std::vector<std::unique_ptr<Modulator>> modulators;
+    std::vector<ModulationRoute> routes;
+
+    // The host's sidechain bus for the slice being processed, in the host's
+    // precision (the other block is empty). Read-only; nodes with a key read it.
+    struct Sidechain
+    {
+        juce::dsp::AudioBlock<const float> floatKey;
+        juce::dsp::AudioBlock<const double> doubleKey;
+
+        void set(const juce::dsp::AudioBlock<const float>& key)  { floatKey = key; doubleKey = {}; }
+        void set(const juce::dsp::AudioBlock<const double>& key) { doubleKey = key; floatKey = {}; }
+    };
+
+    Sidechain sidechain;
+
+    // A named bus ("type: Bus"). Its chain runs after the main chain on the
+    // sum of everything sent to it, and the result is mixed into the main
+    // output or into another bus ("output: <name>").
+    struct Bus
+    {
+        juce::String name;
+        std::unique_ptr<Node> chain;
+        float returnGain = 1.0f;
+        Bus* output = nullptr;      // nullptr: the main output
+        int slot = 0;               // input buffer in the pool
+    };
+
+    // Bus input buffers, in the graph's precision. Buses that are never fed
+    // at the same time within a slice share a buffer.
+    struct BusPool
+    {
+        Precision precision = Precision::Single;
+        int numSlots = 0;
+        std::vector<juce::AudioBuffer<float>> floatBuffers;
+        std::vector<juce::AudioBuffer<double>> doubleBuffers;
+
+        void prepare(const juce::dsp::ProcessSpec& spec)
+        {
+            const auto numChannels = static_cast<int>(spec.numChannels);
+            const auto maxBlock = static_cast<int>(spec.maximumBlockSize);
+
+            floatBuffers.clear();
+            doubleBuffers.clear();
+
+            for (int i = 0; i < numSlots; ++i)
+            {
+                if (precision == Precision::Double)
+                    doubleBuffers.emplace_back(numChannels, maxBlock);
+                else
+                    floatBuffers.emplace_back(numChannels, maxBlock);
+            }
+
+            clear();
+        }
+
+        void clear()
+        {
+            for (auto& b : floatBuffers)  b.clear();
+            for (auto& b : doubleBuffers) b.clear();
+        }
+
+        template <typename SampleType>
+        void add(int slot, const juce::AudioBuffer<SampleType>& source, float gain)
+        {
+            if (precision == Precision::Double)
+                mix(doubleBuffers[(size_t) slot], source, gain);
+            else
+                mix(floatBuffers[(size_t) slot], source, gain);
+        }
+
+        // dest += gain * source over the channels and samples they share
+        template <typename Dest, typename Source>
+        static void mix(juce::AudioBuffer<Dest>& dest, const juce::AudioBuffer<Source>& source, float gain)
+        {
+            const int numChannels = juce::jmin(dest.getNumChannels(), source.getNumChannels());
+            const int numSamples  = juce::jmin(dest.getNumSamples(), source.getNumSamples());
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                auto* dst = dest.getWritePointer(ch);
+                const auto* src = source.getReadPointer(ch);
+
+                if constexpr (std::is_same<Dest, Source>::value)
+                {
+                    juce::FloatVectorOperations::addWithMultiply(dst, src, (Dest) gain, numSamples);
+                }
+                else
+                {
+                    for (int i = 0; i < numSamples; ++i)
+                        dst[i] += static_cast<Dest>(src[i]) * (Dest) gain;
+                }
+            }
+        }
+    };
+
+    // In execution order: every bus comes after the buses that feed it
+    std::vector<std::unique_ptr<Bus>> buses;
+    BusPool busPool;
+
+    // Preset switching. A graph that replaced another one under a crossfade
+    // keeps the old graph running, with its input fading out, until the fade is
+    // over and the old tail has died away, but never for longer than maxLength.
+    // Only the message thread releases the old graph, once "finished" is set.
+    struct Transition
+    {
+        std::shared_ptr<Graph> previous;
+        int fadeLength = 0;
+        int maxLength = 0;
+        int position = 0;
+
+        std::atomic<bool> finished { false };
+        std::atomic<bool> cutRequested { false };   // set when another switch replaces this graph
+
+        juce::AudioBuffer<float> floatInput, floatView;
+        juce::AudioBuffer<double> doubleInput, doubleView;
+    };
+
+    Transition transition;
+    Precision precision = Precision::Single;
+
+    // Message thread only: when releaseRetiredGraphs() first found it unused
+    bool retiring = false;
+    juce::uint32 retiredAtEpoch = 0;
+
+    // Set when a program switch takes it off the air. Its slot stops offering
+    // it to the audio thread until releaseRetiredGraphs() has cleared it on
+    // the message thread; resetAtEpoch works like retiredAtEpoch.
+    std::atomic<bool> needsReset { false };
+    bool resetPending = false;
+    juce::uint32 resetAtEpoch = 0;
+    juce::dsp::ProcessSpec preparedSpec { 0.0, 0, 0 };
+
+    // Of the main chain, as reported to the host; set by prepare()
+    int latencySamples = 0;
+
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        preparedSpec = spec;
+
+        // With modulation, the graph is also sliced at the control rate
+        sliceSize = subBlockSize;
+
+        if (!routes.empty())
+        {
+            double controlRate = 0.0;
+            for (const auto& m : modulators)
+                controlRate = juce::jmax(controlRate, m->getControlRate());
+
+            const auto controlPeriod = juce::jmax(1, juce::roundToInt(spec.sampleRate / controlRate));
+            sliceSize = sliceSize > 0 ? juce::jmin(sliceSize, controlPeriod) : controlPeriod;
+        }
+
+        auto nodeSpec = spec;
+        if (sliceSize > 0)
+            nodeSpec.maximumBlockSize = juce::jmin(spec.maximumBlockSize, static_cast<juce::uint32>(sliceSize));
+
+        root->prepare(nodeSpec);
+        latencySamples = root->getLatencySamples();
+
+        busPool.prepare(nodeSpec);
+        for (auto& bus : buses)
+            bus->chain->prepare(nodeSpec);
+    }
+
+    // The old graph runs whole host blocks on a copy of the input
+    void prepareTransition(const juce::dsp::ProcessSpec& spec)
+    {
+        const auto numChannels = static_cast<int>(spec.numChannels);
+        const auto maxBlock = static_cast<int>(spec.maximumBlockSize);
+
+        if (precision == Precision::Double)
+            transition.doubleInput.setSize(numChannels, maxBlock);
+        else
+            transition.floatInput.setSize(numChannels, maxBlock);
+    }
+
+    void process(juce::AudioBuffer<float>& buffer, const juce::dsp::AudioBlock<const float>& key)
+    {
+        if (isTransitioning())
+            processTransition(buffer, floatSlice, transition.floatInput, transition.floatView, key);
+        else
+            processSliced(buffer, floatSlice, key);
+    }
+
+    void process(juce::AudioBuffer<double>& buffer, const juce::dsp::AudioBlock<const double>& key)
+    {
+        if (isTransitioning())
+            processTransition(buffer, doubleSlice, transition.doubleInput, transition.doubleView, key);
+        else
+            processSliced(buffer, doubleSlice, key);
+    }
+
+    bool isTransitioning() const
+    {
+        return !transition.finished.load(std::memory_order_acquire) && transition.previous != nullptr;
+    }
+
+    void reset()
+    {
+        root->reset();
+
+        for (auto& bus : buses)
+            bus->chain->reset();
+        busPool.clear();
+
+        for (auto& m : modulators)
+            m->reset();
+    }
+
+    // Once per slice: move the sources to the end of the slice and have every
+    // routed parameter glide there over the slice
+    void updateModulation(int numSamples)
+    {
+        if (routes.empty())
+            return;
+
+        for (auto& m : modulators)
+            m->advance(numSamples);
+
+        for (const auto& route : routes)
+            route.update(numSamples);
+    }
+
+    template <typename SampleType>
+    void processSliced(juce::AudioBuffer<SampleType>& buffer, juce::AudioBuffer<SampleType>& slice,
+                       const juce::dsp::AudioBlock<const SampleType>& key)
+    {
+        const int numSamples = buffer.getNumSamples();
+
+        if (sliceSize <= 0 || numSamples <= sliceSize)
+        {
+            updateModulation(numSamples);
+            sidechain.set(key);
+            root->process(buffer);
+            processBuses(buffer);
+            return;
+        }
+
+        for (int start = 0; start < numSamples; start += sliceSize)
+        {
+            const auto length = juce::jmin(sliceSize, numSamples - start);
+
+            updateModulation(length);
+            sidechain.set(getKeySlice(key, start, length));
+            slice.setDataToReferTo(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, length);
+            root->process(slice);
+            processBuses(slice);
+        }
+
+        sidechain = {};
+    }
+
+    template <typename SampleType>
+    void processBuses(juce::AudioBuffer<SampleType>& output)
+    {
+        if (buses.empty())
+            return;
+
+        if (busPool.precision == Precision::Double)
+            processBuses(output, busPool.doubleBuffers, doubleBusView);
+        else
+            processBuses(output, busPool.floatBuffers, floatBusView);
+    }
+
+    // Each bus runs in place on its input, hands the result on, and leaves its
+    // buffer cleared for whichever bus uses the slot next
+    template <typename SampleType, typename BusType>
+    void processBuses(juce::AudioBuffer<SampleType>& output, std::vector<juce::AudioBuffer<BusType>>& inputs,
+                      juce::AudioBuffer<BusType>& view)
+    {
+        for (auto& bus : buses)
+        {
+            auto& input = inputs[(size_t) bus->slot];
+            view.setDataToReferTo(input.getArrayOfWritePointers(), input.getNumChannels(),
+                                  juce::jmin(output.getNumSamples(), input.getNumSamples()));
+
+            bus->chain->process(view);
+
+            if (bus->output != nullptr)
+                BusPool::mix(inputs[(size_t) bus->output->slot], view, bus->returnGain);
+            else
+                BusPool::mix(output, view, bus->returnGain);
+
+            view.clear();
+        }
+    }
+
+    // Runs the old graph on a fading copy of the input next to this one, and
+    // crossfades the outputs (linear, so a shared dry path sums to unity)
+    template <typename SampleType>
+    void processTransition(juce::AudioBuffer<SampleType>& buffer, juce::AudioBuffer<SampleType>& slice,
+                           juce::AudioBuffer<SampleType>& oldInput, juce::AudioBuffer<SampleType>& oldView,
+                           const juce::dsp::AudioBlock<const SampleType>& key)
+    {
+        auto& t = transition;
+
+        // Never more than two graphs at once: a newer switch cuts this one's predecessor
+        if (t.cutRequested.load(std::memory_order_relaxed))
+        {
+            t.finished.store(true, std::memory_order_release);
+            processSliced(buffer, slice, key);
+            return;
+        }
+
+        const int numChannels = juce::jmin(buffer.getNumChannels(), oldInput.getNumChannels());
+        const int numSamples  = juce::jmin(buffer.getNumSamples(), oldInput.getNumSamples());
+        const auto fadeLength = static_cast<float>(t.fadeLength);
+
+        auto fadeIn = [&](int i) { return juce::jmin(1.0f, static_cast<float>(t.position + i) / fadeLength); };
+        auto oldOutputGain = [&](int i) { return juce::jlimit(0.0f, 1.0f, static_cast<float>(t.maxLength - t.position - i) / fadeLength); };
+
+        oldView.setDataToReferTo(oldInput.getArrayOfWritePointers(), numChannels, numSamples);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto* in = buffer.getReadPointer(ch);
+            auto* out = oldView.getWritePointer(ch);
+
+            for (int i = 0; i < numSamples; ++i)
+                out[i] = in[i] * static_cast<SampleType>(1.0f - fadeIn(i));
+        }
+
+        t.previous->process(oldView, key);
+        processSliced(buffer, slice, key);
+
+        SampleType tailPeak = 0;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* out = buffer.getWritePointer(ch);
+            const auto* old = oldView.getReadPointer(ch);
+
+            for (int i = 0; i < numSamples; ++i)
+                out[i] = out[i] * static_cast<SampleType>(fadeIn(i)) + old[i] * static_cast<SampleType>(oldOutputGain(i));
+
+            tailPeak = juce::jmax(tailPeak, oldView.getMagnitude(ch, 0, numSamples));
+        }
+
+        t.position += numSamples;
+
+        if ((t.position >= t.fadeLength && tailPeak < static_cast<SampleType>(tailSilenceThreshold))
+            || t.position >= t.maxLength)
+            t.finished.store(true, std::memory_order_release);
+    }
+
+    // About -90 dBFS
+    static constexpr double tailSilenceThreshold = 3.0e-5;
+
+    template <typename SampleType>
+    static juce::dsp::AudioBlock<const SampleType> getKeySlice(const juce::dsp::AudioBlock<const SampleType>& key, int start, int length)
+    {
+        if (key.getNumChannels() == 0 || (size_t) start >= key.getNumSamples())
+            return {};
+
+        return key.getSubBlock((size_t) start, juce::jmin((size_t) length, key.getNumSamples() - (size_t) start));
+    }
+
+    int sliceSize = 0;
+    juce::AudioBuffer<float> floatSlice;
+    juce::AudioBuffer<double> doubleSlice;
+    juce::AudioBuffer<float> floatBusView;
+    juce::AudioBuffer<double> doubleBusView;
+};
+
+// A parsed preset is immutable, so identical sources share one ValueTree
+// across every chain in the process.
+struct EffectChain::ParsedPreset
+{
+    juce::ValueTree tree;
+    juce::String error;
 };
 
 namespace {
     using NodePtr = std::unique_ptr<EffectChain::Node>;
 
-    struct EffectNode : public EffectChain::Node
+    using Precision = EffectChain::Precision;
+
+    template <typename SampleType>
+    constexpr Precision precisionOf() { return std::is_same<SampleType, double>::value ? Precision::Double : Precision::Single; }
+
+    // Scratch space for running a node in its own precision inside a graph of
+    // the other precision. Conversions only ever happen here, at node boundaries.
+    template <typename SampleType>
+    struct PrecisionBoundary
     {
-        explicit EffectNode(std::unique_ptr<AudioEffect> e)
-            : effect(std::move(e)) {}
+        void prepare(const juce::dsp::ProcessSpec& spec)
+        {
+            scratch.setSize(static_cast<int>(spec.numChannels), static_cast<int>(spec.maximumBlockSize));
+        }
 
-        void prepare(const juce::dsp::ProcessSpec& spec) override
+        template <typename HostType>
+        juce::AudioBuffer<SampleType>& enter(const juce::AudioBuffer<HostType>& host)
         {
-            if (effect)
-                effect->prepare(spec);
+            const int numChannels = juce::jmin(host.getNumChannels(), scratch.getNumChannels());
+            const int numSamples  = juce::jmin(host.getNumSamples(), scratch.getNumSamples());
+
+            view.setDataToReferTo(scratch.getArrayOfWritePointers(), numChannels, numSamples);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                convert(host.getReadPointer(ch), view.getWritePointer(ch), numSamples);
+
+            return view;
         }
 
-        void process(juce::AudioBuffer<float>& buffer) override
+        template <typename HostType>
+        void exit(juce::AudioBuffer<HostType>& host)
         {
-            if (!effect)
-                return;
+            for (int ch = 0; ch < view.getNumChannels(); ++ch)
+                convert(view.getReadPointer(ch), host.getWritePointer(ch), view.getNumSamples());
+        }
 
-            juce::dsp::AudioBlock<float> block(buffer);
-            juce::dsp::ProcessContextReplacing<float> context(block);
-            effect->process(context);
+        template <typename Source, typename Dest>
+        static void convert(const Source* src, Dest* dst, int numSamples)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                dst[i] = static_cast<Dest>(src[i]);
         }
 
-        void reset() override
+        juce::AudioBuffer<SampleType> scratch;
+        juce::AudioBuffer<SampleType> view;
+    };
+
+    // A fixed delay that lines a path up with a parallel one that has more
+    // latency. Holds nothing when the delay is 0.
+    template <typename SampleType>
+    struct CompensationDelay
+    {
+        void prepare(int numChannels, int newDelay)
         {
-            if (effect)
-                effect->reset();
+            delay = juce::jmax(0, newDelay);
+            const auto size = delay > 0 ? juce::nextPowerOfTwo(delay + 1) : 0;
+
+            line.setSize(size > 0 ? numChannels : 0, size);
+            line.clear();
+            mask = size - 1;
+            writePosition = 0;
+        }
+
+        void reset()
+        {
+            line.clear();
+            writePosition = 0;
+        }
+
+        bool isActive() const { return delay > 0; }
+
+        // Delays one channel in place through line channel lineChannel; call
+        // advance() once every channel of the block is done
+        void process(SampleType* data, int lineChannel, int numSamples)
+        {
+            auto* l = line.getWritePointer(lineChannel);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto in = data[i];
+                data[i] = l[(writePosition - delay + i) & mask];
+                l[(writePosition + i) & mask] = in;
+            }
+        }
+
+        void process(juce::AudioBuffer<SampleType>& buffer)
+        {
+            const auto numChannels = juce::jmin(buffer.getNumChannels(), line.getNumChannels());
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                process(buffer.getWritePointer(ch), ch, buffer.getNumSamples());
+
+            advance(buffer.getNumSamples());
         }
 
-        std::unique_ptr<AudioEffect> effect;
+        void advance(int numSamples)
+        {
+            writePosition = (writePosition + numSamples) & mask;
+        }
+
+        int delay = 0;
+        int mask = 0;
+        int writePosition = 0;
+        juce::AudioBuffer<SampleType> line;
     };
 
-    struct GroupNode : public EffectChain::Node
+    // Common plumbing for nodes that run natively in one precision. Derived
+    // classes implement processNative(); buffers of the other precision are
+    // converted through the boundary, which is only allocated when the parent
+    // graph actually runs in the other precision.
+    template <typename SampleType, typename Derived>
+    struct PrecisionNode : public EffectChain::Node
     {
-        enum class Mode { Series, Parallel };
+        explicit PrecisionNode(Precision parent)
+            : convertsAtBoundary(parent != precisionOf<SampleType>()) {}
 
-        GroupNode() = default;
+        void process(juce::AudioBuffer<float>& buffer) override  { processBuffer(buffer); }
+        void process(juce::AudioBuffer<double>& buffer) override { processBuffer(buffer); }
+
+        void prepareBoundary(const juce::dsp::ProcessSpec& spec)
+        {
+            if (convertsAtBoundary)
+                boundary.prepare(spec);
+        }
+
+        template <typename HostType>
+        void processBuffer(juce::AudioBuffer<HostType>& buffer)
+        {
+            auto& self = static_cast<Derived&>(*this);
+
+            if constexpr (std::is_same<HostType, SampleType>::value)
+            {
+                self.processNative(buffer);
+            }
+            else
+            {
+                self.processNative(boundary.enter(buffer));
+                boundary.exit(buffer);
+            }
+        }
+
+        const bool convertsAtBoundary;
+        PrecisionBoundary<SampleType> boundary;
+    };
+
+    template <typename SampleType>
+    struct EffectNode : public PrecisionNode<SampleType, EffectNode<SampleType>>
+    {
+        EffectNode(std::unique_ptr<AudioEffectBase<SampleType>> e, Precision parent)
+            : PrecisionNode<SampleType, EffectNode<SampleType>>(parent), effect(std::move(e)) {}
 
         void prepare(const juce::dsp::ProcessSpec& spec) override
         {
-            processSpec = spec;
+            this->prepareBoundary(spec);
 
-            const auto numChannels = static_cast<int>(spec.numChannels);
-            const auto maxBlock = static_cast<int>(spec.maximumBlockSize);
+            quarantineLength = static_cast<int>(spec.sampleRate * 0.5);
+            quarantineRemaining = 0;
 
-            tempBuffer.setSize(numChannels, maxBlock);
-            mixBuffer.setSize(numChannels, maxBlock);
+            // Only a node that runs in the other precision than the host needs
+            // its own copy of the key
+            if (sidechain != nullptr && effect && effect->wantsSidechain() && this->convertsAtBoundary)
+                keyScratch.setSize(static_cast<int>(juce::jmax(2u, spec.numChannels)), static_cast<int>(spec.maximumBlockSize));
 
-            for (auto& child : children)
-                child->prepare(spec);
+            if (effect)
+                effect->prepare(spec);
         }
 
-        void process(juce::AudioBuffer<float>& buffer) override
+        void processNative(juce::AudioBuffer<SampleType>& buffer)
         {
-            const int passes = repeat > 0 ? repeat : 1;
+            if (!effect)
+                return;
 
-            if (mode == Mode::Series || children.empty())
+            // A quarantined node passes its input through until the cooldown ends
+            if (quarantineRemaining > 0)
             {
-                for (int pass = 0; pass < passes; ++pass)
-                    for (auto& child : children)
-                        child->process(buffer);
+                quarantineRemaining -= buffer.getNumSamples();
+                if (quarantineRemaining <= 0)
+                    effect->reset();
                 return;
             }
 
-            const int numChannels = buffer.getNumChannels();
-            const int numSamples  = buffer.getNumSamples();
+            if (sidechain != nullptr && effect->wantsSidechain())
+                effect->setSidechain(getKey(buffer.getNumSamples()));
 
-            mixBuffer.clear();
+            juce::dsp::AudioBlock<SampleType> block(buffer);
+            juce::dsp::ProcessContextReplacing<SampleType> context(block);
+            effect->process(context);
 
-            for (auto& child : children)
-            {
-                tempBuffer.makeCopyOf(buffer, true);
-                child->process(tempBuffer);
+            if (sentinel != nullptr && sentinel->isEnabled())
+                checkOutput(buffer);
+        }
 
-                for (int ch = 0; ch < numChannels; ++ch)
-                    mixBuffer.addFrom(ch, 0, tempBuffer, ch, 0, numSamples);
-            }
+        // The sidechain in this node's precision; converted only when the graph
+        // around it runs in the other one
+        juce::dsp::AudioBlock<const SampleType> getKey(int numSamples)
+        {
+            const auto& native = getNativeKey(*sidechain);
+            if (native.getNumChannels() > 0 || keyScratch.getNumChannels() == 0)
+                return native;
+
+            const auto& other = getOtherKey(*sidechain);
+            const auto numChannels = juce::jmin((int) other.getNumChannels(), keyScratch.getNumChannels());
+            const auto length = juce::jmin(numSamples, (int) other.getNumSamples(), keyScratch.getNumSamples());
+            if (numChannels == 0)
+                return {};
 
             for (int ch = 0; ch < numChannels; ++ch)
-                buffer.copyFrom(ch, 0, mixBuffer, ch, 0, numSamples);
+                PrecisionBoundary<SampleType>::convert(other.getChannelPointer((size_t) ch), keyScratch.getWritePointer(ch), length);
 
-            // Additional passes just re-process the mixed signal
-            for (int pass = 1; pass < passes; ++pass)
-            {
-                for (auto& child : children)
-                {
-                    tempBuffer.makeCopyOf(buffer, true);
-                    child->process(tempBuffer);
+            return juce::dsp::AudioBlock<SampleType>(keyScratch).getSubsetChannelBlock(0, (size_t) numChannels)
+                                                                .getSubBlock(0, (size_t) length);
+        }
 
-                    for (int ch = 0; ch < numChannels; ++ch)
-                        mixBuffer.addFrom(ch, 0, tempBuffer, ch, 0, numSamples);
-                }
+        static const juce::dsp::AudioBlock<const SampleType>& getNativeKey(const EffectChain::Graph::Sidechain& key)
+        {
+            if constexpr (std::is_same<SampleType, double>::value) return key.doubleKey;
+            else                                                    return key.floatKey;
+        }
 
-                for (int ch = 0; ch < numChannels; ++ch)
-                    buffer.copyFrom(ch, 0, mixBuffer, ch, 0, numSamples);
-            }
+        static const auto& getOtherKey(const EffectChain::Graph::Sidechain& key)
+        {
+            if constexpr (std::is_same<SampleType, double>::value) return key.floatKey;
+            else                                                    return key.doubleKey;
         }
 
-        void reset() override
-        {
-            for (auto& child : children)
-                child->reset();
-        }
+        void checkOutput(juce::AudioBuffer<SampleType>& buffer)
+        {
+            const auto counts = NodeSentinel::scan(buffer);
+            if (counts.denormals == 0 && counts.nonFinite == 0)
+                return;
+
+            if (counts.nonFinite > 0)
+            {
+                // Block and state are unusable: silence, reset, and bypass the node
+                // for a while in case the preset drives it straight back there
+                buffer.clear();
+                effect->reset();
+                quarantineRemaining = quarantineLength;
+                sentinel->post(name, counts, true);
+                return;
+            }
+
+            NodeSentinel::flushDenormals(buffer);
+
+            // A mostly-denormal block means a feedback path has decayed into them
+            if (counts.denormals * 4 > buffer.getNumSamples() * buffer.getNumChannels())
+            {
+                effect->reset();
+                sentinel->post(name, counts, false);
+            }
+        }
+
+        void reset() override
+        {
+            quarantineRemaining = 0;
+
+            if (effect)
+                effect->reset();
+        }
+
+        int getLatencySamples() const override
+        {
+            return effect ? effect->getLatencySamples() : 0;
+        }
+
+        std::unique_ptr<AudioEffectBase<SampleType>> effect;
+
+        juce::String name;
+        NodeSentinel* sentinel = nullptr;
+        const EffectChain::Graph::Sidechain* sidechain = nullptr;
+        juce::AudioBuffer<SampleType> keyScratch;
+        int quarantineLength = 0;
+        int quarantineRemaining = 0;
+    };
+
+    template <typename SampleType>
+    struct GroupNode : public PrecisionNode<SampleType, GroupNode<SampleType>>
+    {
+        enum class Mode { Series, Parallel };
+
+        explicit GroupNode(Precision parent)
+            : PrecisionNode<SampleType, GroupNode<SampleType>>(parent) {}
+
+        void prepare(const juce::dsp::ProcessSpec& spec) override
+        {
+            processSpec = spec;
+            this->prepareBoundary(spec);
+
+            const auto numChannels = static_cast<int>(spec.numChannels);
+            const auto maxBlock = static_cast<int>(spec.maximumBlockSize);
+
+            tempBuffer.setSize(numChannels, maxBlock);
+            mixBuffer.setSize(numChannels, maxBlock);
+
+            branches.clear();
+            if (scheduler != nullptr)
+            {
+                branches.resize(children.size());
+                for (size_t i = 0; i < branches.size(); ++i)
+                {
+                    branches[i].group = this;
+                    branches[i].index = i;
+                    branches[i].storage.setSize(numChannels, maxBlock);
+                }
+            }
+
+            for (auto& child : children)
+                child->prepare(spec);
+
+            // Parallel children are delayed to line up with the slowest one,
+            // through a separate line for each pass
+            const int passes = repeat > 0 ? repeat : 1;
+
+            latencySamples = 0;
+            for (auto& child : children)
+                latencySamples = mode == Mode::Series && !splitChannels ? latencySamples + child->getLatencySamples()
+                                                                         : juce::jmax(latencySamples, child->getLatencySamples());
+
+            compensation.clear();
+            if (mode == Mode::Parallel)
+            {
+                compensation.resize(children.size() * static_cast<size_t>(passes));
+                for (size_t i = 0; i < compensation.size(); ++i)
+                    compensation[i].prepare(numChannels, latencySamples - children[i % children.size()]->getLatencySamples());
+            }
+
+            latencySamples *= passes;
+        }
+
+        int getLatencySamples() const override { return latencySamples; }
+
+        void processNative(juce::AudioBuffer<SampleType>& buffer)
+        {
+            const int passes = repeat > 0 ? repeat : 1;
+
+            if (mode == Mode::Series || children.empty())
+            {
+                for (int pass = 0; pass < passes; ++pass)
+                    for (auto& child : children)
+                        child->process(buffer);
+                return;
+            }
+
+            const int numChannels = buffer.getNumChannels();
+            const int numSamples  = buffer.getNumSamples();
+
+            mixBuffer.clear();
+
+            // Additional passes just re-process the mixed signal
+            for (int pass = 0; pass < passes; ++pass)
+            {
+                currentPass = pass;
+
+                if (branches.empty())
+                    mixSerial(buffer);
+                else
+                    mixSpread(buffer);
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                    buffer.copyFrom(ch, 0, mixBuffer, ch, 0, numSamples);
+            }
+        }
+
+        void reset() override
+        {
+            for (auto& child : children)
+                child->reset();
+
+            for (auto& delay : compensation)
+                delay.reset();
+        }
+
+        void compensate(size_t index, juce::AudioBuffer<SampleType>& output)
+        {
+            const auto line = static_cast<size_t>(currentPass) * children.size() + index;
+
+            if (line < compensation.size() && compensation[line].isActive())
+                compensation[line].process(output);
+        }
+
+        // Adds every child's output for this input to mixBuffer
+        void mixSerial(const juce::AudioBuffer<SampleType>& buffer)
+        {
+            const int numChannels = buffer.getNumChannels();
+            const int numSamples  = buffer.getNumSamples();
+
+            for (size_t i = 0; i < children.size(); ++i)
+            {
+                tempBuffer.makeCopyOf(buffer, true);
+                children[i]->process(tempBuffer);
+                compensate(i, tempBuffer);
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                    mixBuffer.addFrom(ch, 0, tempBuffer, ch, 0, numSamples);
+            }
+        }
+
+        // The same, with the children run side by side on the scheduler. The
+        // first runs here, and this thread helps with the rest until they
+        // are done, so the block never finishes later than serially would.
+        void mixSpread(const juce::AudioBuffer<SampleType>& buffer)
+        {
+            const int numChannels = buffer.getNumChannels();
+            const int numSamples  = buffer.getNumSamples();
+
+            branchInput = &buffer;
+
+            DspScheduler::Batch batch;
+            const auto deadline = DspScheduler::deadlineAfter(numSamples / processSpec.sampleRate);
+
+            for (size_t i = 1; i < branches.size(); ++i)
+                if (!scheduler->submit({ &Branch::run, &branches[i], deadline, &batch }))
+                    runBranch(branches[i]);
+
+            runBranch(branches[0]);
+            scheduler->wait(batch);
+
+            // Summed in child order, so the result matches mixSerial() exactly
+            for (auto& branch : branches)
+                for (int ch = 0; ch < numChannels; ++ch)
+                    mixBuffer.addFrom(ch, 0, branch.view, ch, 0, numSamples);
+        }
+
+        // One child's share of mixSpread(), with its own buffer
+        struct Branch
+        {
+            GroupNode* group = nullptr;
+            size_t index = 0;
+            juce::AudioBuffer<SampleType> storage, view;
+
+            static void run(void* context)
+            {
+               #if PRESET_ENGINE_RT_CHECK
+                // Workers run audio-thread code too
+                const RealtimeCheck::ScopedRealtime realtime;
+               #endif
+
+                auto& branch = *static_cast<Branch*>(context);
+                branch.group->runBranch(branch);
+            }
+        };
+
+        void runBranch(Branch& branch)
+        {
+            const auto& input = *branchInput;
+            const int numChannels = input.getNumChannels();
+            const int numSamples  = input.getNumSamples();
+
+            branch.view.setDataToReferTo(branch.storage.getArrayOfWritePointers(), numChannels, numSamples);
+            for (int ch = 0; ch < numChannels; ++ch)
+                branch.view.copyFrom(ch, 0, input, ch, 0, numSamples);
+
+            children[branch.index]->process(branch.view);
+            compensate(branch.index, branch.view);
+        }
+
+        Mode mode { Mode::Series };
+        int repeat { 1 };
+        std::vector<NodePtr> children;
+
+        // One effect split into channel groups: the children are identical
+        // instances on disjoint channels, so they run side by side in time
+        bool splitChannels = false;
+
+        int latencySamples = 0;
+        int currentPass = 0;
+        std::vector<CompensationDelay<SampleType>> compensation;
+
+        juce::dsp::ProcessSpec processSpec {};
+        juce::AudioBuffer<SampleType> tempBuffer;
+        juce::AudioBuffer<SampleType> mixBuffer;
+
+        // Set at build time for parallel groups worth spreading
+        DspScheduler* scheduler = nullptr;
+        std::vector<Branch> branches;
+        const juce::AudioBuffer<SampleType>* branchInput = nullptr;
+    };
+
+    // Runs its children with their output fed back into their input through a
+    // short per-sample delay ("type: Feedback"). The children run in chunks no
+    // longer than the loop delay, so every fed-back sample comes from an earlier
+    // chunk and the loop latency is the configured delay at any host block size.
+    template <typename SampleType>
+    struct FeedbackNode : public PrecisionNode<SampleType, FeedbackNode<SampleType>>
+    {
+        explicit FeedbackNode(Precision parent)
+            : PrecisionNode<SampleType, FeedbackNode<SampleType>>(parent) {}
+
+        void prepare(const juce::dsp::ProcessSpec& spec) override
+        {
+            this->prepareBoundary(spec);
+
+            delaySamples = delayMs > 0.0 ? juce::jmax(1, juce::roundToInt(delayMs * 0.001 * spec.sampleRate))
+                                         : juce::jmax(1, fixedDelaySamples);
+            chunkSize = juce::jmin(delaySamples, static_cast<int>(spec.maximumBlockSize));
+
+            const auto ringSize = juce::nextPowerOfTwo(delaySamples + 1);
+            ring.setSize(static_cast<int>(spec.numChannels), ringSize);
+            ringMask = ringSize - 1;
+
+            auto bodySpec = spec;
+            bodySpec.maximumBlockSize = static_cast<juce::uint32>(juce::jmax(1, chunkSize));
+            body->prepare(bodySpec);
+
+            ring.clear();
+            writePosition = 0;
+        }
+
+        void processNative(juce::AudioBuffer<SampleType>& buffer)
+        {
+            const int numChannels = juce::jmin(buffer.getNumChannels(), ring.getNumChannels());
+            const int numSamples = buffer.getNumSamples();
+            const auto g = static_cast<SampleType>(gain);
+
+            for (int start = 0; start < numSamples; start += chunkSize)
+            {
+                const auto length = juce::jmin(chunkSize, numSamples - start);
+                chunk.setDataToReferTo(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, length);
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                {
+                    auto* data = chunk.getWritePointer(ch);
+                    const auto* line = ring.getReadPointer(ch);
+
+                    for (int i = 0; i < length; ++i)
+                        data[i] += g * line[(writePosition - delaySamples + i) & ringMask];
+                }
+
+                body->process(chunk);
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                {
+                    const auto* data = chunk.getReadPointer(ch);
+                    auto* line = ring.getWritePointer(ch);
+
+                    for (int i = 0; i < length; ++i)
+                        line[(writePosition + i) & ringMask] = data[i];
+                }
+
+                writePosition = (writePosition + length) & ringMask;
+            }
+        }
+
+        void reset() override
+        {
+            body->reset();
+            ring.clear();
+            writePosition = 0;
+        }
+
+        int getLatencySamples() const override { return body->getLatencySamples(); }
+
+        NodePtr body;
+        double delayMs = 1.0;           // loop delay; when 0, fixedDelaySamples is used
+        int fixedDelaySamples = 1;
+        float gain = 0.5f;
+
+        int delaySamples = 1;
+        int chunkSize = 1;
+        int ringMask = 0;
+        int writePosition = 0;
+        juce::AudioBuffer<SampleType> ring;
+        juce::AudioBuffer<SampleType> chunk;
+    };
+
+    // Runs a node on a subset of the parent's channels ("channels: [Ls, Rs]").
+    // The subset is an AudioBuffer referring to the parent's channel pointers,
+    // so routing costs nothing and the child sees an ordinary narrower buffer.
+    // When the child has latency, the other channels are delayed to match.
+    struct ChannelViewNode : public EffectChain::Node
+    {
+        ChannelViewNode(NodePtr n, std::vector<int> selected)
+            : child(std::move(n)), channels(std::move(selected)) {}
+
+        void prepare(const juce::dsp::ProcessSpec& spec) override
+        {
+            floatPointers.resize(channels.size());
+            doublePointers.resize(channels.size());
+
+            auto subSpec = spec;
+            subSpec.numChannels = static_cast<juce::uint32>(channels.size());
+            child->prepare(subSpec);
+
+            const auto numChannels = static_cast<int>(spec.numChannels);
+            const auto otherDelay = delaysOtherChannels ? child->getLatencySamples() : 0;
+            floatDelay.prepare(numChannels, otherDelay);
+            doubleDelay.prepare(numChannels, otherDelay);
+        }
+
+        void process(juce::AudioBuffer<float>& buffer) override  { processView(buffer, floatPointers, floatView, floatDelay); }
+        void process(juce::AudioBuffer<double>& buffer) override { processView(buffer, doublePointers, doubleView, doubleDelay); }
+
+        void reset() override
+        {
+            child->reset();
+            floatDelay.reset();
+            doubleDelay.reset();
+        }
+
+        int getLatencySamples() const override { return child->getLatencySamples(); }
+
+        template <typename SampleType>
+        void processView(juce::AudioBuffer<SampleType>& buffer, std::vector<SampleType*>& pointers,
+                         juce::AudioBuffer<SampleType>& view, CompensationDelay<SampleType>& delay)
+        {
+            int numSelected = 0;
+            for (auto ch : channels)
+                if (ch < buffer.getNumChannels())
+                    pointers[static_cast<size_t>(numSelected++)] = buffer.getWritePointer(ch);
+
+            if (delay.isActive())
+            {
+                const auto numChannels = juce::jmin(buffer.getNumChannels(), delay.line.getNumChannels());
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                    if (std::find(channels.begin(), channels.end(), ch) == channels.end())
+                        delay.process(buffer.getWritePointer(ch), ch, buffer.getNumSamples());
+
+                delay.advance(buffer.getNumSamples());
+            }
+
+            if (numSelected == 0)
+                return;
+
+            view.setDataToReferTo(pointers.data(), numSelected, buffer.getNumSamples());
+            child->process(view);
+        }
+
+        NodePtr child;
+        std::vector<int> channels;
+        bool delaysOtherChannels = true;    // false where a sibling covers them
+
+        std::vector<float*> floatPointers;
+        std::vector<double*> doublePointers;
+        juce::AudioBuffer<float> floatView;
+        juce::AudioBuffer<double> doubleView;
+        CompensationDelay<float> floatDelay;
+        CompensationDelay<double> doubleDelay;
+    };
+
+    // Meters an effect's output. Wraps whatever was built for the effect, so an
+    // effect split into channel groups still reports as one node.
+    struct MeterNode : public EffectChain::Node
+    {
+        MeterNode(NodePtr n, NodeMeters::Slot& s, const juce::AudioChannelSet& layout)
+            : child(std::move(n)), slot(s)
+        {
+            meter.setChannelLayout(layout);
+        }
+
+        void prepare(const juce::dsp::ProcessSpec& spec) override
+        {
+            meter.prepare(spec);
+            child->prepare(spec);
+        }
+
+        void process(juce::AudioBuffer<float>& buffer) override  { processMetered(buffer); }
+        void process(juce::AudioBuffer<double>& buffer) override { processMetered(buffer); }
+
+        void reset() override
+        {
+            meter.reset();
+            child->reset();
+        }
+
+        int getLatencySamples() const override { return child->getLatencySamples(); }
+
+        template <typename SampleType>
+        void processMetered(juce::AudioBuffer<SampleType>& buffer)
+        {
+            child->process(buffer);
+            meter.process(buffer, slot);
+        }
+
+        NodePtr child;
+        NodeMeters::Slot& slot;
+        LevelMeter meter;
+    };
+
+    // A modulation source's place in the graph. Audio passes through untouched;
+    // envelope followers track it.
+    struct ModulatorNode : public EffectChain::Node
+    {
+        explicit ModulatorNode(Modulator& m) : modulator(m) {}
+
+        void prepare(const juce::dsp::ProcessSpec& spec) override   { modulator.prepare(spec.sampleRate); }
+        void process(juce::AudioBuffer<float>& buffer) override     { modulator.follow(buffer); }
+        void process(juce::AudioBuffer<double>& buffer) override    { modulator.follow(buffer); }
+        void reset() override                                       { modulator.reset(); }
+
+        Modulator& modulator;
+    };
+
+    // "send: verb, level: -12": adds the signal at this point to a named bus
+    // and passes it on unchanged
+    struct SendNode : public EffectChain::Node
+    {
+        explicit SendNode(EffectChain::Graph::BusPool& p) : pool(p) {}
+
+        void prepare(const juce::dsp::ProcessSpec&) override       {}
+        void process(juce::AudioBuffer<float>& buffer) override     { pool.add(bus->slot, buffer, gain); }
+        void process(juce::AudioBuffer<double>& buffer) override    { pool.add(bus->slot, buffer, gain); }
+        void reset() override                                       {}
+
+        EffectChain::Graph::BusPool& pool;
+        const EffectChain::Graph::Bus* bus = nullptr;   // resolved once every bus is known
+        float gain = 1.0f;
+    };
+
+    juce::ValueTree yamlToValueTree(const YAML::Node& node, const juce::Identifier& name = "Effect")
+    {
+        juce::ValueTree tree(name);
+        
+        if (node.IsScalar())
+        {
+            tree.setProperty("value", juce::String(node.as<std::string>()), nullptr);
+        }
+        else if (node.IsSequence())
+        {
+            for (const auto& item : node)
+            {
+                tree.addChild(yamlToValueTree(item, "Item"), -1, nullptr);
+            }
+        }
+        else if (node.IsMap())
+        {
+            for (auto it = node.begin(); it != node.end(); ++it)
+            {
+                auto key = it->first.as<std::string>();
+                const auto& val = it->second;
+                
+                if (val.IsScalar())
+                {
+                    // simple heuristic for types
+                    bool forceString = (key == "mode" || key == "type" || key == "ui" || key == "style");
+                    
+                    if (forceString)
+                    {
+                        tree.setProperty(juce::Identifier(key), juce::String(val.as<std::string>()), nullptr);
+                    }
+                    else
+                    {
+                        try
+                        {
+                            tree.setProperty(juce::Identifier(key), juce::var(val.as<float>()), nullptr);
+                        }
+                        catch (...)
+                        {
+                            tree.setProperty(juce::Identifier(key), juce::String(val.as<std::string>()), nullptr);
+                        }
+                    }
+                }
+                else
+                {
+                    // Special handling for "children" to support nested groups/effect graphs
+                    if (key == "children" && val.IsSequence())
+                    {
+                        for (const auto& item : val)
+                            tree.addChild(yamlToValueTree(item, "Effect"), -1, nullptr);
+                    }
+                    else
+                    {
+                        // Recurse for Maps and other Sequences
+                        tree.addChild(yamlToValueTree(val, juce::Identifier(key)), -1, nullptr);
+                    }
+                }
+            }
+        }
+        return tree;
+    }
+
+    std::shared_ptr<const EffectChain::ParsedPreset> getParsedPreset(const juce::String& format, const juce::String& source,
+                                                                     const std::function<std::unique_ptr<EffectChain::ParsedPreset>()>& parse)
+    {
+        return SharedResourceCache::getInstance().getOrCreate<EffectChain::ParsedPreset>(
+            { "Preset", SharedResourceCache::hash(source, SharedResourceCache::hash(format)) },
+            parse,
+            [&source](const EffectChain::ParsedPreset&) { return (size_t) source.getNumBytesAsUTF8() * 4; });
+    }
+
+    // "precision: double" / "precision: float" on any node; unset inherits from the parent
+    Precision getNodePrecision(const juce::ValueTree& tree, Precision parent)
+    {
+        auto precisionStr = tree.getProperty("precision", "").toString().trim().toLowerCase();
+
+        if (precisionStr == "double" || precisionStr == "64")
+            return Precision::Double;
+        if (precisionStr == "float" || precisionStr == "single" || precisionStr == "32")
+            return Precision::Single;
+
+        return parent;
+    }
+
+    // A "mod:" reference, resolved once every modulator in the preset is known
+    struct PendingRoute
+    {
+        juce::String sourceName;
+        ModulationRoute route;
+    };
+
+    // A send, or a bus's "output:", resolved once every bus is known. "from" is
+    // the bus whose chain feeds it, or nullptr for the main chain.
+    struct PendingSend
+    {
+        juce::String busName;
+        EffectChain::Graph::Bus* from = nullptr;
+        SendNode* node = nullptr;
+    };
+
+    // What a node is being built for: the named channels it can route to, and
+    // where references to modulators and buses are collected
+    struct BuildContext
+    {
+        juce::AudioChannelSet layout;
+        NodeSentinel* sentinel = nullptr;
+        NodeMeters* meters = nullptr;
+        DspScheduler* scheduler = nullptr;
+        int* numEffectsBuilt = nullptr;
+        EffectChain::Graph* graph = nullptr;
+        std::vector<PendingRoute>* pendingRoutes = nullptr;
+        std::vector<PendingSend>* pendingSends = nullptr;
+        EffectChain::Graph::Bus* currentBus = nullptr;
+        juce::File fileDirectory;
+        juce::StringArray* errors = nullptr;    // fail the build once every node is built
+        juce::ValueTree preset;                 // root of the preset being built
+    };
+
+    // Routes for every parameter child with "mod:" set, e.g.
+    //   frequency: { value: 800, mod: wobble, amount: 600 }
+    template <typename SampleType>
+    void addModulationRoutes(AudioEffectBase<SampleType>& effect, const juce::ValueTree& tree, const BuildContext& context)
+    {
+        for (const auto& param : tree)
+        {
+            if (!param.hasProperty("mod") || param.hasProperty("type"))
+                continue;
+
+            const auto id = param.getType();
+
+            // configure() isn't safe on the audio thread, so a parameter the
+            // effect can't modulate has no fallback
+            const auto target = effect.getModulationTarget(id);
+            if (!target.isValid())
+            {
+                context.errors->add("'" + id.toString() + "' of " + tree.getProperty("type").toString() + " can't be modulated");
+                continue;
+            }
+
+            // The preset's limits can only narrow what the effect accepts
+            ModulationRoute route;
+            route.base = param.getProperty("value", param.getProperty("default", 0.0f));
+            route.amount = param.getProperty("amount", 1.0f);
+            route.minValue = juce::jlimit(target.minValue, target.maxValue, (float) param.getProperty("min", target.minValue));
+            route.maxValue = juce::jlimit(route.minValue, target.maxValue, (float) param.getProperty("max", target.maxValue));
+
+            route.apply = [&effect, index = target.index](float value, int rampSamples)
+            {
+                effect.setModulatedParameter(index, value, rampSamples);
+            };
+
+            context.pendingRoutes->push_back({ param.getProperty("mod").toString(), std::move(route) });
+        }
+    }
+
+    NodePtr buildModulatorNode(const juce::ValueTree& tree, const BuildContext& context)
+    {
+        auto modulator = std::make_unique<Modulator>();
+        modulator->configure(tree);
+
+        auto node = std::make_unique<ModulatorNode>(*modulator);
+        context.graph->modulators.push_back(std::move(modulator));
+        return node;
+    }
+
+    // "send: verb" (or "type: Send" with "bus: verb"), "level:" in dB
+    NodePtr buildSendNode(const juce::ValueTree& tree, const BuildContext& context)
+    {
+        auto node = std::make_unique<SendNode>(context.graph->busPool);
+        node->gain = juce::Decibels::decibelsToGain(static_cast<float>(tree.getProperty("level", 0.0f)));
+
+        const auto busName = tree.getProperty("send", tree.getProperty("bus")).toString().trim();
+        context.pendingSends->push_back({ busName, context.currentBus, node.get() });
+        return node;
+    }
+
+    // "channels: [L, R]", "channels: Ls Rs" or "channels: [0, 1]". Names are JUCE
+    // channel abbreviations resolved against the current layout. Returns false
+    // when the key is absent; unknown or missing channels are dropped.
+    bool getNodeChannels(const juce::ValueTree& tree, const juce::AudioChannelSet& layout, std::vector<int>& result)
+    {
+        juce::StringArray names;
+
+        auto channelsTree = tree.getChildWithName("channels");
+        if (channelsTree.isValid())
+        {
+            for (const auto& item : channelsTree)
+                names.add(item.getProperty("value").toString());
+        }
+        else if (tree.hasProperty("channels"))
+        {
+            auto value = tree.getProperty("channels");
+            if (auto* array = value.getArray())
+                for (const auto& item : *array)
+                    names.add(item.toString());
+            else
+                names.addTokens(value.toString(), " ,", "");
+        }
+        else
+        {
+            return false;
+        }
+
+        names.trim();
+        names.removeEmptyStrings();
+
+        for (const auto& name : names)
+        {
+            int index = -1;
+
+            if (name.containsOnly("0123456789"))
+                index = name.getIntValue();
+            else if (auto type = juce::AudioChannelSet::getChannelTypeFromAbbreviation(name); type != juce::AudioChannelSet::unknown)
+                index = layout.getChannelIndexForType(type);
+
+            if (index >= 0 && index < layout.size() && std::find(result.begin(), result.end(), index) == result.end())
+                result.push_back(index);
+        }
+
+        return true;
+    }
+
+    // The layout a child sees when it only gets the selected channels
+    juce::AudioChannelSet getSubLayout(const juce::AudioChannelSet& layout, const std::vector<int>& channels)
+    {
+        juce::AudioChannelSet subLayout;
+        for (auto index : channels)
+            subLayout.addChannel(layout.getTypeOfChannel(index));
+        return subLayout;
+    }
+
+    NodePtr buildNodeFromValueTree(const juce::ValueTree& tree, Precision parent, const BuildContext& context);
+
+    // A parallel branch predicted to cost less than this per sample and
+    // channel isn't worth handing to another thread
+    constexpr double minSpreadNsPerSample = 10.0;
+
+    // Predicted float cost per sample and channel, from the analyzer's table
+    double estimateNsPerSample(const juce::ValueTree& tree)
+    {
+        if (const auto* cost = PresetAnalyzer::getEffectCost(tree))
+            return cost->nsPerSample;
+
+        double total = 0.0;
+        for (const auto& child : tree)
+            if (child.hasProperty("type") || child.hasProperty("send"))
+                total += estimateNsPerSample(child);
+
+        return total * juce::jmax(1, static_cast<int>(tree.getProperty("repeat", 1)));
+    }
+
+    // Bus inputs are summed without synchronisation, so branches that send
+    // must stay on one thread
+    bool sendsToBus(const juce::ValueTree& tree)
+    {
+        const auto type = tree.getProperty("type").toString();
+        if (type == "Send" || (type.isEmpty() && tree.hasProperty("send")))
+            return true;
+
+        for (const auto& child : tree)
+            if (sendsToBus(child))
+                return true;
+
+        return false;
+    }
+
+    // Spread a parallel group when at least two branches are heavy enough
+    bool isWorthSpreading(const juce::ValueTree& tree)
+    {
+        int heavyBranches = 0;
+
+        for (const auto& child : tree)
+        {
+            if (sendsToBus(child))
+                return false;
+
+            if (estimateNsPerSample(child) >= minSpreadNsPerSample)
+                ++heavyBranches;
+        }
+
+        return heavyBranches >= 2;
+    }
+
+    template <typename SampleType>
+    NodePtr buildGroupNode(const juce::ValueTree& tree, Precision parent, const BuildContext& context)
+    {
+        auto group = std::make_unique<GroupNode<SampleType>>(parent);
+
+        auto modeStr = tree.getProperty("mode", "series").toString().toLowerCase();
+        if (modeStr == "parallel")
+            group->mode = GroupNode<SampleType>::Mode::Parallel;
+        else
+            group->mode = GroupNode<SampleType>::Mode::Series;
+
+        if (tree.hasProperty("repeat"))
+            group->repeat = static_cast<int>(tree.getProperty("repeat"));
+
+        for (int i = 0; i < tree.getNumChildren(); ++i)
+        {
+            auto childTree = tree.getChild(i);
+            if (!childTree.isValid())
+                continue;
+
+            auto childNode = buildNodeFromValueTree(childTree, precisionOf<SampleType>(), context);
+            if (childNode)
+                group->children.push_back(std::move(childNode));
+        }
+
+        if (group->mode == GroupNode<SampleType>::Mode::Parallel && group->children.size() > 1
+            && context.scheduler != nullptr && context.scheduler->getNumWorkers() > 0 && isWorthSpreading(tree))
+            group->scheduler = context.scheduler;
+
+        return group;
+    }
+
+    // "type: Feedback" with "delay:" (ms) or "delay_samples:" for the loop delay
+    // and "feedback:" for the linear loop gain
+    template <typename SampleType>
+    NodePtr buildFeedbackNode(const juce::ValueTree& tree, Precision parent, const BuildContext& context)
+    {
+        auto node = std::make_unique<FeedbackNode<SampleType>>(parent);
+
+        if (tree.hasProperty("delay_samples"))
+        {
+            node->delayMs = 0.0;
+            node->fixedDelaySamples = static_cast<int>(tree.getProperty("delay_samples"));
+        }
+        else
+        {
+            node->delayMs = juce::jmax(0.001, static_cast<double>(tree.getProperty("delay", 1.0)));
+        }
+
+        node->gain = juce::jlimit(-1.0f, 1.0f, static_cast<float>(tree.getProperty("feedback", 0.5f)));
+        node->body = buildGroupNode<SampleType>(tree, precisionOf<SampleType>(), context);
+        return node;
+    }
+
+    // Child indices from root down to node
+    std::vector<int> getTreePath(juce::ValueTree node, const juce::ValueTree& root)
+    {
+        std::vector<int> path;
+
+        for (auto parent = node.getParent(); parent.isValid() && node != root; node = parent, parent = node.getParent())
+            path.insert(path.begin(), parent.indexOf(node));
+
+        return path;
+    }
+
+    // tree is the effect's configuration, presetNode its node in the preset
+    // (they differ once a file path has been resolved)
+    template <typename SampleType>
+    NodePtr buildEffectNode(std::unique_ptr<AudioEffectBase<SampleType>> effect, const juce::ValueTree& tree,
+                            const juce::ValueTree& presetNode, Precision parent, const BuildContext& context)
+    {
+        effect->configure(tree);
+
+        // "Delay #3": the effect's position in the preset, for sentinel reports and meters
+        const auto number = ++*context.numEffectsBuilt;
+        context.graph->effectNumbers[getTreePath(presetNode, context.preset)] = number;
+        const auto name = tree.getProperty("type").toString() + " #" + juce::String(number);
+
+        const auto error = effect->getConfigurationError();
+        if (error.isNotEmpty())
+            context.errors->add(name + ": " + error);
+
+        auto metered = [&](NodePtr node) -> NodePtr
+        {
+            if (auto* slot = context.meters->getSlot(number))
+                return std::make_unique<MeterNode>(std::move(node), *slot, context.layout);
+
+            return node;
+        };
+
+        auto makeNode = [&](std::unique_ptr<AudioEffectBase<SampleType>> e, Precision nodeParent)
+        {
+            addModulationRoutes(*e, tree, context);
+
+            auto node = std::make_unique<EffectNode<SampleType>>(std::move(e), nodeParent);
+            node->name = name;
+            node->sentinel = context.sentinel;
+            node->sidechain = &context.graph->sidechain;
+            return node;
+        };
+
+        // Effects with a channel limit (stereo reverbs, panners) get one instance
+        // per consecutive channel group on wider buses: L/R, C/LFE, Ls/Rs, ...
+        const auto groupSize = effect->getMaximumChannels();
+        const auto numChannels = context.layout.size();
+
+        if (groupSize <= 0 || numChannels <= groupSize)
+            return metered(makeNode(std::move(effect), parent));
+
+        auto groups = std::make_unique<GroupNode<SampleType>>(parent);
+        groups->splitChannels = true;
+        const auto type = tree.getProperty("type").toString().toStdString();
+
+        for (int first = 0; first < numChannels; first += groupSize)
+        {
+            if (!effect)
+            {
+                effect = EffectChain::createEffect<SampleType>(type);
+                effect->configure(tree);
+            }
+
+            std::vector<int> channels;
+            for (int ch = first; ch < juce::jmin(numChannels, first + groupSize); ++ch)
+                channels.push_back(ch);
+
+            auto node = makeNode(std::move(effect), precisionOf<SampleType>());
+            auto view = std::make_unique<ChannelViewNode>(std::move(node), std::move(channels));
+            view->delaysOtherChannels = false;
+            groups->children.push_back(std::move(view));
+        }
+
+        return metered(std::move(groups));
+    }
+
+    // A relative "file:" resolves against the chain's file directory, not
+    // wherever the host happens to run
+    juce::ValueTree withResolvedFile(const juce::ValueTree& tree, const BuildContext& context)
+    {
+        const auto path = tree.getProperty("file").toString().trim();
+        if (path.isEmpty() || juce::File::isAbsolutePath(path) || context.fileDirectory == juce::File())
+            return tree;
+
+        auto resolved = tree.createCopy();
+        resolved.setProperty("file", context.fileDirectory.getChildFile(path).getFullPathName(), nullptr);
+        return resolved;
+    }
+
+    NodePtr buildRoutedNode(const juce::ValueTree& tree, Precision parent, const BuildContext& context)
+    {
+        auto typeStr = tree.getProperty("type").toString();
+        auto precision = getNodePrecision(tree, parent);
+
+        // Group node: can be used for series/parallel, with optional repeat
+        if (typeStr == "Group")
+        {
+            if (precision == Precision::Double)
+                return buildGroupNode<double>(tree, parent, context);
+
+            return buildGroupNode<float>(tree, parent, context);
+        }
+
+        if (typeStr == "Feedback")
+        {
+            if (precision == Precision::Double)
+                return buildFeedbackNode<double>(tree, parent, context);
+
+            return buildFeedbackNode<float>(tree, parent, context);
+        }
+
+        if (typeStr == "Modulator")
+            return buildModulatorNode(tree, context);
+
+        if (typeStr == "Send" || (typeStr.isEmpty() && tree.hasProperty("send")))
+            return buildSendNode(tree, context);
+
+        // Buses are only declared at the top level
+        if (typeStr == "Bus")
+            return nullptr;
+
+        // Leaf effect node
+        const auto config = withResolvedFile(tree, context);
+
+        if (precision == Precision::Double)
+            if (auto effect = EffectChain::createEffect<double>(typeStr.toStdString()))
+                return buildEffectNode(std::move(effect), config, tree, parent, context);
+
+        // Single precision, or an effect that only has a float implementation
+        auto effect = EffectChain::createEffect<float>(typeStr.toStdString());
+        if (!effect)
+            return nullptr;
+
+        return buildEffectNode(std::move(effect), config, tree, parent, context);
+    }
+
+    NodePtr buildNodeFromValueTree(const juce::ValueTree& tree, Precision parent, const BuildContext& context)
+    {
+        if (!tree.hasProperty("type") && !tree.hasProperty("send"))
+            return nullptr;
+
+        std::vector<int> channels;
+        if (!getNodeChannels(tree, context.layout, channels))
+            return buildRoutedNode(tree, parent, context);
+
+        // A selection that matches nothing on this bus leaves the node idle
+        if (channels.empty())
+            return std::make_unique<GroupNode<float>>(parent);
+
+        // Nodes below only see the selected channels, and resolve names against them
+        auto subContext = context;
+        subContext.layout = getSubLayout(context.layout, channels);
+
+        auto node = buildRoutedNode(tree, parent, subContext);
+        if (!node)
+            return nullptr;
+
+        return std::make_unique<ChannelViewNode>(std::move(node), std::move(channels));
+    }
+
+    // Memory a built preset holds. Only used to decide how many programs stay
+    // warm, so it errs on the large side.
+    size_t estimateGraphBytes(const juce::ValueTree& tree, const juce::dsp::ProcessSpec& spec, Precision precision)
+    {
+        PresetAnalyzer::Settings settings;
+        settings.spec = spec;
+        settings.precision = precision;
+        return PresetAnalyzer::analyze(tree, settings).memoryBytes;
+    }
+
+    // A top-level "type: Bus". Its chain always spans every channel and runs in
+    // the graph's precision unless the bus sets its own.
+    std::unique_ptr<EffectChain::Graph::Bus> buildBus(const juce::ValueTree& tree, const BuildContext& context)
+    {
+        auto bus = std::make_unique<EffectChain::Graph::Bus>();
+        bus->name = tree.getProperty("name").toString().trim();
+        bus->returnGain = juce::Decibels::decibelsToGain(static_cast<float>(tree.getProperty("level", 0.0f)));
+
+        // Sends inside the chain feed other buses from this one
+        auto busContext = context;
+        busContext.currentBus = bus.get();
+
+        const auto graphPrecision = context.graph->busPool.precision;
+        if (getNodePrecision(tree, graphPrecision) == Precision::Double)
+            bus->chain = buildGroupNode<double>(tree, graphPrecision, busContext);
+        else
+            bus->chain = buildGroupNode<float>(tree, graphPrecision, busContext);
+
+        return bus;
+    }
+
+    // Resolves sends and bus outputs, orders the buses so each runs after
+    // everything that feeds it (a loop between buses is an error), and gives
+    // buses whose inputs are never live at the same time the same buffer.
+    juce::Result scheduleBuses(EffectChain::Graph& graph, const std::vector<PendingSend>& sends)
+    {
+        auto& buses = graph.buses;
+        const auto numBuses = static_cast<int>(buses.size());
+
+        auto indexOf = [&buses](const juce::String& name)
+        {
+            for (size_t i = 0; i < buses.size(); ++i)
+                if (buses[i]->name == name)
+                    return static_cast<int>(i);
+            return -1;
+        };
+
+        // feeders[i]: the buses that write into bus i; -1 is the main chain
+        std::vector<std::vector<int>> feeders(buses.size());
+
+        for (const auto& send : sends)
+        {
+            const auto target = indexOf(send.busName);
+            if (target < 0)
+                return juce::Result::fail("Unknown bus: " + send.busName);
+
+            if (send.node != nullptr)
+                send.node->bus = buses[(size_t) target].get();
+            else
+                send.from->output = buses[(size_t) target].get();
+
+            feeders[(size_t) target].push_back(send.from != nullptr ? indexOf(send.from->name) : -1);
+        }
+
+        // Kahn's algorithm, keeping preset order among buses that are ready.
+        // step[i] is bus i's position in the schedule; the main chain is step 0.
+        std::vector<int> step(buses.size(), -1);
+        std::vector<int> order;
+
+        while (static_cast<int>(order.size()) < numBuses)
+        {
+            int next = -1;
+            for (int i = 0; i < numBuses && next < 0; ++i)
+            {
+                if (step[(size_t) i] >= 0)
+                    continue;
+
+                const auto& f = feeders[(size_t) i];
+                if (std::all_of(f.begin(), f.end(), [&step](int from) { return from < 0 || step[(size_t) from] >= 0; }))
+                    next = i;
+            }
+
+            if (next < 0)
+            {
+                juce::StringArray names;
+                for (int i = 0; i < numBuses; ++i)
+                    if (step[(size_t) i] < 0)
+                        names.add(buses[(size_t) i]->name);
+
+                return juce::Result::fail("Buses feed each other in a loop: " + names.joinIntoString(", "));
+            }
+
+            step[(size_t) next] = static_cast<int>(order.size()) + 1;
+            order.push_back(next);
+        }
+
+        // A bus input is live from the first step that writes it to the bus's
+        // own step; greedy interval colouring over those lifetimes
+        std::vector<int> slotFreeAfter;
+
+        for (auto i : order)
+        {
+            auto start = step[(size_t) i];
+            for (auto from : feeders[(size_t) i])
+                start = juce::jmin(start, from < 0 ? 0 : step[(size_t) from]);
+
+            int slot = 0;
+            while (slot < static_cast<int>(slotFreeAfter.size()) && slotFreeAfter[(size_t) slot] >= start)
+                ++slot;
+
+            if (slot == static_cast<int>(slotFreeAfter.size()))
+                slotFreeAfter.push_back(0);
+
+            slotFreeAfter[(size_t) slot] = step[(size_t) i];
+            buses[(size_t) i]->slot = slot;
+        }
+
+        graph.busPool.numSlots = static_cast<int>(slotFreeAfter.size());
+
+        std::vector<std::unique_ptr<EffectChain::Graph::Bus>> scheduled;
+        for (auto i : order)
+            scheduled.push_back(std::move(buses[(size_t) i]));
+        buses = std::move(scheduled);
+
+        return juce::Result::ok();
+    }
+
+    // Brackets every audio-thread entry point: makes the epoch odd for the
+    // duration (see releaseRetiredGraphs()) and marks the thread for the
+    // realtime-safety checker when that is compiled in
+    struct AudioThreadScope
+    {
+        explicit AudioThreadScope(std::atomic<juce::uint32>& e) : epoch(e)  { epoch.fetch_add(1); }
+        ~AudioThreadScope()                                                 { epoch.fetch_add(1); }
+
+        std::atomic<juce::uint32>& epoch;
+
+       #if PRESET_ENGINE_RT_CHECK
+        RealtimeCheck::ScopedRealtime realtime;
+       #endif
+    };
+}
+
+EffectChain::EffectChain()
+{
+}
+
+EffectChain::~EffectChain()
+{
+}
+
+void EffectChain::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    juce::ScopedLock sl(updateLock);
+    const auto channelsChanged = spec.numChannels != currentSpec.numChannels;
+    currentSpec = spec;
+
+    // Channel routing and per-group instances depend on the bus width
+    if (channelsChanged)
+    {
+        rebuildGraphs();
+        return;
+    }
+
+    auto* graph = liveGraph.load();
+    if (graph)
+    {
+        // The audio thread is stopped; a transition in progress just ends here
+        graph->transition.finished.store(true);
+        graph->transition.previous.reset();
+        graph->prepare(spec);
+    }
+
+    // Warm programs are prepared for the old spec too
+    for (auto& slot : programs)
+        if (slot.graph != nullptr && slot.graph.get() != graph)
+            slot.graph->prepare(spec);
+}
+
+void EffectChain::rebuildGraphs()
+{
+    juce::ScopedLock sl(updateLock);
+
+    // Every warm program was built for the old settings
+    for (auto& slot : programs)
+        slot.setGraph(nullptr);
+
+    if (currentConfig.isValid() && loadFromValueTree(currentConfig).wasOk())
+        programs[(size_t) currentProgram.load()].setGraph(getLiveGraph());
+
+    for (auto& slot : programs)
+        if (slot.preset != nullptr)
+            slot.estimatedBytes = estimateGraphBytes(slot.preset->tree, currentSpec, precision);
+
+    warmPrograms();
+}
+
+void EffectChain::process(juce::AudioBuffer<float>& buffer, const juce::dsp::AudioBlock<const float>& sidechain)
+{
+    const AudioThreadScope scope(audioEpoch);
+
+    if (auto* graph = liveGraph.load())
+        graph->process(buffer, sidechain);
+}
+
+void EffectChain::process(juce::AudioBuffer<double>& buffer, const juce::dsp::AudioBlock<const double>& sidechain)
+{
+    const AudioThreadScope scope(audioEpoch);
+
+    if (auto* graph = liveGraph.load())
+        graph->process(buffer, sidechain);
+}
+
+void EffectChain::setPrecision(Precision newPrecision)
+{
+    juce::ScopedLock sl(updateLock);
+    if (precision == newPrecision)
+        return;
+
+    precision = newPrecision;
+
+    // Nodes without an explicit precision follow the host, so rebuild them
+    rebuildGraphs();
+}
+
+void EffectChain::setChannelLayout(const juce::AudioChannelSet& newLayout)
+{
+    juce::ScopedLock sl(updateLock);
+    if (channelLayout == newLayout)
+        return;
+
+    channelLayout = newLayout;
+
+    // Channel names in the preset resolve against the layout, so rebuild
+    rebuildGraphs();
+}
+
+void EffectChain::setSubBlockSize(int newSubBlockSize)
+{
+    juce::ScopedLock sl(updateLock);
+    newSubBlockSize = juce::jmax(0, newSubBlockSize);
+    if (subBlockSize == newSubBlockSize)
+        return;
+
+    subBlockSize = newSubBlockSize;
+
+    // Nodes are prepared for the slice length, so swap in a freshly prepared graph
+    rebuildGraphs();
+}
+
+juce::AudioChannelSet EffectChain::getChannelLayout() const
+{
+    juce::ScopedLock sl(updateLock);
+
+    // Without a layout from the host, assume the canonical one for the bus width
+    const auto numChannels = static_cast<int>(currentSpec.numChannels);
+    if (channelLayout.size() == numChannels)
+        return channelLayout;
+
+    return juce::AudioChannelSet::canonicalChannelSet(numChannels);
+}
+
+int EffectChain::getEffectNumber(const juce::ValueTree& node) const
+{
+    juce::ScopedLock sl(updateLock);
+
+    if (auto* graph = liveGraph.load())
+    {
+        const auto found = graph->effectNumbers.find(getTreePath(node, currentConfig));
+        if (found != graph->effectNumbers.end())
+            return found->second;
+    }
+
+    return 0;
+}
+
+int EffectChain::getLatencySamples() const
+{
+    juce::ScopedLock sl(updateLock);
+
+    if (auto* graph = liveGraph.load())
+        return graph->latencySamples;
+
+    return 0;
+}
+
+void EffectChain::setFileDirectory(const juce::File& directory)
+{
+    juce::ScopedLock sl(updateLock);
+    fileDirectory = directory;
+}
+
+juce::File EffectChain::getFileDirectory() const
+{
+    juce::ScopedLock sl(updateLock);
+    return fileDirectory;
+}
+
+void EffectChain::setTransition(double crossfadeSeconds, double maxTailSeconds)
+{
+    juce::ScopedLock sl(updateLock);
+    transitionSeconds = juce::jmax(0.0, crossfadeSeconds);
+    maxTransitionSeconds = juce::jmax(transitionSeconds, maxTailSeconds);
+}
+
+void EffectChain::releaseRetiredGraphs()
+{
+    juce::ScopedLock sl(updateLock);
+
+    // The epoch is read before the live graph: a graph the audio thread swaps
+    // in after this point was loaded during a call that is still running
+    // (odd epoch), so it isn't freed until that call is over, by which time
+    // a later pass sees it live
+    const auto epoch = audioEpoch.load();
+    auto* live = liveGraph.load();
+
+    // The audio thread no longer touches the old graph once it has set "finished"
+    if (live && live->transition.previous != nullptr && live->transition.finished.load(std::memory_order_acquire))
+        live->transition.previous.reset();
+
+    // Graphs nobody else holds: not live, not in a program slot, not fading
+    // out. The audio thread may have picked one up just before it was
+    // replaced, so it is freed once the audio thread has been seen outside
+    // its call, or has left the call it was in when the graph was retired.
+    publishedGraphs.erase(std::remove_if(publishedGraphs.begin(), publishedGraphs.end(),
+                                         [live, epoch](const std::shared_ptr<Graph>& g)
+                                         {
+                                             if (g.use_count() > 1 || g.get() == live)
+                                             {
+                                                 g->retiring = false;
+                                                 return false;
+                                             }
+
+                                             if (!g->retiring)
+                                             {
+                                                 g->retiring = true;
+                                                 g->retiredAtEpoch = epoch;
+                                             }
+
+                                             return (g->retiredAtEpoch & 1u) == 0 || epoch != g->retiredAtEpoch;
+                                         }),
+                          publishedGraphs.end());
+
+    // Warm programs that stopped playing are cleared by the same rule, before
+    // their slot offers them to the audio thread again
+    for (auto& slot : programs)
+    {
+        auto* graph = slot.graph.get();
+        if (graph == nullptr || graph == live || !graph->needsReset.load())
+            continue;
+
+        if (live != nullptr && live->transition.previous.get() == graph)
+            continue;
+
+        if (!graph->resetPending)
+        {
+            graph->resetPending = true;
+            graph->resetAtEpoch = epoch;
+        }
+
+        if ((graph->resetAtEpoch & 1u) != 0 && epoch == graph->resetAtEpoch)
+            continue;
+
+        graph->resetPending = false;
+        graph->needsReset.store(false);
+        graph->reset();
+        slot.warmGraph.store(graph);
+    }
+}
+
+std::shared_ptr<EffectChain::Graph> EffectChain::getLiveGraph() const
+{
+    auto* live = liveGraph.load();
+
+    for (const auto& g : publishedGraphs)
+        if (g.get() == live)
+            return g;
+
+    return {};
+}
+
+//==============================================================================
+juce::Result EffectChain::setProgram(int index, const juce::String& source)
+{
+    if (!juce::isPositiveAndBelow(index, maxPrograms))
+        return juce::Result::fail("Program " + juce::String(index) + " is out of range");
+
+    // An empty slot is an empty chain
+    auto parsed = source.trim().isEmpty() ? std::make_shared<const ParsedPreset>(ParsedPreset { juce::ValueTree("Chain"), {} })
+                                          : parseSource(source);
+
+    if (parsed == nullptr)
+        return juce::Result::fail("Failed to parse preset.");
+
+    if (parsed->error.isNotEmpty())
+        return juce::Result::fail(parsed->error);
+
+    juce::ScopedLock sl(updateLock);
+
+    auto& slot = programs[(size_t) index];
+    slot.preset = std::move(parsed);
+    slot.estimatedBytes = estimateGraphBytes(slot.preset->tree, currentSpec, precision);
+
+    // The old graph may still be playing; it is freed once it isn't
+    slot.setGraph(nullptr);
+
+    warmPrograms();
+    return juce::Result::ok();
+}
 
-        Mode mode { Mode::Series };
-        int repeat { 1 };
-        std::vector<NodePtr> children;
+juce::Result EffectChain::selectProgram(int index)
+{
+    if (!juce::isPositiveAndBelow(index, maxPrograms))
+        return juce::Result::fail("Program " + juce::String(index) + " is out of range");
 
-        juce::dsp::ProcessSpec processSpec {};
-        juce::AudioBuffer<float> tempBuffer;
-        juce::AudioBuffer<float> mixBuffer;
-    };
+    juce::ScopedLock sl(updateLock);
+    releaseRetiredGraphs();
 
-    juce::ValueTree yamlToValueTree(const YAML::Node& node, const juce::Identifier& name = "Effect")
+    auto& slot = programs[(size_t) index];
+    if (slot.preset == nullptr)
+        return juce::Result::fail("Program " + juce::String(index + 1) + " is empty");
+
+    auto graph = slot.graph;
+    if (graph != nullptr && graph->needsReset.load())
     {
-        juce::ValueTree tree(name);
-        
-        if (node.IsScalar())
-        {
-            tree.setProperty("value", juce::String(node.as<std::string>()), nullptr);
-        }
-        else if (node.IsSequence())
-        {
-            for (const auto& item : node)
-            {
-                tree.addChild(yamlToValueTree(item, "Item"), -1, nullptr);
-            }
-        }
-        else if (node.IsMap())
-        {
-            for (auto it = node.begin(); it != node.end(); ++it)
-            {
-                auto key = it->first.as<std::string>();
-                const auto& val = it->second;
-                
-                if (val.IsScalar())
-                {
-                    // simple heuristic for types
-                    bool forceString = (key == "mode" || key == "type" || key == "ui" || key == "style");
-                    
-                    if (forceString)
-                    {
-                        tree.setProperty(juce::Identifier(key), juce::String(val.as<std::string>()), nullptr);
-                    }
-                    else
-                    {
-                        try
-                        {
-                            tree.setProperty(juce::Identifier(key), juce::var(val.as<float>()), nullptr);
-                        }
-                        catch (...)
-                        {
-                            tree.setProperty(juce::Identifier(key), juce::String(val.as<std::string>()), nullptr);
-                        }
-                    }
-                }
-                else
-                {
-                    // Special handling for "children" to support nested groups/effect graphs
-                    if (key == "children" && val.IsSequence())
-                    {
-                        for (const auto& item : val)
-                            tree.addChild(yamlToValueTree(item, "Effect"), -1, nullptr);
-                    }
-                    else
-                    {
-                        // Recurse for Maps and other Sequences
-                        tree.addChild(yamlToValueTree(val, juce::Identifier(key)), -1, nullptr);
-                    }
-                }
-            }
-        }
-        return tree;
+        // Switched away from a moment ago: let the audio thread leave the call
+        // it was in, so the graph is cleared before it plays again
+        const auto epoch = audioEpoch.load();
+        while ((epoch & 1u) != 0 && audioEpoch.load() == epoch)
+            juce::Thread::yield();
+
+        releaseRetiredGraphs();
     }
 
-    NodePtr buildNodeFromValueTree(const juce::ValueTree& tree)
+    if (graph == nullptr)
     {
-        if (!tree.hasProperty("type"))
-            return nullptr;
+        // Cold slot: build it now
+        auto result = buildGraph(slot.preset->tree, getBuildSettings(), graph);
+        if (result.failed())
+            return result;
 
-        auto typeStr = tree.getProperty("type").toString();
+        graph->prepare(currentSpec);
+        publishedGraphs.push_back(graph);
+        slot.setGraph(graph);
+    }
 
-        // Group node: can be used for series/parallel, with optional repeat
-        if (typeStr == "Group")
-        {
-            auto group = std::make_unique<GroupNode>();
+    // A MIDI program change may already have swapped it in on the audio thread
+    if (graph.get() != liveGraph.load())
+        swapInProgram(index, graph.get());
 
-            auto modeStr = tree.getProperty("mode", "series").toString().toLowerCase();
-            if (modeStr == "parallel")
-                group->mode = GroupNode::Mode::Parallel;
-            else
-                group->mode = GroupNode::Mode::Series;
+    slot.lastUsed = ++programUseCounter;
+    currentConfig = slot.preset->tree.createCopy();
+    currentPreset = slot.preset;
 
-            if (tree.hasProperty("repeat"))
-                group->repeat = static_cast<int>(tree.getProperty("repeat"));
+    warmPrograms();
+    return juce::Result::ok();
+}
 
-            for (int i = 0; i < tree.getNumChildren(); ++i)
-            {
-                auto childTree = tree.getChild(i);
-                if (!childTree.isValid())
-                    continue;
+bool EffectChain::selectWarmProgram(int index)
+{
+    if (!juce::isPositiveAndBelow(index, maxPrograms))
+        return false;
 
-                auto childNode = buildNodeFromValueTree(childTree);
-                if (childNode)
-                    group->children.push_back(std::move(childNode));
-            }
+    const AudioThreadScope scope(audioEpoch);
 
-            return group;
-        }
+    auto* graph = programs[(size_t) index].warmGraph.load();
+    if (graph == nullptr)
+        return false;
 
-        // Leaf effect node
-        auto effect = EffectChain::createEffect(typeStr.toStdString());
-        if (!effect)
-            return nullptr;
+    if (graph != liveGraph.load())
+        swapInProgram(index, graph);
 
-        effect->configure(tree);
-        return std::make_unique<EffectNode>(std::move(effect));
-    }
+    return true;
 }
 
-EffectChain::EffectChain()
+void EffectChain::swapInProgram(int index, Graph* graph)
 {
-}
+    // The outgoing graph stops running its own crossfade, if any, and its
+    // slot withdraws it until releaseRetiredGraphs() has cleared what it was
+    // left holding. It stays alive in its slot or in publishedGraphs, so
+    // nothing is freed or reset here.
+    if (auto* outgoing = liveGraph.load())
+    {
+        outgoing->transition.cutRequested.store(true, std::memory_order_relaxed);
+        outgoing->needsReset.store(true);
 
-EffectChain::~EffectChain()
-{
+        auto* expected = outgoing;
+        programs[(size_t) currentProgram.load()].warmGraph.compare_exchange_strong(expected, nullptr);
+    }
+
+    liveGraph.store(graph);
+    currentProgram.store(index);
 }
 
-void EffectChain::prepare(const juce::dsp::ProcessSpec& spec)
+void EffectChain::setProgramMemoryBudget(size_t bytes)
 {
     juce::ScopedLock sl(updateLock);
-    currentSpec = spec;
+    programMemoryBudget = bytes;
+    warmPrograms();
+}
 
-    auto root = std::atomic_load(&activeRoot);
-    if (root)
-        root->prepare(spec);
+bool EffectChain::isProgramWarm(int index) const
+{
+    return juce::isPositiveAndBelow(index, maxPrograms)
+        && programs[(size_t) index].warmGraph.load() != nullptr;
 }
 
-void EffectChain::process(juce::AudioBuffer<float>& buffer)
+// Keeps the current program and then the most recently used ones built and
+// prepared while they fit the budget; the rest only keep their parsed preset
+void EffectChain::warmPrograms()
 {
-    auto root = std::atomic_load(&activeRoot);
-    if (root)
-        root->process(buffer);
+    std::vector<int> order;
+    for (int i = 0; i < maxPrograms; ++i)
+        if (programs[(size_t) i].preset != nullptr)
+            order.push_back(i);
+
+    const auto current = currentProgram.load();
+    std::stable_sort(order.begin(), order.end(), [this, current](int a, int b)
+    {
+        if ((a == current) != (b == current))
+            return a == current;
+
+        return programs[(size_t) a].lastUsed > programs[(size_t) b].lastUsed;
+    });
+
+    size_t used = 0;
+
+    for (auto index : order)
+    {
+        auto& slot = programs[(size_t) index];
+
+        if (index != current && used + slot.estimatedBytes > programMemoryBudget)
+        {
+            slot.setGraph(nullptr);
+            continue;
+        }
+
+        used += slot.estimatedBytes;
+
+        if (slot.graph == nullptr)
+        {
+            std::shared_ptr<Graph> graph;
+            if (buildGraph(slot.preset->tree, getBuildSettings(), graph).wasOk())
+            {
+                graph->prepare(currentSpec);
+                publishedGraphs.push_back(graph);
+                slot.setGraph(graph);
+            }
+        }
+    }
 }
 
 void EffectChain::reset()
 {
     juce::ScopedLock sl(updateLock);
-    auto root = std::atomic_load(&activeRoot);
-    if (root)
-        root->reset();
+    if (auto* graph = liveGraph.load())
+        graph->reset();
 }
 
-std::unique_ptr<AudioEffect> EffectChain::createEffect(const std::string& type)
-{
-    if (type == "Gain") return std::make_unique<GainEffect>();
-    if (type == "Filter" || type == "EQ") return std::make_unique<FilterEffect>();
-    if (type == "Compressor") return std::make_unique<CompressorEffect>();
-    if (type == "Limiter") return std::make_unique<LimiterEffect>();
-    if (type == "Reverb") return std::make_unique<ReverbEffect>();
-    if (type == "Chorus") return std::make_unique<ChorusEffect>();
-    if (type == "Distortion") return std::make_unique<DistortionEffect>();
-    if (type == "Phaser") return std::make_unique<PhaserEffect>();
-    if (type == "Delay") return std::make_unique<DelayEffect>();
-    if (type == "NoiseGate" || type == "Gate") return std::make_unique<NoiseGateEffect>();
-    if (type == "LadderFilter" || type == "MoogFilter") return std::make_unique<LadderFilterEffect>();
-    if (type == "Panner" || type == "Pan") return std::make_unique<PannerEffect>();
+template <typename SampleType>
+std::unique_ptr<AudioEffectBase<SampleType>> EffectChain::createEffect(const std::string& type)
+{
+    if (type == "Gain") return std::make_unique<GainEffect<SampleType>>();
+    if (type == "Filter" || type == "EQ") return std::make_unique<FilterEffect<SampleType>>();
+    if (type == "Compressor") return std::make_unique<CompressorEffect<SampleType>>();
+    if (type == "Limiter") return std::make_unique<LimiterEffect<SampleType>>();
+    if (type == "Chorus") return std::make_unique<ChorusEffect<SampleType>>();
+    if (type == "Distortion") return std::make_unique<DistortionEffect<SampleType>>();
+    if (type == "Phaser") return std::make_unique<PhaserEffect<SampleType>>();
+    if (type == "Delay") return std::make_unique<DelayEffect<SampleType>>();
+    if (type == "NoiseGate" || type == "Gate") return std::make_unique<NoiseGateEffect<SampleType>>();
+    if (type == "LadderFilter" || type == "MoogFilter") return std::make_unique<LadderFilterEffect<SampleType>>();
+    if (type == "Panner" || type == "Pan") return std::make_unique<PannerEffect<SampleType>>();
+
+    // Effects that only have a single-precision implementation
+    if constexpr (std::is_same<SampleType, float>::value)
+    {
+        if (type == "Reverb") return std::make_unique<ReverbEffect>();
+        if (type == "Convolution" || type == "IR") return std::make_unique<ConvolutionEffect>();
+    }
+
     return nullptr;
 }
 
-juce::Result EffectChain::loadFromValueTree(const juce::ValueTree& tree)
+template std::unique_ptr<AudioEffectBase<float>> EffectChain::createEffect<float>(const std::string&);
+template std::unique_ptr<AudioEffectBase<double>> EffectChain::createEffect<double>(const std::string&);
+
+EffectChain::BuildSettings EffectChain::getBuildSettings() const
 {
     juce::ScopedLock sl(updateLock);
+    return { currentSpec, precision, getChannelLayout(), subBlockSize, fileDirectory };
+}
+
+juce::Result EffectChain::buildGraph(const juce::ValueTree& tree, const BuildSettings& settings, std::shared_ptr<Graph>& result)
+{
+    // Build a root group (series) that contains all top-level children,
+    // running in the host's precision so the root never converts
+    auto graph = std::make_shared<Graph>();
+    graph->subBlockSize = settings.subBlockSize;
+
+    std::vector<NodePtr>* rootChildren = nullptr;
+
+    if (settings.precision == Precision::Double)
+    {
+        auto group = std::make_unique<GroupNode<double>>(settings.precision);
+        rootChildren = &group->children;
+        graph->root = std::move(group);
+    }
+    else
+    {
+        auto group = std::make_unique<GroupNode<float>>(settings.precision);
+        rootChildren = &group->children;
+        graph->root = std::move(group);
+    }
+
+    graph->precision = settings.precision;
+    graph->busPool.precision = settings.precision;
 
-    // Build a root group (series) that contains all top-level children
-    auto rootGroup = std::make_shared<GroupNode>();
-    rootGroup->mode = GroupNode::Mode::Series;
+    int numEffectsBuilt = 0;
+    std::vector<PendingRoute> pendingRoutes;
+    std::vector<PendingSend> pendingSends;
+    juce::StringArray errors;
+    const BuildContext context { settings.layout, &sentinel, &meters, &scheduler.get(), &numEffectsBuilt, graph.get(),
+                                 &pendingRoutes, &pendingSends, nullptr, settings.fileDirectory, &errors, tree };
 
     for (int i = 0; i < tree.getNumChildren(); ++i)
     {
@@ -310,88 +2269,318 @@ juce::Result EffectChain::loadFromValueTree(const juce::ValueTree& tree)
         if (!child.isValid())
             continue;
 
-        auto node = buildNodeFromValueTree(child);
+        if (child.getProperty("type").toString() == "Bus")
+        {
+            auto bus = buildBus(child, context);
+
+            if (bus->name.isEmpty())
+                return juce::Result::fail("Bus without a name");
+
+            for (const auto& other : graph->buses)
+                if (other->name == bus->name)
+                    return juce::Result::fail("Duplicate bus name: " + bus->name);
+
+            if (child.hasProperty("output") && !child.getProperty("output").toString().equalsIgnoreCase("main"))
+                pendingSends.push_back({ child.getProperty("output").toString().trim(), bus.get(), nullptr });
+
+            graph->buses.push_back(std::move(bus));
+            continue;
+        }
+
+        auto node = buildNodeFromValueTree(child, settings.precision, context);
         if (!node)
         {
             auto typeStr = child.getProperty("type").toString();
             return juce::Result::fail("Unknown or invalid effect/group type: " + typeStr);
         }
 
-        rootGroup->children.push_back(std::move(node));
+        rootChildren->push_back(std::move(node));
     }
 
-    rootGroup->prepare(currentSpec);
+    if (!errors.isEmpty())
+        return juce::Result::fail(errors[0]);
 
-    std::atomic_store(&activeRoot, std::static_pointer_cast<Node>(rootGroup));
-    currentConfig = tree.createCopy();
+    for (auto& pending : pendingRoutes)
+    {
+        for (const auto& m : graph->modulators)
+            if (m->getName() == pending.sourceName)
+                pending.route.source = m.get();
+
+        if (pending.route.source == nullptr)
+            return juce::Result::fail("Unknown modulation source: " + pending.sourceName);
+
+        graph->routes.push_back(std::move(pending.route));
+    }
+
+    auto busResult = scheduleBuses(*graph, pendingSends);
+    if (busResult.failed())
+        return busResult;
+
+    result = std::move(graph);
     return juce::Result::ok();
 }
 
-juce::Result EffectChain::loadFromYaml(const juce::String& yamlString)
+juce::Result EffectChain::loadFromValueTree(const juce::ValueTree& tree)
 {
-    try {
-        YAML::Node root = YAML::Load(yamlString.toStdString());
+    juce::ScopedLock sl(updateLock);
 
-        if (!root.IsSequence())
-            return juce::Result::fail("YAML root must be a sequence/list.");
+    const auto settings = getBuildSettings();
+    std::shared_ptr<Graph> graph;
 
-        juce::ValueTree chain("Chain");
-        for (const auto& node : root)
-        {
-            if (node["type"])
-            {
-                chain.addChild(yamlToValueTree(node), -1, nullptr);
-            }
-        }
-        
-        return loadFromValueTree(chain);
-    }
-    catch (const YAML::Exception& e)
+    auto result = buildGraph(tree, settings, graph);
+    if (result.failed())
+        return result;
+
+    graph->prepare(settings.spec);
+    publishGraph(graph, tree);
+    return juce::Result::ok();
+}
+
+void EffectChain::publishGraph(const std::shared_ptr<Graph>& graph, const juce::ValueTree& tree)
+{
+    releaseRetiredGraphs();
+
+    // Crossfade from the running graph when both can run side by side on the
+    // same buffers. The running graph stops feeding its own predecessor, so at
+    // most two graphs run at once.
+    auto current = getLiveGraph();
+    if (transitionSeconds > 0.0 && current != nullptr && current->precision == precision
+        && current->preparedSpec.numChannels == currentSpec.numChannels
+        && current->preparedSpec.sampleRate == currentSpec.sampleRate)
     {
-        return juce::Result::fail(juce::String("YAML Error: ") + e.what());
+        current->transition.cutRequested.store(true, std::memory_order_relaxed);
+
+        graph->transition.previous = current;
+        graph->transition.fadeLength = juce::jmax(1, juce::roundToInt(transitionSeconds * currentSpec.sampleRate));
+        graph->transition.maxLength = juce::jmax(graph->transition.fadeLength,
+                                                 juce::roundToInt(maxTransitionSeconds * currentSpec.sampleRate));
+        graph->prepareTransition(currentSpec);
     }
-    catch (...)
+
+    // Every graph that may become active is freed on the message thread
+    publishedGraphs.push_back(graph);
+
+    liveGraph.store(graph.get());
+    currentConfig = tree.createCopy();
+}
+
+juce::Result EffectChain::loadFromSource(const juce::String& source,
+                                         const std::function<bool()>& shouldCancel,
+                                         const std::function<void(LoadStage)>& onStage,
+                                         int* loadedProgram)
+{
+    if (onStage)
+        onStage(LoadStage::Parsing);
+
+    return loadFromParsedPreset(parseSource(source), shouldCancel, onStage, loadedProgram);
+}
+
+juce::Result EffectChain::loadFromParsedPreset(std::shared_ptr<const ParsedPreset> parsed,
+                                               const std::function<bool()>& shouldCancel,
+                                               const std::function<void(LoadStage)>& onStage,
+                                               int* loadedProgram)
+{
+    auto isCancelled = [&shouldCancel] { return shouldCancel && shouldCancel(); };
+    auto report = [&onStage](LoadStage stage) { if (onStage) onStage(stage); };
+    const auto cancelled = juce::Result::fail("Load cancelled");
+
+    if (parsed == nullptr)
+        return juce::Result::fail("Failed to parse preset.");
+
+    if (parsed->error.isNotEmpty())
+        return juce::Result::fail(parsed->error);
+
+    // Build and prepare without the update lock, so a load on a background
+    // thread doesn't hold up the message thread
+    if (isCancelled())
+        return cancelled;
+
+    report(LoadStage::Building);
+    auto settings = getBuildSettings();
+    std::shared_ptr<Graph> graph;
+
+    auto result = buildGraph(parsed->tree, settings, graph);
+    if (result.failed())
+        return result;
+
+    if (isCancelled())
+        return cancelled;
+
+    report(LoadStage::Preparing);
+    graph->prepare(settings.spec);
+
+    if (isCancelled())
+        return cancelled;
+
+    report(LoadStage::Publishing);
+    juce::ScopedLock sl(updateLock);
+
+    // The host changed the processing setup while this was building
+    if (!(getBuildSettings() == settings))
     {
-        return juce::Result::fail("Unknown error parsing YAML.");
+        settings = getBuildSettings();
+
+        result = buildGraph(parsed->tree, settings, graph);
+        if (result.failed())
+            return result;
+
+        graph->prepare(settings.spec);
     }
+
+    publishGraph(graph, parsed->tree);
+
+    // Loading a preset replaces the current program
+    const auto program = currentProgram.load();
+    auto& slot = programs[(size_t) program];
+    slot.preset = parsed;
+    slot.estimatedBytes = estimateGraphBytes(parsed->tree, currentSpec, precision);
+    slot.lastUsed = ++programUseCounter;
+    slot.setGraph(graph);
+
+    currentPreset = std::move(parsed);
+    warmPrograms();
+
+    if (loadedProgram != nullptr)
+        *loadedProgram = program;
+
+    return juce::Result::ok();
+}
+
+std::shared_ptr<const EffectChain::ParsedPreset> EffectChain::parseSource(const juce::String& source)
+{
+    const auto trimmed = source.trim();
+
+    if (trimmed.startsWith("<"))
+        return parseXml(source);
+
+    if (trimmed.startsWith("{") || trimmed.startsWith("["))
+        return parseJson(source);
+
+    return parseYaml(source);
+}
+
+juce::Result EffectChain::parse(const juce::String& source, juce::ValueTree& result)
+{
+    const auto parsed = parseSource(source);
+    if (parsed == nullptr)
+        return juce::Result::fail("Failed to parse preset.");
+
+    if (parsed->error.isNotEmpty())
+        return juce::Result::fail(parsed->error);
+
+    // The parsed tree is shared through the cache
+    result = parsed->tree.createCopy();
+    return juce::Result::ok();
+}
+
+juce::Result EffectChain::loadFromYaml(const juce::String& yamlString)
+{
+    return loadFromParsedPreset(parseYaml(yamlString));
 }
 
 juce::Result EffectChain::loadFromJson(const juce::String& jsonString)
 {
-    auto result = juce::JSON::parse(jsonString);
-    if (result.isArray())
+    return loadFromParsedPreset(parseJson(jsonString));
+}
+
+juce::Result EffectChain::loadFromXml(const juce::String& xmlString)
+{
+    return loadFromParsedPreset(parseXml(xmlString));
+}
+
+std::shared_ptr<const EffectChain::ParsedPreset> EffectChain::parseYaml(const juce::String& yamlString)
+{
+    return getParsedPreset("Yaml", yamlString, [&yamlString]
+    {
+        auto parsed = std::make_unique<ParsedPreset>();
+
+        try {
+            YAML::Node root = YAML::Load(yamlString.toStdString());
+
+            if (!root.IsSequence())
+            {
+                parsed->error = "YAML root must be a sequence/list.";
+                return parsed;
+            }
+
+            juce::ValueTree chain("Chain");
+            for (const auto& node : root)
+            {
+                if (node["type"] || node["send"])
+                {
+                    chain.addChild(yamlToValueTree(node), -1, nullptr);
+                }
+            }
+
+            parsed->tree = chain;
+        }
+        catch (const YAML::Exception& e)
+        {
+            parsed->error = juce::String("YAML Error: ") + e.what();
+        }
+        catch (...)
+        {
+            parsed->error = "Unknown error parsing YAML.";
+        }
+
+        return parsed;
+    });
+}
+
+std::shared_ptr<const EffectChain::ParsedPreset> EffectChain::parseJson(const juce::String& jsonString)
+{
+    return getParsedPreset("Json", jsonString, [&jsonString]
     {
-        juce::ValueTree chain("Chain");
-        for (int i = 0; i < result.size(); ++i)
+        auto parsed = std::make_unique<ParsedPreset>();
+
+        auto result = juce::JSON::parse(jsonString);
+        if (result.isArray())
         {
-            auto item = result[i];
-            if (item.isObject())
+            juce::ValueTree chain("Chain");
+            for (int i = 0; i < result.size(); ++i)
             {
-                juce::ValueTree effectTree("Effect");
-                auto* obj = item.getDynamicObject();
-                auto props = obj->getProperties();
-                for (auto& prop : props)
+                auto item = result[i];
+                if (item.isObject())
                 {
-                    effectTree.setProperty(prop.name, prop.value, nullptr);
+                    juce::ValueTree effectTree("Effect");
+                    auto* obj = item.getDynamicObject();
+                    auto props = obj->getProperties();
+                    for (auto& prop : props)
+                    {
+                        effectTree.setProperty(prop.name, prop.value, nullptr);
+                    }
+                    chain.addChild(effectTree, -1, nullptr);
                 }
-                chain.addChild(effectTree, -1, nullptr);
             }
+            parsed->tree = chain;
         }
-        return loadFromValueTree(chain);
-    }
-    return juce::Result::fail("JSON must be an array.");
+        else
+        {
+            parsed->error = "JSON must be an array.";
+        }
+
+        return parsed;
+    });
 }
 
-juce::Result EffectChain::loadFromXml(const juce::String& xmlString)
+std::shared_ptr<const EffectChain::ParsedPreset> EffectChain::parseXml(const juce::String& xmlString)
 {
-    auto xml = juce::XmlDocument::parse(xmlString);
-    if (xml)
+    return getParsedPreset("Xml", xmlString, [&xmlString]
     {
-        auto tree = juce::ValueTree::fromXml(*xml);
-        if (tree.isValid())
+        auto parsed = std::make_unique<ParsedPreset>();
+        parsed->error = "Failed to parse XML.";
+
+        auto xml = juce::XmlDocument::parse(xmlString);
+        if (xml)
         {
-            return loadFromValueTree(tree);
+            auto tree = juce::ValueTree::fromXml(*xml);
+            if (tree.isValid())
+            {
+                parsed->tree = tree;
+                parsed->error = {};
+            }
         }
-    }
-    return juce::Result::fail("Failed to parse XML.");
+
+        return parsed;
+    });
 }
@@ -2,7 +2,13 @@
 
 #include <juce_core/juce_core.h>
 #include <juce_dsp/juce_dsp.h>
+#include <juce_audio_basics/juce_audio_basics.h>
 #include "AudioEffect.h"
+#include "NodeSentinel.h"
+#include "NodeMeter.h"
+#include "DspScheduler.h"
+#include <array>
+#include <functional>
 #include <vector>
 #include <memory>
 #include <atomic>
@@ -14,10 +20,92 @@ public:
     EffectChain();
     ~EffectChain();
 
+    enum class Precision { Single, Double };
+
     void prepare(const juce::dsp::ProcessSpec& spec);
-    void process(juce::AudioBuffer<float>& buffer);
+    // sidechain: the host's sidechain bus, read by nodes with "key: sidechain"
+    void process(juce::AudioBuffer<float>& buffer, const juce::dsp::AudioBlock<const float>& sidechain = {});
+    void process(juce::AudioBuffer<double>& buffer, const juce::dsp::AudioBlock<const double>& sidechain = {});
     void reset();
 
+    // Samples the live graph delays the main path by (lookahead, compensated
+    // parallel branches), for AudioProcessor::setLatencySamples(). Changes
+    // when a preset or program is published or the chain is prepared. Bus
+    // returns are not delay-compensated.
+    int getLatencySamples() const;
+
+    // Precision used by nodes that don't set "precision" themselves; should match the host
+    void setPrecision(Precision newPrecision);
+    Precision getPrecision() const { return precision; }
+
+    // Named layout of the bus (5.1, 7.1.4, ambisonics...), used to resolve
+    // "channels: [L, R]" on nodes. Defaults to the canonical layout for the width.
+    void setChannelLayout(const juce::AudioChannelSet& newLayout);
+    juce::AudioChannelSet getChannelLayout() const;
+
+    // Relative "file:" paths in presets (impulse responses) resolve against
+    // this directory: the preset's own folder when it was read from a file.
+    // Applies to presets loaded afterwards.
+    void setFileDirectory(const juce::File& directory);
+    juce::File getFileDirectory() const;
+
+    // Runs long host blocks through the graph in slices of this many samples
+    // (e.g. 64-256) to keep effect state in cache; 0 disables slicing.
+    void setSubBlockSize(int newSubBlockSize);
+    int getSubBlockSize() const { return subBlockSize; }
+
+    // Scans every effect's output for denormals and NaN/Inf, repairs the block
+    // and resets (or briefly bypasses) the node. Reports come out of
+    // popSentinelEvent() on the message thread.
+    void setSentinelEnabled(bool shouldBeEnabled) { sentinel.setEnabled(shouldBeEnabled); }
+    bool isSentinelEnabled() const { return sentinel.isEnabled(); }
+    bool popSentinelEvent(NodeSentinel::Event& event) { return sentinel.pop(event); }
+
+    // Peak, RMS, loudness and true-peak meters on effect outputs, numbered like
+    // sentinel reports ("Delay #3" is effect 3). Only subscribed effects measure.
+    NodeMeters& getMeters() { return meters; }
+
+    // Program bank. Each slot holds a preset, and while it fits the memory
+    // budget also a fully built and prepared graph, so selecting it is a pointer
+    // swap. The current program and then the most recently used ones stay warm;
+    // the rest are built when selected. Loading a preset replaces the current
+    // program.
+    static constexpr int maxPrograms = 16;
+
+    juce::Result setProgram(int index, const juce::String& source);   // YAML, JSON or XML; empty for an empty slot
+    juce::Result selectProgram(int index);                              // message thread; builds a cold slot
+    bool selectWarmProgram(int index);                                  // audio thread; false when the slot is cold
+    int getCurrentProgram() const { return currentProgram.load(); }
+    bool isProgramWarm(int index) const;
+    void setProgramMemoryBudget(size_t bytes);
+
+    // Loading a preset while audio runs crossfades from the old graph to the new
+    // one over crossfadeSeconds (0 switches instantly). The old graph keeps
+    // running until its tail has decayed, for at most maxTailSeconds.
+    void setTransition(double crossfadeSeconds, double maxTailSeconds);
+
+    // Message thread: frees graphs that no longer play: the one a finished
+    // transition replaced, and programs switched away from or evicted. Loading
+    // a preset also does this.
+    void releaseRetiredGraphs();
+
+    enum class LoadStage { Parsing, Building, Preparing, Publishing };
+
+    // Loads a YAML, JSON or XML preset. Parsing, building and preparing run
+    // without the update lock, so this can run on a loader thread; only the
+    // final swap takes it. The load stops between stages once shouldCancel()
+    // returns true, and onStage is called (on this thread) as each stage starts.
+    // On success, loadedProgram receives the program slot the preset replaced:
+    // the one current at the swap, which a MIDI program change may have moved
+    // since the load began.
+    juce::Result loadFromSource(const juce::String& source,
+                                const std::function<bool()>& shouldCancel = {},
+                                const std::function<void(LoadStage)>& onStage = {},
+                                int* loadedProgram = nullptr);
+
+    // Parses a YAML, JSON or XML preset into the tree loadFromValueTree() takes
+    static juce::Result parse(const juce::String& source, juce::ValueTree& result);
+
     // Rebuilds the chain from a YAML string
     juce::Result loadFromYaml(const juce::String& yamlString);
 
@@ -30,20 +118,120 @@ public:
     // Core loader: Rebuilds the chain from a JUCE ValueTree
     juce::Result loadFromValueTree(const juce::ValueTree& tree);
 
-    // Helper to create effect by type name
-    static std::unique_ptr<AudioEffect> createEffect(const std::string& type);
+    // Helper to create effect by type name. Returns nullptr for unknown types, and
+    // for double precision when the effect only has a single-precision implementation.
+    template <typename SampleType = float>
+    static std::unique_ptr<AudioEffectBase<SampleType>> createEffect(const std::string& type);
 
     struct Node;
+    struct Graph;
+    struct ParsedPreset;
 
     juce::ValueTree getCurrentConfig() const { return currentConfig; }
 
+    // The number the live graph gave the effect at this node of
+    // getCurrentConfig(), as in "Delay #3" and NodeMeters; 0 when the node
+    // built no effect (groups, unknown types, a selection matching no channel)
+    int getEffectNumber(const juce::ValueTree& node) const;
+
 private:
     using NodePtr = std::unique_ptr<Node>;
 
-    // Simple double buffering approach for thread safety without locking audio thread
-    std::shared_ptr<Node> activeRoot;
+    // Parsed through the SharedResourceCache
+    static std::shared_ptr<const ParsedPreset> parseYaml(const juce::String& yamlString);
+    static std::shared_ptr<const ParsedPreset> parseJson(const juce::String& jsonString);
+    static std::shared_ptr<const ParsedPreset> parseXml(const juce::String& xmlString);
+    static std::shared_ptr<const ParsedPreset> parseSource(const juce::String& source);
+
+    // Loads a preset parsed through the SharedResourceCache and keeps it alive while in use
+    juce::Result loadFromParsedPreset(std::shared_ptr<const ParsedPreset> parsed,
+                                      const std::function<bool()>& shouldCancel = {},
+                                      const std::function<void(LoadStage)>& onStage = {},
+                                      int* loadedProgram = nullptr);
+
+    // Everything a built graph depends on besides the preset
+    struct BuildSettings
+    {
+        juce::dsp::ProcessSpec spec;
+        Precision precision;
+        juce::AudioChannelSet layout;
+        int subBlockSize;
+        juce::File fileDirectory;
+
+        bool operator== (const BuildSettings& other) const
+        {
+            return spec.sampleRate == other.spec.sampleRate && spec.maximumBlockSize == other.spec.maximumBlockSize
+                && spec.numChannels == other.spec.numChannels && precision == other.precision
+                && layout == other.layout && subBlockSize == other.subBlockSize
+                && fileDirectory == other.fileDirectory;
+        }
+    };
+
+    BuildSettings getBuildSettings() const;
+
+    // Builds a graph without preparing or publishing it. Takes no lock.
+    juce::Result buildGraph(const juce::ValueTree& tree, const BuildSettings& settings, std::shared_ptr<Graph>& result);
+
+    // Swaps a prepared graph in, crossfading from the running one; update lock held
+    void publishGraph(const std::shared_ptr<Graph>& graph, const juce::ValueTree& tree);
+
+    // Rebuilds the active graph and the warm programs after a settings change
+    void rebuildGraphs();
+
+    void warmPrograms();
+    void swapInProgram(int index, Graph* graph);
+
+    // Declared before the graph so nodes never outlive them
+    NodeSentinel sentinel;
+    NodeMeters meters;
+
+    // Workers shared with every other chain in the process; parallel groups
+    // with heavy branches spread them across it
+    juce::SharedResourcePointer<DspScheduler> scheduler;
+
+    // The graph the audio thread runs. The audio thread only sees raw
+    // pointers, so it never touches a reference count or the lock that
+    // std::atomic_load() on a shared_ptr takes; publishedGraphs owns the graphs.
+    std::atomic<Graph*> liveGraph { nullptr };
+
+    // Odd while the audio thread is inside process() or selectWarmProgram().
+    // A graph it may have picked up is only freed once it has left that call.
+    std::atomic<juce::uint32> audioEpoch { 0 };
+
+    // Graphs that may be or have been live; freed by releaseRetiredGraphs()
+    // once nothing else holds them, so the audio thread never frees a graph
+    std::vector<std::shared_ptr<Graph>> publishedGraphs;
+
+    // Message thread: the owner of liveGraph
+    std::shared_ptr<Graph> getLiveGraph() const;
+
+    struct ProgramSlot
+    {
+        std::shared_ptr<const ParsedPreset> preset;    // message thread only
+        std::shared_ptr<Graph> graph;                  // warm graph, or null; message thread only
+        std::atomic<Graph*> warmGraph { nullptr };     // the same graph, for the audio thread
+        size_t estimatedBytes = 0;
+        juce::uint32 lastUsed = 0;
+
+        void setGraph(std::shared_ptr<Graph> newGraph)
+        {
+            graph = std::move(newGraph);
+            warmGraph.store(graph.get());
+        }
+    };
+
+    std::array<ProgramSlot, (size_t) maxPrograms> programs;
+    std::atomic<int> currentProgram { 0 };
+    size_t programMemoryBudget { (size_t) 256 * 1024 * 1024 };
+    juce::uint32 programUseCounter { 0 };
 
     juce::dsp::ProcessSpec currentSpec { 44100.0, 512, 2 };
+    Precision precision { Precision::Single };
+    juce::AudioChannelSet channelLayout;
+    int subBlockSize { 0 };
+    juce::File fileDirectory;
+    double transitionSeconds { 0.0 };
+    double maxTransitionSeconds { 0.0 };
 
     // Lock only for updating the config (write side), not for reading in process
     juce::CriticalSection updateLock;
@@ -52,4 +240,5 @@ private:
 
 private:
     juce::ValueTree currentConfig;
+    std::shared_ptr<const ParsedPreset> currentPreset;
 };
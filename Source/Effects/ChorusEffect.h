@@ -1,42 +1,144 @@
 #pragma once
 #include "../AudioEffect.h"
+#include "Ensemble.h"
+#include <algorithm>
 
-class ChorusEffect : public AudioEffect
+template <typename SampleType = float>
+class ChorusEffect : public AudioEffectBase<SampleType>
 {
 public:
+    using AudioEffectBase<SampleType>::getParameterValue;
+    using AudioEffectBase<SampleType>::processInChunks;
+
     void prepare(const juce::dsp::ProcessSpec& spec) override
     {
+        processSpec = spec;
         chorus.prepare(spec);
+
+        if (ensemble)
+            ensemble->prepare(spec);
     }
 
-    void process(const juce::dsp::ProcessContextReplacing<float>& context) override
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) override
     {
-        chorus.process(context);
+        const auto gliding = std::any_of(ramps.begin(), ramps.end(), [](const auto& r) { return r.isGliding(); });
+
+        processInChunks(context, gliding,
+                        [this](int numSamples) { advanceRamps(numSamples); },
+                        [this](const auto& chunk)
+                        {
+                            if (ensemble)
+                                ensemble->process(chunk);
+                            else
+                                chorus.process(chunk);
+                        });
     }
 
     void reset() override
     {
         chorus.reset();
+
+        if (ensemble)
+            ensemble->reset();
     }
 
     void configure(const juce::ValueTree& config) override
     {
+        // "mode: ensemble" selects the multi-voice engine, anything else juce::dsp::Chorus
+        if (config.hasProperty("mode"))
+        {
+            if (!config.getProperty("mode").toString().equalsIgnoreCase("ensemble"))
+                ensemble.reset();
+            else if (!ensemble)
+                createEnsemble();
+        }
+
+        if (config.hasProperty("voices"))
+            ensembleParams.voices = (int) config.getProperty("voices");
+
+        if (config.hasProperty("spread"))
+            ensembleParams.spread = (SampleType) (float) config.getProperty("spread");
+
         if (config.hasProperty("rate") || config.getChildWithName("rate").isValid())
-            chorus.setRate(getParameterValue(config, "rate", 1.0f));
+            chorus.setRate(ensembleParams.rate = getParameterValue(config, "rate", 1.0f));
             
         if (config.hasProperty("depth") || config.getChildWithName("depth").isValid())
-            chorus.setDepth(getParameterValue(config, "depth", 0.25f));
+            chorus.setDepth(ensembleParams.depth = getParameterValue(config, "depth", 0.25f));
             
         if (config.hasProperty("delay") || config.getChildWithName("delay").isValid())
-            chorus.setCentreDelay(getParameterValue(config, "delay", 7.0f));
+            chorus.setCentreDelay(ensembleParams.centreDelayMs = getParameterValue(config, "delay", 7.0f));
             
         if (config.hasProperty("feedback") || config.getChildWithName("feedback").isValid())
-            chorus.setFeedback(getParameterValue(config, "feedback", 0.0f));
+            chorus.setFeedback(ensembleParams.feedback = getParameterValue(config, "feedback", 0.0f));
             
         if (config.hasProperty("mix") || config.getChildWithName("mix").isValid())
-            chorus.setMix(getParameterValue(config, "mix", 0.5f));
+            chorus.setMix(ensembleParams.mix = getParameterValue(config, "mix", 0.5f));
+
+        if (ensemble)
+            ensemble->setParameters(ensembleParams);
+
+        ramps[(size_t) Target::rate].setValue((float) ensembleParams.rate);
+        ramps[(size_t) Target::depth].setValue((float) ensembleParams.depth);
+        ramps[(size_t) Target::delay].setValue((float) ensembleParams.centreDelayMs);
+        ramps[(size_t) Target::feedback].setValue((float) ensembleParams.feedback);
+        ramps[(size_t) Target::mix].setValue((float) ensembleParams.mix);
+    }
+
+    ModulationTarget getModulationTarget(const juce::Identifier& id) const override
+    {
+        // The ranges juce::dsp::Chorus accepts
+        if (id == juce::Identifier("rate"))     return { (int) Target::rate, 0.0f, 99.0f };
+        if (id == juce::Identifier("depth"))    return { (int) Target::depth, 0.0f, 1.0f };
+        if (id == juce::Identifier("delay"))    return { (int) Target::delay, 1.0f, 99.0f };
+        if (id == juce::Identifier("feedback")) return { (int) Target::feedback, -1.0f, 1.0f };
+        if (id == juce::Identifier("mix"))      return { (int) Target::mix, 0.0f, 1.0f };
+        return {};
+    }
+
+    // The processors take the ramps' values every ParameterRamp::controlChunk samples
+    void setModulatedParameter(int index, float value, int rampSamples) override
+    {
+        ramps[(size_t) index].glideTo(value, rampSamples);
     }
 
 private:
-    juce::dsp::Chorus<float> chorus;
+    enum class Target { rate, depth, delay, feedback, mix, count };
+
+    void advanceRamps(int numSamples)
+    {
+        for (size_t i = 0; i < ramps.size(); ++i)
+            if (ramps[i].isGliding())
+                apply((Target) i, (SampleType) ramps[i].advance(numSamples));
+
+        if (ensemble)
+            ensemble->setParameters(ensembleParams);
+    }
+
+    void apply(Target target, SampleType value)
+    {
+        switch (target)
+        {
+            case Target::rate:     chorus.setRate(ensembleParams.rate = value); break;
+            case Target::depth:    chorus.setDepth(ensembleParams.depth = value); break;
+            case Target::delay:    chorus.setCentreDelay(ensembleParams.centreDelayMs = value); break;
+            case Target::feedback: chorus.setFeedback(ensembleParams.feedback = value); break;
+            case Target::mix:      chorus.setMix(ensembleParams.mix = value); break;
+            case Target::count:    break;
+        }
+    }
+
+    void createEnsemble()
+    {
+        ensemble = std::make_unique<EnsembleChorus<SampleType>>();
+        ensemble->setParameters(ensembleParams);
+
+        if (processSpec.sampleRate > 0.0)
+            ensemble->prepare(processSpec);
+    }
+
+    juce::dsp::Chorus<SampleType> chorus;
+    std::unique_ptr<EnsembleChorus<SampleType>> ensemble;
+    typename EnsembleChorus<SampleType>::Parameters ensembleParams;
+    juce::dsp::ProcessSpec processSpec {};
+    std::array<ParameterRamp, (size_t) Target::count> ramps;
 };
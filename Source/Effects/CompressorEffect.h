@@ -1,34 +1,59 @@
 #pragma once
 #include "../AudioEffect.h"
+#include "DynamicsCore.h"
 
-class CompressorEffect : public AudioEffect
+template <typename SampleType = float>
+class CompressorEffect : public AudioEffectBase<SampleType>
 {
 public:
+    using AudioEffectBase<SampleType>::getParameterValue;
+
     void prepare(const juce::dsp::ProcessSpec& spec) override
     {
         compressor.prepare(spec);
+        detector.prepare(spec);
     }
 
-    void process(const juce::dsp::ProcessContextReplacing<float>& context) override
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) override
     {
-        compressor.process(context);
+        const auto& block = context.getOutputBlock();
+
+        if (context.usesSeparateInputAndOutputBlocks())
+            block.copyFrom(context.getInputBlock());
+
+        if (context.isBypassed)
+            return;
+
+        // Sidechain or filtered key: one detector, same gain on every channel
+        if (detector.isActive())
+            compressor.process(block, detector.compute(block));
+        else
+            compressor.process(block);
     }
 
     void reset() override
     {
         compressor.reset();
+        detector.reset();
     }
 
+    int getMaximumChannels() const override { return Dynamics::Core<SampleType>::maxChannels; }
+    int getLatencySamples() const override { return compressor.getLatencySamples(); }
 
+    bool wantsSidechain() const override { return detector.wantsSidechain(); }
+    void setSidechain(const juce::dsp::AudioBlock<const SampleType>& key) override { detector.setSidechain(key); }
 
     void configure(const juce::ValueTree& config) override
     {
-        if (config.hasProperty("threshold")) compressor.setThreshold(config.getProperty("threshold"));
-        if (config.hasProperty("ratio")) compressor.setRatio(config.getProperty("ratio"));
-        if (config.hasProperty("attack")) compressor.setAttack(config.getProperty("attack"));
-        if (config.hasProperty("release")) compressor.setRelease(config.getProperty("release"));
+        if (config.hasProperty("threshold")) compressor.setThreshold((SampleType) (double) config.getProperty("threshold"));
+        if (config.hasProperty("ratio"))     compressor.setRatio((SampleType) (double) config.getProperty("ratio"));
+        if (config.hasProperty("attack"))    compressor.setAttack((SampleType) (double) config.getProperty("attack"));
+        if (config.hasProperty("release"))   compressor.setRelease((SampleType) (double) config.getProperty("release"));
+        compressor.configure(config);
+        detector.configure(config);
     }
 
 private:
-    juce::dsp::Compressor<float> compressor;
+    Dynamics::Core<SampleType> compressor { Dynamics::Curve::Compressor };
+    Dynamics::KeyDetector<SampleType> detector;
 };
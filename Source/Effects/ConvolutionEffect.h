@@ -0,0 +1,617 @@
+#pragma once
+#include "../AudioEffect.h"
+#include "ImpulseResponseCache.h"
+#include "../DspScheduler.h"
+#include <atomic>
+
+/**
+ * The overlap-save steps shared by the head and tail convolvers. A segment is
+ * the previous partition of input followed by the current one; the sum of the
+ * recent segments' spectra times the impulse partitions, transformed back,
+ * gives the current partition of output.
+ */
+namespace OverlapSave
+{
+    using Spectrum = PartitionedImpulse::Spectrum;
+
+    inline void forward(juce::dsp::FFT& fft, std::vector<float>& fftData,
+                        const float* previous, const float* current, int partitionSize, Spectrum& spectrum)
+    {
+        std::fill(fftData.begin(), fftData.end(), 0.0f);
+        std::copy(previous, previous + partitionSize, fftData.begin());
+        std::copy(current, current + partitionSize, fftData.begin() + partitionSize);
+
+        fft.performRealOnlyForwardTransform(fftData.data(), true);
+
+        for (int k = 0; k <= partitionSize; ++k)
+            spectrum[(size_t) k] = { fftData[(size_t) (2 * k)], fftData[(size_t) (2 * k + 1)] };
+    }
+
+    // Adds the delay line's spectra, newest first, times the partitions from first on
+    inline void accumulate(Spectrum& sum, const std::vector<Spectrum>& delayLine, int newest,
+                           const std::vector<Spectrum>& partitions, int first)
+    {
+        const auto length = (int) delayLine.size();
+        const auto numBins = sum.size();
+
+        for (int p = first; p < (int) partitions.size(); ++p)
+        {
+            const auto& x = delayLine[(size_t) ((newest - (p - first) + length) % length)];
+            const auto& h = partitions[(size_t) p];
+            for (size_t k = 0; k < numBins; ++k)
+                sum[k] += x[k] * h[k];
+        }
+    }
+
+    // Returns the partitionSize output samples, which live in fftData
+    inline const float* inverse(juce::dsp::FFT& fft, std::vector<float>& fftData, const Spectrum& sum, int partitionSize)
+    {
+        for (int k = 0; k <= partitionSize; ++k)
+        {
+            fftData[(size_t) (2 * k)] = sum[(size_t) k].real();
+            fftData[(size_t) (2 * k + 1)] = sum[(size_t) k].imag();
+        }
+
+        fft.performRealOnlyInverseTransform(fftData.data());
+        return fftData.data() + partitionSize;
+    }
+}
+
+/**
+ * Zero-latency uniformly partitioned convolver for the head of a
+ * PartitionedImpulse, run on the audio thread.
+ *
+ * Every call transforms the partition collected so far, zero-padded, so its
+ * output is ready without waiting for the partition to fill. The older
+ * partitions' share of that output is summed once per partition. Everything
+ * is set up in prepare(), so the first block after it already plays the head.
+ */
+class HeadConvolver
+{
+public:
+    void prepare(std::shared_ptr<const PartitionedImpulse> newImpulse, int numChannelsToUse)
+    {
+        impulse = std::move(newImpulse);
+        active = impulse != nullptr && impulse->getNumHeadPartitions() > 0;
+        if (!active)
+            return;
+
+        partitionSize = PartitionedImpulse::headPartitionSize;
+        numPartitions = impulse->getNumHeadPartitions();
+        numChannels = numChannelsToUse;
+
+        const auto fftSize = 2 * partitionSize;
+        fft = std::make_unique<juce::dsp::FFT>(juce::roundToInt(std::log2((double) fftSize)));
+
+        channels.clear();
+        channels.resize((size_t) numChannels);
+        for (auto& c : channels)
+        {
+            c.current.assign((size_t) partitionSize, 0.0f);
+            c.previous.assign((size_t) partitionSize, 0.0f);
+            c.spectrum.assign((size_t) partitionSize + 1, {});
+            c.history.assign((size_t) partitionSize + 1, {});
+            c.delayLine.assign((size_t) numPartitions, PartitionedImpulse::Spectrum((size_t) partitionSize + 1));
+        }
+
+        fftData.assign((size_t) (2 * fftSize), 0.0f);
+        accumulator.assign((size_t) partitionSize + 1, {});
+
+        position = 0;
+        delayLineIndex = 0;
+    }
+
+    void reset()
+    {
+        if (!active)
+            return;
+
+        for (auto& c : channels)
+        {
+            std::fill(c.current.begin(), c.current.end(), 0.0f);
+            std::fill(c.previous.begin(), c.previous.end(), 0.0f);
+            std::fill(c.history.begin(), c.history.end(), std::complex<float>());
+            for (auto& spectrum : c.delayLine)
+                std::fill(spectrum.begin(), spectrum.end(), std::complex<float>());
+        }
+
+        position = 0;
+        delayLineIndex = 0;
+    }
+
+    /** Replaces output with the head response of input. Called on the audio thread. */
+    void process(const juce::dsp::AudioBlock<const float>& input, juce::dsp::AudioBlock<float>& output)
+    {
+        const auto channelsToProcess = active ? juce::jmin(numChannels, (int) input.getNumChannels(), (int) output.getNumChannels()) : 0;
+
+        for (auto ch = (size_t) channelsToProcess; ch < output.getNumChannels(); ++ch)
+            output.getSingleChannelBlock(ch).clear();
+
+        if (!active)
+            return;
+
+        const auto numSamples = (int) input.getNumSamples();
+
+        int done = 0;
+        while (done < numSamples)
+        {
+            const auto chunk = juce::jmin(numSamples - done, partitionSize - position);
+
+            for (int ch = 0; ch < channelsToProcess; ++ch)
+            {
+                auto& c = channels[(size_t) ch];
+                const auto& partitions = getPartitions(ch);
+
+                juce::FloatVectorOperations::copy(c.current.data() + position, input.getChannelPointer((size_t) ch) + done, chunk);
+                OverlapSave::forward(*fft, fftData, c.previous.data(), c.current.data(), partitionSize, c.spectrum);
+
+                std::copy(c.history.begin(), c.history.end(), accumulator.begin());
+                for (size_t k = 0; k < accumulator.size(); ++k)
+                    accumulator[k] += c.spectrum[k] * partitions.front()[k];
+
+                const auto* result = OverlapSave::inverse(*fft, fftData, accumulator, partitionSize);
+                juce::FloatVectorOperations::copy(output.getChannelPointer((size_t) ch) + done, result + position, chunk);
+            }
+
+            position += chunk;
+            done += chunk;
+
+            if (position == partitionSize)
+            {
+                advance(channelsToProcess);
+                position = 0;
+            }
+        }
+    }
+
+private:
+    struct Channel
+    {
+        std::vector<float> current, previous;
+        PartitionedImpulse::Spectrum spectrum;    // of the segment ending in current
+        PartitionedImpulse::Spectrum history;     // older segments' share of the next output
+        std::vector<PartitionedImpulse::Spectrum> delayLine;
+    };
+
+    const std::vector<PartitionedImpulse::Spectrum>& getPartitions(int channel) const
+    {
+        return impulse->headPartitions[(size_t) juce::jmin(channel, impulse->numChannels - 1)];
+    }
+
+    // A partition is complete: file its segment and sum what the next one owes to the past
+    void advance(int channelsToAdvance)
+    {
+        for (int ch = 0; ch < channelsToAdvance; ++ch)
+        {
+            auto& c = channels[(size_t) ch];
+
+            std::swap(c.delayLine[(size_t) delayLineIndex], c.spectrum);
+            std::fill(c.history.begin(), c.history.end(), std::complex<float>());
+            OverlapSave::accumulate(c.history, c.delayLine, delayLineIndex, getPartitions(ch), 1);
+
+            std::swap(c.previous, c.current);
+            std::fill(c.current.begin(), c.current.end(), 0.0f);
+        }
+
+        delayLineIndex = (delayLineIndex + 1) % numPartitions;
+    }
+
+    std::shared_ptr<const PartitionedImpulse> impulse;
+    bool active = false;
+    int partitionSize = 0;
+    int numPartitions = 0;
+    int numChannels = 0;
+    int position = 0;
+    int delayLineIndex = 0;
+
+    std::vector<Channel> channels;
+    std::unique_ptr<juce::dsp::FFT> fft;
+    std::vector<float> fftData;
+    PartitionedImpulse::Spectrum accumulator;
+};
+
+/**
+ * Uniformly partitioned overlap-save convolver for the tail of a
+ * PartitionedImpulse, with the heavy lifting done on the shared DspScheduler.
+ *
+ * The audio thread only collects input and plays back results. Each time a full
+ * partition of input has been collected it is handed to a worker, and the
+ * result of the previous hand-off is picked up. Because the tail starts two
+ * partitions into the impulse, the worker gets one full partition period to
+ * finish, and the output lines up sample-accurately with the head convolver.
+ *
+ * When the worker misses that deadline the audio thread never waits for it.
+ * The new partition of input is kept, and the tail is silent for the periods
+ * whose results came late. Those results are discarded. At the next hand-off
+ * the worker runs the kept partition and the new one back to back, so no
+ * input is lost and the tail carries on in step. If it misses two hand-offs
+ * in a row, the oldest kept partition has to go. The worker then clears its
+ * history before the next block, so the tail restarts from the newest input
+ * rather than playing out of step.
+ */
+class TailConvolver
+{
+public:
+    ~TailConvolver()
+    {
+        waitForWorker();
+    }
+
+    void prepare(std::shared_ptr<const PartitionedImpulse> newImpulse, int numChannelsToUse, double newSampleRate)
+    {
+        waitForWorker();
+
+        impulse = std::move(newImpulse);
+        active = impulse != nullptr && impulse->getNumTailPartitions() > 0;
+        if (!active)
+            return;
+
+        partitionSize = impulse->tailPartitionSize;
+        numPartitions = impulse->getNumTailPartitions();
+        numChannels = numChannelsToUse;
+
+        const auto fftSize = 2 * partitionSize;
+        fft = std::make_unique<juce::dsp::FFT>(juce::roundToInt(std::log2((double) fftSize)));
+
+        channels.clear();
+        channels.resize((size_t) numChannels);
+        for (auto& c : channels)
+        {
+            c.collecting.assign((size_t) partitionSize, 0.0f);
+            c.playing.assign((size_t) partitionSize, 0.0f);
+            c.workerInput.assign((size_t) partitionSize, 0.0f);
+            c.workerOutput.assign((size_t) partitionSize, 0.0f);
+            c.pendingInput.assign((size_t) partitionSize, 0.0f);
+            c.workerPending.assign((size_t) partitionSize, 0.0f);
+            c.previousInput.assign((size_t) partitionSize, 0.0f);
+            c.delayLine.assign((size_t) numPartitions, PartitionedImpulse::Spectrum((size_t) partitionSize + 1));
+        }
+
+        fftData.assign((size_t) (2 * fftSize), 0.0f);
+        accumulator.assign((size_t) partitionSize + 1, {});
+
+        position = 0;
+        delayLineIndex = 0;
+        partitionSeconds = partitionSize / newSampleRate;
+        hasPending = restart = false;
+        busy.store(false);
+        missedDeadlines.store(0);
+    }
+
+    void reset()
+    {
+        if (!active)
+            return;
+
+        // Only touch the worker's buffers once it has finished its current block.
+        waitForWorker();
+
+        for (auto& c : channels)
+        {
+            std::fill(c.collecting.begin(), c.collecting.end(), 0.0f);
+            std::fill(c.playing.begin(), c.playing.end(), 0.0f);
+            std::fill(c.workerOutput.begin(), c.workerOutput.end(), 0.0f);
+            std::fill(c.previousInput.begin(), c.previousInput.end(), 0.0f);
+            for (auto& spectrum : c.delayLine)
+                std::fill(spectrum.begin(), spectrum.end(), std::complex<float>());
+        }
+
+        position = 0;
+        hasPending = restart = false;
+    }
+
+    /** Adds the tail response of input to output. Called on the audio thread. */
+    void process(const juce::dsp::AudioBlock<const float>& input, juce::dsp::AudioBlock<float>& output)
+    {
+        if (!active)
+            return;
+
+        const auto numSamples = (int) input.getNumSamples();
+        const auto channelsToProcess = juce::jmin(numChannels, (int) input.getNumChannels(), (int) output.getNumChannels());
+
+        int done = 0;
+        while (done < numSamples)
+        {
+            const auto chunk = juce::jmin(numSamples - done, partitionSize - position);
+
+            for (int ch = 0; ch < channelsToProcess; ++ch)
+            {
+                auto& c = channels[(size_t) ch];
+                juce::FloatVectorOperations::copy(c.collecting.data() + position, input.getChannelPointer((size_t) ch) + done, chunk);
+                juce::FloatVectorOperations::add(output.getChannelPointer((size_t) ch) + done, c.playing.data() + position, chunk);
+            }
+
+            position += chunk;
+            done += chunk;
+
+            if (position == partitionSize)
+            {
+                handOff();
+                position = 0;
+            }
+        }
+    }
+
+    int getMissedDeadlines() const { return missedDeadlines.load(); }
+
+private:
+    struct Channel
+    {
+        std::vector<float> collecting, playing;          // audio thread
+        std::vector<float> pendingInput;                  // audio thread, kept over a missed deadline
+        std::vector<float> workerInput, workerOutput;     // exchanged at hand-off
+        std::vector<float> workerPending;                 // exchanged at hand-off
+        std::vector<float> previousInput;                 // worker thread
+        std::vector<PartitionedImpulse::Spectrum> delayLine;
+    };
+
+    void handOff()
+    {
+        if (busy.load(std::memory_order_acquire))
+        {
+            // The worker missed its deadline. Keep the input rather than block
+            // the audio thread, and play silence where the late result belonged.
+            ++missedDeadlines;
+            restart = hasPending;
+            hasPending = true;
+
+            for (auto& c : channels)
+            {
+                std::swap(c.collecting, c.pendingInput);
+                std::fill(c.playing.begin(), c.playing.end(), 0.0f);
+            }
+
+            return;
+        }
+
+        // After a miss, the finished result is for a period already played
+        for (auto& c : channels)
+        {
+            if (hasPending)
+                std::fill(c.playing.begin(), c.playing.end(), 0.0f);
+            else
+                std::swap(c.playing, c.workerOutput);
+
+            std::swap(c.collecting, c.workerInput);
+
+            if (hasPending)
+                std::swap(c.pendingInput, c.workerPending);
+        }
+
+        // Only read by the worker after the store to busy below
+        workerRunsPending = hasPending;
+        workerRestarts = restart;
+        hasPending = restart = false;
+
+        busy.store(true, std::memory_order_release);
+
+        // No worker to take it (single core, or every queue full): do it here
+        if (!scheduler->submit({ &TailConvolver::runBlock, this, DspScheduler::deadlineAfter(partitionSeconds), nullptr }))
+            runBlock(this);
+    }
+
+    static void runBlock(void* context)
+    {
+        auto& self = *static_cast<TailConvolver*>(context);
+
+        if (self.workerRestarts)
+            self.clearHistory();
+
+        // The kept partition goes first; its output is too late to play and
+        // is overwritten by the new partition's
+        if (self.workerRunsPending)
+        {
+            for (auto& c : self.channels)
+                std::swap(c.workerInput, c.workerPending);
+
+            self.computeBlock();
+
+            for (auto& c : self.channels)
+                std::swap(c.workerInput, c.workerPending);
+        }
+
+        self.computeBlock();
+        self.busy.store(false, std::memory_order_release);
+    }
+
+    void clearHistory()
+    {
+        for (auto& c : channels)
+        {
+            std::fill(c.previousInput.begin(), c.previousInput.end(), 0.0f);
+            for (auto& spectrum : c.delayLine)
+                std::fill(spectrum.begin(), spectrum.end(), std::complex<float>());
+        }
+    }
+
+    void waitForWorker()
+    {
+        while (busy.load(std::memory_order_acquire))
+            juce::Thread::yield();
+    }
+
+    void computeBlock()
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto& c = channels[(size_t) ch];
+            const auto& partitions = impulse->tailPartitions[(size_t) juce::jmin(ch, impulse->numChannels - 1)];
+
+            OverlapSave::forward(*fft, fftData, c.previousInput.data(), c.workerInput.data(), partitionSize,
+                                 c.delayLine[(size_t) delayLineIndex]);
+            std::swap(c.previousInput, c.workerInput);
+
+            std::fill(accumulator.begin(), accumulator.end(), std::complex<float>());
+            OverlapSave::accumulate(accumulator, c.delayLine, delayLineIndex, partitions, 0);
+
+            const auto* result = OverlapSave::inverse(*fft, fftData, accumulator, partitionSize);
+            std::copy(result, result + partitionSize, c.workerOutput.begin());
+        }
+
+        delayLineIndex = (delayLineIndex + 1) % numPartitions;
+    }
+
+    std::shared_ptr<const PartitionedImpulse> impulse;
+    bool active = false;
+    int partitionSize = 0;
+    int numPartitions = 0;
+    int numChannels = 0;
+    int position = 0;
+    int delayLineIndex = 0;
+
+    std::vector<Channel> channels;
+    std::unique_ptr<juce::dsp::FFT> fft;
+    std::vector<float> fftData;
+    PartitionedImpulse::Spectrum accumulator;
+
+    double partitionSeconds = 0.0;
+
+    bool hasPending = false;            // audio thread
+    bool restart = false;
+    bool workerRunsPending = false;     // set at hand-off for the worker
+    bool workerRestarts = false;
+
+    std::atomic<bool> busy { false };
+    std::atomic<int> missedDeadlines { 0 };
+
+    juce::SharedResourcePointer<DspScheduler> scheduler;
+};
+
+/**
+ * Convolution reverb using a two-stage non-uniform partitioning: the head of the
+ * impulse response runs on the audio thread with zero latency, the long tail runs
+ * on the shared DSP workers. Both are ready when prepare() returns. Partitions come from the process-wide
+ * ImpulseResponseCache, so every instance using the same file shares them.
+ */
+class ConvolutionEffect : public AudioEffect
+{
+public:
+    void prepare(const juce::dsp::ProcessSpec& spec) override
+    {
+        sampleRate = spec.sampleRate;
+        numChannels = (int) spec.numChannels;
+
+        dryBuffer.setSize(numChannels, (int) spec.maximumBlockSize);
+        wetGain.prepare(spec);
+        dryGain.prepare(spec);
+        wetGain.setRampDurationSeconds(0.05);
+        dryGain.setRampDurationSeconds(0.05);
+
+        loadImpulse();
+    }
+
+    void process(const juce::dsp::ProcessContextReplacing<float>& context) override
+    {
+        auto& outputBlock = context.getOutputBlock();
+        const auto numSamples = outputBlock.getNumSamples();
+
+        juce::dsp::AudioBlock<float> dry(dryBuffer);
+        dry = dry.getSubsetChannelBlock(0, outputBlock.getNumChannels()).getSubBlock(0, numSamples);
+        dry.copyFrom(context.getInputBlock());
+
+        if (impulse != nullptr)
+        {
+            head.process(dry, outputBlock);
+            tail.process(dry, outputBlock);
+        }
+        else
+        {
+            outputBlock.clear();
+        }
+
+        wetGain.process(context);
+        juce::dsp::ProcessContextReplacing<float> dryContext(dry);
+        dryGain.process(dryContext);
+        outputBlock.add(dry);
+    }
+
+    int getMaximumChannels() const override { return 2; }
+
+    void reset() override
+    {
+        head.reset();
+        tail.reset();
+        wetGain.reset();
+        dryGain.reset();
+    }
+
+    void configure(const juce::ValueTree& config) override
+    {
+        if (config.hasProperty("file"))
+            filePath = config.getProperty("file").toString();
+
+        if (config.hasProperty("normalise"))
+            normalise = (bool) config.getProperty("normalise");
+
+        if (config.hasProperty("tail_partition"))
+            tailPartitionSize = juce::nextPowerOfTwo(juce::jlimit(256, 65536, (int) config.getProperty("tail_partition")));
+
+        if (config.hasProperty("wet") || config.getChildWithName("wet").isValid())
+            wetGain.setGainLinear(getParameterValue(config, "wet", 0.5f));
+
+        if (config.hasProperty("dry") || config.getChildWithName("dry").isValid())
+            dryGain.setGainLinear(getParameterValue(config, "dry", 1.0f));
+    }
+
+    // "file:" arrives resolved against the chain's file directory
+    juce::String getConfigurationError() const override
+    {
+        if (filePath.isEmpty())
+            return {};
+
+        if (!juce::File::isAbsolutePath(filePath))
+            return "impulse response \"" + filePath + "\" is a relative path, but no file directory is set";
+
+        const juce::File file(filePath);
+        if (!file.existsAsFile())
+            return "impulse response not found: " + file.getFullPathName();
+
+        if (!ImpulseResponseCache::canRead(file))
+            return "can't read impulse response: " + file.getFullPathName();
+
+        return {};
+    }
+
+    ModulationTarget getModulationTarget(const juce::Identifier& id) const override
+    {
+        if (id == juce::Identifier("wet")) return { 0, 0.0f, 4.0f };
+        if (id == juce::Identifier("dry")) return { 1, 0.0f, 4.0f };
+        return {};
+    }
+
+    void setModulatedParameter(int index, float value, int rampSamples) override
+    {
+        auto& gain = index == 0 ? wetGain : dryGain;
+
+        if (sampleRate > 0.0)
+            gain.setRampDurationSeconds(rampSamples / sampleRate);
+
+        gain.setGainLinear(value);
+    }
+
+private:
+    void loadImpulse()
+    {
+        impulse.reset();
+
+        if (juce::File::isAbsolutePath(filePath) && sampleRate > 0.0)
+            impulse = ImpulseResponseCache::getInstance().get(juce::File(filePath), sampleRate, tailPartitionSize, normalise);
+
+        head.prepare(impulse, numChannels);
+        tail.prepare(impulse, numChannels, sampleRate);
+    }
+
+    HeadConvolver head;
+    TailConvolver tail;
+    std::shared_ptr<const PartitionedImpulse> impulse;
+
+    juce::AudioBuffer<float> dryBuffer;
+    juce::dsp::Gain<float> wetGain;
+    juce::dsp::Gain<float> dryGain;
+
+    double sampleRate = 0.0;
+    int numChannels = 2;
+    juce::String filePath;
+    bool normalise = true;
+    int tailPartitionSize = 4096;
+};
@@ -1,80 +1,412 @@
 #pragma once
 #include "../AudioEffect.h"
+#include <array>
+#include <cmath>
+#include <vector>
 
-class DelayEffect : public AudioEffect
+/**
+ * Fractional-delay interpolators for DelayEffect ("interpolation:").
+ *
+ * Each reads a contiguous run of taps from a delay line that is mirrored past
+ * its end, so no tap read wraps. Delays are in samples: a delay of d reads
+ * x[n - d]. A delay must be at least getMinimumDelay() for the taps to stay in
+ * the past. The newest tap read is getTapsAhead() samples newer than
+ * floor(d), which bounds how far ahead a block may be read before it is
+ * written.
+ */
+namespace DelayInterpolation
 {
-public:
-    DelayEffect()
+    enum class Mode { Linear, Lagrange3, Lagrange5, Thiran, Sinc };
+
+    inline Mode fromString(const juce::String& name)
+    {
+        if (name.equalsIgnoreCase("lagrange3") || name.equalsIgnoreCase("lagrange")) return Mode::Lagrange3;
+        if (name.equalsIgnoreCase("lagrange5"))                                     return Mode::Lagrange5;
+        if (name.equalsIgnoreCase("thiran") || name.equalsIgnoreCase("allpass"))    return Mode::Thiran;
+        if (name.equalsIgnoreCase("sinc"))                                          return Mode::Sinc;
+        return Mode::Linear;
+    }
+
+    // Taps newer than the interval the fractional position falls in. Odd-order
+    // Lagrange and the sinc are centred on it, which is where they are most
+    // accurate. Thiran's integer part can sit one sample below floor(delay).
+    inline int getTapsAhead(Mode mode)
+    {
+        switch (mode)
+        {
+            case Mode::Lagrange3: return 1;
+            case Mode::Lagrange5: return 2;
+            case Mode::Sinc:      return 7;
+            case Mode::Thiran:    return 1;
+            case Mode::Linear:    return 0;
+        }
+        return 0;
+    }
+
+    inline double getMinimumDelay(Mode mode)
+    {
+        // Thiran keeps its fractional part in [0.5, 1.5) over an integer delay of at least 1
+        return mode == Mode::Thiran ? 1.5 : getTapsAhead(mode) + 1.0;
+    }
+
+    static constexpr int maxTaps = 16;
+
+    // Windowed-sinc: 16 taps, Kaiser window (beta 8), cutoff at 0.95 of
+    // Nyquist, tabulated at sincPhases fractional positions and interpolated
+    // between neighbouring phases
+    static constexpr int sincTaps = 16;
+    static constexpr int sincPhases = 256;
+
+    template <typename SampleType>
+    const std::vector<SampleType>& getSincTable()
     {
-        delayLine.setMaximumDelayInSamples(192000); // Max 2-4 seconds depending on SR
+        static const std::vector<SampleType> table = []
+        {
+            constexpr double beta = 8.0;
+            constexpr double cutoff = 0.95;
+            const auto half = sincTaps / 2;
+
+            auto besselI0 = [](double x)
+            {
+                double sum = 1.0, term = 1.0;
+                for (int k = 1; k < 32; ++k)
+                {
+                    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+                    sum += term;
+                }
+                return sum;
+            };
+
+            // Row p holds the taps, oldest first, for fraction p / sincPhases
+            std::vector<SampleType> rows((size_t) ((sincPhases + 1) * sincTaps));
+
+            for (int p = 0; p <= sincPhases; ++p)
+            {
+                const auto frac = (double) p / sincPhases;
+                std::array<double, (size_t) sincTaps> taps {};
+                double sum = 0.0;
+
+                for (int t = 0; t < sincTaps; ++t)
+                {
+                    // Tap t sits (sincTaps - 1 - t) - (half - 1) samples from the newest
+                    // centre sample; u is its distance from the read position
+                    const auto u = (double) (sincTaps - 1 - t - (half - 1)) - frac;
+                    const auto x = juce::MathConstants<double>::pi * cutoff * u;
+                    const auto sinc = std::abs(u) < 1.0e-9 ? 1.0 : std::sin(x) / x;
+                    const auto r = u / half;
+                    const auto window = std::abs(r) < 1.0 ? besselI0(beta * std::sqrt(1.0 - r * r)) / besselI0(beta) : 0.0;
+
+                    taps[(size_t) t] = sinc * window;
+                    sum += taps[(size_t) t];
+                }
+
+                // Unity gain at DC for every phase
+                for (int t = 0; t < sincTaps; ++t)
+                    rows[(size_t) (p * sincTaps + t)] = (SampleType) (taps[(size_t) t] / sum);
+            }
+
+            return rows;
+        }();
+
+        return table;
     }
 
+    // Lagrange weights, oldest tap first, for a read position `delta` samples
+    // behind the newest tap (delta in [tapsAhead, tapsAhead + 1))
+    template <int Order, typename SampleType>
+    inline void lagrangeWeights(SampleType delta, SampleType* weights)
+    {
+        for (int t = 0; t <= Order; ++t)
+        {
+            const auto k = Order - t;     // tap t is k samples behind the newest
+            SampleType w = 1;
+
+            for (int m = 0; m <= Order; ++m)
+                if (m != k)
+                    w *= (delta - (SampleType) m) / (SampleType) (k - m);
+
+            weights[t] = w;
+        }
+    }
+}
+
+template <typename SampleType = float>
+class DelayEffect : public AudioEffectBase<SampleType>
+{
+public:
+    using AudioEffectBase<SampleType>::getParameterValue;
+    using AudioEffectBase<SampleType>::glideTo;
+    using Mode = DelayInterpolation::Mode;
+
     void prepare(const juce::dsp::ProcessSpec& spec) override
     {
         sampleRate = spec.sampleRate;
-        delayLine.prepare(spec);
-        
+        numChannels = (int) spec.numChannels;
+
+        // Mirrored past the end by the widest kernel, so tap runs never wrap
+        lineSize = juce::nextPowerOfTwo(maxDelaySamples + DelayInterpolation::maxTaps + 1);
+        lineMask = lineSize - 1;
+        lines.assign((size_t) numChannels, std::vector<SampleType>((size_t) (lineSize + DelayInterpolation::maxTaps), (SampleType) 0));
+        thiranState.assign((size_t) numChannels, {});
+        writePosition = 0;
+
+        const auto maxBlock = (size_t) spec.maximumBlockSize;
+        delays.resize(maxBlock);
+        feedbacks.resize(maxBlock);
+        mixes.resize(maxBlock);
+        wet.resize(maxBlock);
+
+        // Built here, not on the audio thread
+        if (mode == Mode::Sinc)
+            DelayInterpolation::getSincTable<SampleType>();
+
         // Reset smoothing
         delayTime.reset(sampleRate, 0.05);
         feedback.reset(sampleRate, 0.05);
         mix.reset(sampleRate, 0.05);
     }
 
-    void process(const juce::dsp::ProcessContextReplacing<float>& context) override
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) override
     {
         auto& inputBlock = context.getInputBlock();
         auto& outputBlock = context.getOutputBlock();
-        size_t numChannels = inputBlock.getNumChannels();
-        size_t numSamples = inputBlock.getNumSamples();
+        const auto channels = juce::jmin(numChannels, (int) inputBlock.getNumChannels());
+        const auto numSamples = juce::jmin((int) inputBlock.getNumSamples(), (int) delays.size());
+
+        if (lines.empty() || numSamples == 0)
+            return;
 
-        for (size_t ch = 0; ch < numChannels; ++ch)
+        // Parameter ramps once per block, shared by every channel
+        const auto minDelay = (SampleType) DelayInterpolation::getMinimumDelay(mode);
+        for (int i = 0; i < numSamples; ++i)
         {
-            auto* src = inputBlock.getChannelPointer(ch);
-            auto* dst = outputBlock.getChannelPointer(ch);
+            delays[(size_t) i] = juce::jlimit(minDelay, (SampleType) maxDelaySamples, delayTime.getNextValue() * (SampleType) sampleRate);
+            feedbacks[(size_t) i] = feedback.getNextValue();
+            mixes[(size_t) i] = mix.getNextValue();
+        }
+
+        const auto tapsAhead = DelayInterpolation::getTapsAhead(mode);
 
-            for (size_t i = 0; i < numSamples; ++i)
+        // Chunks short enough that no read reaches a sample written in the
+        // same chunk, so each chunk is read, then written, as a whole
+        for (int start = 0; start < numSamples;)
+        {
+            const auto window = juce::jmin(maxChunk, numSamples - start);
+            auto shortest = delays[(size_t) start];
+            for (int i = 1; i < window; ++i)
+                shortest = juce::jmin(shortest, delays[(size_t) (start + i)]);
+
+            const auto length = juce::jlimit(1, window, (int) std::floor(shortest) - tapsAhead);
+
+            for (int ch = 0; ch < channels; ++ch)
             {
-                float dry = src[i];
-                
-                // Get delayed sample
-                float currentDelay = delayTime.getNextValue() * (float)sampleRate;
-                float delayed = delayLine.popSample((int)ch, currentDelay);
-                
-                // Calculate output
-                float wet = delayed;
-                float out = dry * (1.0f - mix.getNextValue()) + wet * mix.getNextValue();
-                
-                // Feedback
-                float fb = feedback.getNextValue();
-                delayLine.pushSample((int)ch, dry + delayed * fb);
-                
-                dst[i] = out;
+                read(ch, start, length);
+
+                const auto* src = inputBlock.getChannelPointer((size_t) ch) + start;
+                auto* dst = outputBlock.getChannelPointer((size_t) ch) + start;
+                write(ch, src, start, length);
+
+                for (int i = 0; i < length; ++i)
+                {
+                    const auto m = mixes[(size_t) (start + i)];
+                    dst[i] = src[i] * ((SampleType) 1 - m) + wet[(size_t) i] * m;
+                }
             }
+
+            writePosition = (writePosition + length) & lineMask;
+            start += length;
         }
     }
 
     void reset() override
     {
-        delayLine.reset();
+        for (auto& line : lines)
+            std::fill(line.begin(), line.end(), (SampleType) 0);
+
+        for (auto& state : thiranState)
+            state = {};
+
+        writePosition = 0;
     }
 
     void configure(const juce::ValueTree& config) override
     {
+        if (config.hasProperty("interpolation"))
+        {
+            mode = DelayInterpolation::fromString(config.getProperty("interpolation").toString());
+
+            if (mode == Mode::Sinc)
+                DelayInterpolation::getSincTable<SampleType>();
+        }
+
         if (config.hasProperty("time") || config.getChildWithName("time").isValid())
             delayTime.setTargetValue(getParameterValue(config, "time", 0.5f));
-            
+
         if (config.hasProperty("feedback") || config.getChildWithName("feedback").isValid())
             feedback.setTargetValue(getParameterValue(config, "feedback", 0.3f));
-            
+
         if (config.hasProperty("mix") || config.getChildWithName("mix").isValid())
             mix.setTargetValue(getParameterValue(config, "mix", 0.5f));
     }
 
+    ModulationTarget getModulationTarget(const juce::Identifier& id) const override
+    {
+        if (id == juce::Identifier("time"))     return { (int) Target::time, 0.0f, 4.0f };
+        if (id == juce::Identifier("feedback")) return { (int) Target::feedback, -0.99f, 0.99f };
+        if (id == juce::Identifier("mix"))      return { (int) Target::mix, 0.0f, 1.0f };
+        return {};
+    }
+
+    // The smoothed values already step per sample; they just take the slice's length
+    void setModulatedParameter(int index, float value, int rampSamples) override
+    {
+        switch ((Target) index)
+        {
+            case Target::time:     glideTo(delayTime, value, rampSamples); break;
+            case Target::feedback: glideTo(feedback, value, rampSamples); break;
+            case Target::mix:      glideTo(mix, value, rampSamples); break;
+        }
+    }
+
 private:
-    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Linear> delayLine;
+    enum class Target { time, feedback, mix };
+
+    static constexpr int maxDelaySamples = 192000; // Max 2-4 seconds depending on SR
+    static constexpr int maxChunk = 64;
+
+    // Fills wet[0, length) with the delayed signal of channel ch
+    void read(int ch, int start, int length)
+    {
+        switch (mode)
+        {
+            case Mode::Linear:    readFir<2>(ch, start, length, [](SampleType frac, SampleType* w) { w[0] = frac; w[1] = (SampleType) 1 - frac; }); break;
+            case Mode::Lagrange3: readFir<4>(ch, start, length, [](SampleType frac, SampleType* w) { DelayInterpolation::lagrangeWeights<3>(frac + (SampleType) 1, w); }); break;
+            case Mode::Lagrange5: readFir<6>(ch, start, length, [](SampleType frac, SampleType* w) { DelayInterpolation::lagrangeWeights<5>(frac + (SampleType) 2, w); }); break;
+            case Mode::Sinc:      readSinc(ch, start, length); break;
+            case Mode::Thiran:    readThiran(ch, start, length); break;
+        }
+    }
+
+    // Start of the contiguous tap run, oldest first, for a delay whose
+    // newest tap is `newest` samples back at output sample i
+    int tapBase(int i, int newest, int numTaps) const
+    {
+        return (writePosition + i - newest - (numTaps - 1)) & lineMask;
+    }
+
+    template <int NumTaps, typename Weights>
+    void readFir(int ch, int start, int length, Weights&& computeWeights)
+    {
+        const auto* line = lines[(size_t) ch].data();
+        const auto tapsAhead = DelayInterpolation::getTapsAhead(mode);
+        std::array<SampleType, (size_t) NumTaps> w;
+
+        for (int i = 0; i < length; ++i)
+        {
+            const auto d = delays[(size_t) (start + i)];
+            const auto whole = (int) d;
+            computeWeights(d - (SampleType) whole, w.data());
+
+            const auto* taps = line + tapBase(i, whole - tapsAhead, NumTaps);
+
+            SampleType sum = 0;
+            for (int t = 0; t < NumTaps; ++t)
+                sum += w[(size_t) t] * taps[t];
+
+            wet[(size_t) i] = sum;
+        }
+    }
+
+    void readSinc(int ch, int start, int length)
+    {
+        using namespace DelayInterpolation;
+
+        const auto* line = lines[(size_t) ch].data();
+        const auto& table = getSincTable<SampleType>();
+        std::array<SampleType, (size_t) sincTaps> w;
+
+        for (int i = 0; i < length; ++i)
+        {
+            const auto d = delays[(size_t) (start + i)];
+            const auto whole = (int) d;
+
+            // Blend the two nearest tabulated phases
+            const auto phase = (d - (SampleType) whole) * (SampleType) sincPhases;
+            const auto row = juce::jmin((int) phase, sincPhases - 1);
+            const auto blend = phase - (SampleType) row;
+            const auto* lower = table.data() + row * sincTaps;
+            const auto* upper = lower + sincTaps;
+
+            for (int t = 0; t < sincTaps; ++t)
+                w[(size_t) t] = lower[t] + blend * (upper[t] - lower[t]);
+
+            const auto* taps = line + tapBase(i, whole - getTapsAhead(Mode::Sinc), sincTaps);
+
+            SampleType sum = 0;
+            for (int t = 0; t < sincTaps; ++t)
+                sum += w[(size_t) t] * taps[t];
+
+            wet[(size_t) i] = sum;
+        }
+    }
+
+    // First-order Thiran allpass on an integer delay M, with the fractional
+    // part kept in [0.5, 1.5): flat magnitude response, but recursive, so it
+    // runs sample by sample and suits slowly moving delays best
+    void readThiran(int ch, int start, int length)
+    {
+        const auto* line = lines[(size_t) ch].data();
+        auto& state = thiranState[(size_t) ch];
+
+        for (int i = 0; i < length; ++i)
+        {
+            const auto d = delays[(size_t) (start + i)];
+            const auto whole = (int) std::floor(d - (SampleType) 0.5);
+            const auto frac = d - (SampleType) whole;
+            const auto a = ((SampleType) 1 - frac) / ((SampleType) 1 + frac);
+
+            // x[n - M - 1], x[n - M]
+            const auto* taps = line + tapBase(i, whole, 2);
+            const auto y = a * taps[1] + taps[0] - a * state.previousOutput;
+
+            state.previousOutput = y;
+            wet[(size_t) i] = y;
+        }
+    }
+
+    // Writes input plus feedback, mirroring the start of the line past its end
+    void write(int ch, const SampleType* src, int start, int length)
+    {
+        auto* line = lines[(size_t) ch].data();
+
+        for (int i = 0; i < length; ++i)
+        {
+            const auto index = (writePosition + i) & lineMask;
+            const auto value = src[i] + wet[(size_t) i] * feedbacks[(size_t) (start + i)];
+
+            line[index] = value;
+            if (index < DelayInterpolation::maxTaps)
+                line[index + lineSize] = value;
+        }
+    }
+
+    struct ThiranState
+    {
+        SampleType previousOutput = 0;
+    };
+
+    Mode mode = Mode::Linear;
     double sampleRate = 44100.0;
-    
-    juce::SmoothedValue<float> delayTime { 0.5f };
-    juce::SmoothedValue<float> feedback { 0.3f };
-    juce::SmoothedValue<float> mix { 0.5f };
+    int numChannels = 0;
+
+    std::vector<std::vector<SampleType>> lines;
+    std::vector<ThiranState> thiranState;
+    int lineSize = 0, lineMask = 0, writePosition = 0;
+
+    // Per-sample parameter values and the current chunk's delayed signal
+    std::vector<SampleType> delays, feedbacks, mixes, wet;
+
+    juce::SmoothedValue<SampleType> delayTime { 0.5f };
+    juce::SmoothedValue<SampleType> feedback { 0.3f };
+    juce::SmoothedValue<SampleType> mix { 0.5f };
 };
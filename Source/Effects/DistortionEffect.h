@@ -1,34 +1,46 @@
 #pragma once
 #include "../AudioEffect.h"
+#include "../SharedResourceCache.h"
 #include <cmath>
 
-class DistortionEffect : public AudioEffect
+template <typename SampleType = float>
+class DistortionEffect : public AudioEffectBase<SampleType>
 {
 public:
+    using AudioEffectBase<SampleType>::getParameterValue;
+
+    using ShaperTable = juce::dsp::LookupTableTransform<SampleType>;
+
     DistortionEffect()
     {
-        // Standard Tanh waveshaper
-        shaper.functionToUse = [](float x) { return std::tanh(x); };
+        // Standard Tanh waveshaper, read from a table shared by every instance
+        shaper = getSharedTanhTable();
     }
 
     void prepare(const juce::dsp::ProcessSpec& spec) override
     {
-        shaper.prepare(spec);
+        sampleRate = spec.sampleRate;
         preGain.prepare(spec);
         postGain.prepare(spec);
     }
 
-    void process(const juce::dsp::ProcessContextReplacing<float>& context) override
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) override
     {
         // Drive -> Distort -> Compensate
         preGain.process(context);
-        shaper.process(context);
+
+        auto& block = context.getOutputBlock();
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+        {
+            auto* data = block.getChannelPointer(ch);
+            shaper->process(data, data, block.getNumSamples());
+        }
+
         postGain.process(context);
     }
 
     void reset() override
     {
-        shaper.reset();
         preGain.reset();
         postGain.reset();
     }
@@ -39,12 +51,47 @@ public:
         if (config.hasProperty("drive") || config.getChildWithName("drive").isValid())
             driveDb = getParameterValue(config, "drive", 0.0f);
             
-        preGain.setGainDecibels(driveDb);
-        postGain.setGainDecibels(-driveDb * 0.5f); // Simple auto-compensation
+        setDrive(driveDb);
+    }
+
+    ModulationTarget getModulationTarget(const juce::Identifier& id) const override
+    {
+        if (id == juce::Identifier("drive")) return { 0, -48.0f, 48.0f };
+        return {};
+    }
+
+    void setModulatedParameter(int, float value, int rampSamples) override
+    {
+        // Both gains glide to the new drive over the slice, as GainEffect does
+        if (sampleRate > 0.0)
+        {
+            preGain.setRampDurationSeconds(rampSamples / sampleRate);
+            postGain.setRampDurationSeconds(rampSamples / sampleRate);
+        }
+
+        setDrive(value);
     }
 
 private:
-    juce::dsp::WaveShaper<float> shaper;
-    juce::dsp::Gain<float> preGain;
-    juce::dsp::Gain<float> postGain;
+    void setDrive(float driveDb)
+    {
+        preGain.setGainDecibels((SampleType) driveDb);
+        postGain.setGainDecibels((SampleType) (-driveDb * 0.5f)); // Simple auto-compensation
+    }
+
+    static std::shared_ptr<const ShaperTable> getSharedTanhTable()
+    {
+        // tanh is within 1e-4 of +/-1 beyond |x| = 5, and the table clamps its input there
+        constexpr size_t numPoints = 4096;
+
+        return SharedResourceCache::getInstance().getOrCreate<ShaperTable>(
+            { "LookupTable", SharedResourceCache::hash(juce::String("tanh[-5,5]/4096/") + juce::String((int) sizeof(SampleType))) },
+            [] { return std::make_unique<ShaperTable>([](SampleType x) { return std::tanh(x); }, (SampleType) -5, (SampleType) 5, numPoints); },
+            [](const ShaperTable&) { return sizeof(ShaperTable) + numPoints * sizeof(SampleType); });
+    }
+
+    std::shared_ptr<const ShaperTable> shaper;
+    juce::dsp::Gain<SampleType> preGain;
+    juce::dsp::Gain<SampleType> postGain;
+    double sampleRate = 0.0;
 };
@@ -0,0 +1,561 @@
+#pragma once
+#include <juce_dsp/juce_dsp.h>
+#include <array>
+#include <cmath>
+
+/**
+ * The dynamics engine behind Compressor, Limiter and NoiseGate.
+ *
+ * Every channel runs detector -> level smoothing -> gain computer:
+ *
+ *   detection: peak      # |x|, or rms (mean square, 50 ms release)
+ *   attack: 5            # ballistics of the detected level, in ms
+ *   release: 100
+ *   knee: 6              # soft knee width in dB (0 = hard)
+ *   hysteresis: 6        # gates only: closes this many dB below where it opens
+ *   link: all            # none, all, or an amount 0..1 towards the loudest channel
+ *   lookahead: 5         # ms the audio runs behind the detector
+ *   key: sidechain       # optional, see KeyDetector
+ *
+ * With a hard knee, no link, no hysteresis and no lookahead the math is that
+ * of juce::dsp::Compressor and juce::dsp::NoiseGate.
+ *
+ * Channels sit in lanes of laneWidth. The detector, link and ballistics stages
+ * are fixed-length loops across the lanes, run once per sample for all
+ * channels, so the compiler vectorizes them across channels. Only the gain
+ * curve (pow, log and exp) runs per channel. Unused lanes see silence, so they
+ * never win the link.
+ *
+ * A hysteresis gate switches hard between its open and closed curves, so
+ * there the attack and release smooth the gain instead of the level.
+ * Lookahead delays the audio by its length; getLatencySamples() reports it,
+ * so the chain can line up parallel paths and tell the host.
+ */
+namespace Dynamics
+{
+    enum class Curve { Compressor, Gate };
+    enum class Detection { Peak, Rms };
+
+    // "link": all/true/yes links fully, none/false/no not at all; a number links part way
+    inline float getLinkAmount(const juce::var& link)
+    {
+        if (link.isString())
+        {
+            const auto text = link.toString().trim().toLowerCase();
+
+            if (text == "all" || text == "true" || text == "yes")
+                return 1.0f;
+
+            if (text == "none" || text == "false" || text == "no")
+                return 0.0f;
+
+            return juce::jlimit(0.0f, 1.0f, text.getFloatValue());
+        }
+
+        return juce::jlimit(0.0f, 1.0f, (float) link);
+    }
+
+    /**
+     * Builds a mono key for dynamics that don't detect on each channel:
+     *
+     *   key: sidechain       # detect on the sidechain bus instead of the input
+     *   key_filter: highpass # optional detector filter (highpass, lowpass, bandpass)
+     *   key_frequency: 120
+     *   key_q: 0.707
+     *
+     * With a filter the key channels are summed to mono and filtered before
+     * rectifying; otherwise the key is the per-sample maximum of |x|.
+     */
+    template <typename SampleType>
+    class KeyDetector
+    {
+    public:
+        void configure(const juce::ValueTree& config)
+        {
+            if (config.hasProperty("key"))
+                useSidechain = config.getProperty("key").toString().trim().equalsIgnoreCase("sidechain");
+
+            if (config.hasProperty("key_filter"))
+            {
+                const auto mode = config.getProperty("key_filter").toString().trim().toLowerCase();
+                filterType = mode == "highpass" ? FilterType::HighPass
+                           : mode == "lowpass"  ? FilterType::LowPass
+                           : mode == "bandpass" ? FilterType::BandPass
+                                                : FilterType::None;
+            }
+
+            if (config.hasProperty("key_frequency")) filterFrequency = config.getProperty("key_frequency");
+            if (config.hasProperty("key_q"))         filterQ = juce::jmax(0.01f, (float) config.getProperty("key_q"));
+
+            updateFilter();
+        }
+
+        void prepare(const juce::dsp::ProcessSpec& spec)
+        {
+            sampleRate = spec.sampleRate;
+            buffer.setSize(2, (int) spec.maximumBlockSize);
+            updateFilter();
+            filter.reset();
+        }
+
+        void reset() { filter.reset(); }
+
+        bool wantsSidechain() const { return useSidechain; }
+
+        // Current slice of the sidechain bus; empty when nothing is connected
+        void setSidechain(const juce::dsp::AudioBlock<const SampleType>& newKey) { sidechain = newKey; }
+
+        // True when the block should be keyed off compute() rather than its own channels
+        bool isActive() const
+        {
+            return hasSidechain() || filterType != FilterType::None;
+        }
+
+        SampleType* compute(const juce::dsp::AudioBlock<SampleType>& block)
+        {
+            const auto numSamples = (int) block.getNumSamples();
+
+            juce::dsp::AudioBlock<const SampleType> key = block;
+            if (hasSidechain())
+                key = sidechain.getSubBlock(0, juce::jmin((size_t) numSamples, sidechain.getNumSamples()));
+
+            auto* detector = buffer.getWritePointer(0);
+            auto* scratch = buffer.getWritePointer(1);
+            const auto keyLength = (int) key.getNumSamples();
+
+            if (filterType == FilterType::None)
+            {
+                juce::FloatVectorOperations::abs(detector, key.getChannelPointer(0), keyLength);
+
+                for (size_t ch = 1; ch < key.getNumChannels(); ++ch)
+                {
+                    juce::FloatVectorOperations::abs(scratch, key.getChannelPointer(ch), keyLength);
+                    juce::FloatVectorOperations::max(detector, detector, scratch, keyLength);
+                }
+            }
+            else
+            {
+                juce::FloatVectorOperations::copy(detector, key.getChannelPointer(0), keyLength);
+                for (size_t ch = 1; ch < key.getNumChannels(); ++ch)
+                    juce::FloatVectorOperations::add(detector, key.getChannelPointer(ch), keyLength);
+
+                juce::FloatVectorOperations::multiply(detector, (SampleType) 1 / (SampleType) key.getNumChannels(), keyLength);
+
+                for (int i = 0; i < keyLength; ++i)
+                    detector[i] = filter.processSample(detector[i]);
+
+                juce::FloatVectorOperations::abs(detector, detector, keyLength);
+            }
+
+            // A short sidechain slice (host quirk) reads as silence
+            if (keyLength < numSamples)
+                juce::FloatVectorOperations::clear(detector + keyLength, numSamples - keyLength);
+
+            return detector;
+        }
+
+        // Scratch of one block, free for the caller between compute() calls
+        SampleType* getGainBuffer() { return buffer.getWritePointer(1); }
+
+    private:
+        enum class FilterType { None, HighPass, LowPass, BandPass };
+
+        bool hasSidechain() const { return useSidechain && sidechain.getNumChannels() > 0; }
+
+        void updateFilter()
+        {
+            if (sampleRate <= 0.0 || filterType == FilterType::None)
+                return;
+
+            using ArrayCoefficients = juce::dsp::IIR::ArrayCoefficients<SampleType>;
+            const auto f = (SampleType) juce::jlimit(10.0, sampleRate * 0.49, (double) filterFrequency);
+            const auto q = (SampleType) filterQ;
+
+            switch (filterType)
+            {
+                case FilterType::HighPass: *filter.coefficients = ArrayCoefficients::makeHighPass(sampleRate, f, q); break;
+                case FilterType::LowPass:  *filter.coefficients = ArrayCoefficients::makeLowPass(sampleRate, f, q); break;
+                case FilterType::BandPass: *filter.coefficients = ArrayCoefficients::makeBandPass(sampleRate, f, q); break;
+                case FilterType::None:     break;
+            }
+        }
+
+        bool useSidechain = false;
+        FilterType filterType = FilterType::None;
+        float filterFrequency = 120.0f, filterQ = 0.707f;
+
+        double sampleRate = 0.0;
+        juce::dsp::IIR::Filter<SampleType> filter { new juce::dsp::IIR::Coefficients<SampleType>() };
+        juce::dsp::AudioBlock<const SampleType> sidechain;
+        juce::AudioBuffer<SampleType> buffer;
+    };
+
+    /** One compressor or gate stage over up to maxChannels channels. */
+    template <typename SampleType>
+    class Core
+    {
+    public:
+        static constexpr int laneWidth = 8;
+        static constexpr int maxGroups = 4;
+        static constexpr int maxChannels = laneWidth * maxGroups;   // whole lane groups, above the plugin's 31-channel bus limit
+        static constexpr double maxLookaheadMs = 20.0;
+
+        explicit Core(Curve newCurve) : curve(newCurve)
+        {
+            // The juce::dsp::NoiseGate defaults; the compressor's are the member initialisers
+            if (curve == Curve::Gate)
+            {
+                thresholdDb = (SampleType) -100;
+                ratio = (SampleType) 10;
+                detection = Detection::Rms;
+            }
+
+            updateCurve();
+        }
+
+        void prepare(const juce::dsp::ProcessSpec& spec)
+        {
+            sampleRate = spec.sampleRate;
+
+            const auto numChannels = juce::jlimit(1, maxChannels, (int) spec.numChannels);
+            gains.setSize(numChannels, (int) spec.maximumBlockSize);
+            lookaheadLine.setSize(numChannels, (int) std::ceil(maxLookaheadMs * 0.001 * sampleRate) + 1);
+
+            updateTimes();
+            updateLookahead();
+            reset();
+        }
+
+        void reset()
+        {
+            for (auto* groups : { &input, &meanSquare, &level, &envelope })
+                for (auto& lanes : *groups)
+                    lanes.fill((SampleType) 0);
+
+            smoothedGain.fill((SampleType) 0);
+            open.fill(false);
+            lookaheadLine.clear();
+            writePosition = 0;
+        }
+
+        void setThreshold(SampleType db)  { thresholdDb = db; updateCurve(); }
+        void setRatio(SampleType r)       { ratio = juce::jmax((SampleType) 1, r); updateCurve(); }
+        void setKnee(SampleType db)       { kneeDb = juce::jmax((SampleType) 0, db); updateCurve(); }
+        void setHysteresis(SampleType db) { hysteresisDb = juce::jmax((SampleType) 0, db); updateCurve(); }
+        void setAttack(SampleType ms)     { attackMs = ms; updateTimes(); }
+        void setRelease(SampleType ms)    { releaseMs = ms; updateTimes(); }
+        void setDetection(Detection d)    { detection = d; }
+        void setLink(SampleType amount)   { link = juce::jlimit((SampleType) 0, (SampleType) 1, amount); }
+        void setLookahead(SampleType ms)  { lookaheadMs = juce::jlimit((SampleType) 0, (SampleType) maxLookaheadMs, ms); updateLookahead(); }
+
+        SampleType getThreshold() const { return thresholdDb; }
+        SampleType getRatio() const     { return ratio; }
+        SampleType getAttack() const    { return attackMs; }
+        SampleType getRelease() const   { return releaseMs; }
+        SampleType getLink() const      { return link; }
+        int getLatencySamples() const { return lookaheadSamples; }
+
+        // The keys every dynamics effect shares; threshold, ratio, attack and
+        // release are left to the effect, whose defaults and ranges differ
+        void configure(const juce::ValueTree& config)
+        {
+            if (config.hasProperty("link"))       setLink((SampleType) getLinkAmount(config.getProperty("link")));
+            if (config.hasProperty("knee"))       setKnee((SampleType) (double) config.getProperty("knee"));
+            if (config.hasProperty("hysteresis")) setHysteresis((SampleType) (double) config.getProperty("hysteresis"));
+            if (config.hasProperty("lookahead"))  setLookahead((SampleType) (double) config.getProperty("lookahead"));
+
+            if (config.hasProperty("detection"))
+                setDetection(config.getProperty("detection").toString().trim().equalsIgnoreCase("rms") ? Detection::Rms : Detection::Peak);
+        }
+
+        // Every channel detected on its own, pulled towards the loudest by the link
+        void process(const juce::dsp::AudioBlock<SampleType>& block)
+        {
+            const auto numChannels = juce::jmin((int) block.getNumChannels(), gains.getNumChannels());
+            const auto numSamples = (int) block.getNumSamples();
+            const auto numGroups = (numChannels + laneWidth - 1) / laneWidth;
+
+            std::array<const SampleType*, (size_t) maxChannels> in {};
+            std::array<SampleType*, (size_t) maxChannels> gain {};
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                in[(size_t) ch] = block.getChannelPointer((size_t) ch);
+                gain[(size_t) ch] = gains.getWritePointer(ch);
+            }
+
+            // Lanes past the last channel stay silent
+            clearInput();
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                for (int ch = 0; ch < numChannels; ++ch)
+                    input[(size_t) (ch / laneWidth)][(size_t) (ch % laneWidth)] = in[(size_t) ch][i];
+
+                detect(numGroups);
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                    gain[(size_t) ch][i] = gainFor(envelope[(size_t) (ch / laneWidth)][(size_t) (ch % laneWidth)], ch);
+            }
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                applyGain(block.getChannelPointer((size_t) ch), gain[(size_t) ch], ch, numSamples);
+
+            advanceLookahead(numSamples);
+        }
+
+        // One detector on a mono key, the same gain on every channel
+        void process(const juce::dsp::AudioBlock<SampleType>& block, const SampleType* key)
+        {
+            auto* gain = gains.getWritePointer(0);
+            computeGain(key, gain, (int) block.getNumSamples());
+            applyGain(block, gain);
+        }
+
+        // gain[i] = gain for key[i], on the first lane; key may alias gain
+        void computeGain(const SampleType* key, SampleType* gain, int numSamples)
+        {
+            clearInput();
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                input[0][0] = key[i];
+                detect(1);
+                gain[i] = gainFor(envelope[0][0], 0);
+            }
+        }
+
+        // Applies one gain curve to every channel, behind the lookahead
+        void applyGain(const juce::dsp::AudioBlock<SampleType>& block, const SampleType* gain)
+        {
+            const auto numChannels = juce::jmin((int) block.getNumChannels(), gains.getNumChannels());
+            const auto numSamples = (int) block.getNumSamples();
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                applyGain(block.getChannelPointer((size_t) ch), gain, ch, numSamples);
+
+            advanceLookahead(numSamples);
+        }
+
+    private:
+        using Lanes = std::array<SampleType, (size_t) laneWidth>;
+        using Groups = std::array<Lanes, (size_t) maxGroups>;
+
+        static SampleType square(SampleType x) { return x * x; }
+
+        static SampleType toDecibels(SampleType gain)
+        {
+            return (SampleType) 20 * std::log10(juce::jmax(gain, (SampleType) 1.0e-10));
+        }
+
+        static SampleType fromDecibels(SampleType db)
+        {
+            return std::exp(db * (SampleType) (juce::MathConstants<double>::ln10 / 20.0));
+        }
+
+        // Smoothing coefficient of juce::dsp::BallisticsFilter
+        SampleType ballistics(SampleType ms) const
+        {
+            return ms < (SampleType) 1.0e-3 ? (SampleType) 0
+                                            : (SampleType) std::exp(-2.0 * juce::MathConstants<double>::pi * 1000.0 / (sampleRate * (double) ms));
+        }
+
+        void clearInput()
+        {
+            for (auto& lanes : input)
+                lanes.fill((SampleType) 0);
+        }
+
+        // One sample of every lane: rectify, link, then the level ballistics
+        void detect(int numGroups)
+        {
+            for (size_t g = 0; g < (size_t) numGroups; ++g)
+            {
+                const auto& x = input[g];
+                auto& l = level[g];
+
+                if (detection == Detection::Rms)
+                {
+                    auto& ms = meanSquare[g];
+
+                    for (size_t i = 0; i < (size_t) laneWidth; ++i)
+                    {
+                        const auto x2 = x[i] * x[i];
+                        const auto cte = x2 > ms[i] ? rmsAttack : rmsRelease;
+                        ms[i] = x2 + cte * (ms[i] - x2);
+                        l[i] = std::sqrt(ms[i]);
+                    }
+                }
+                else
+                {
+                    for (size_t i = 0; i < (size_t) laneWidth; ++i)
+                        l[i] = std::abs(x[i]);
+                }
+            }
+
+            if (link > (SampleType) 0)
+            {
+                auto loudest = (SampleType) 0;
+
+                for (size_t g = 0; g < (size_t) numGroups; ++g)
+                    for (size_t i = 0; i < (size_t) laneWidth; ++i)
+                        loudest = juce::jmax(loudest, level[g][i]);
+
+                for (size_t g = 0; g < (size_t) numGroups; ++g)
+                    for (size_t i = 0; i < (size_t) laneWidth; ++i)
+                        level[g][i] += link * (loudest - level[g][i]);
+            }
+
+            // A hysteresis gate smooths its gain instead
+            const auto smoothLevel = !smoothsGain();
+            const auto at = smoothLevel ? attack : (SampleType) 0;
+            const auto rl = smoothLevel ? release : (SampleType) 0;
+
+            for (size_t g = 0; g < (size_t) numGroups; ++g)
+            {
+                const auto& l = level[g];
+                auto& env = envelope[g];
+
+                for (size_t i = 0; i < (size_t) laneWidth; ++i)
+                {
+                    const auto cte = l[i] > env[i] ? at : rl;
+                    env[i] = l[i] + cte * (env[i] - l[i]);
+                }
+            }
+        }
+
+        SampleType gainFor(SampleType env, int channel)
+        {
+            if (curve == Curve::Compressor)
+            {
+                if (env < kneeStart)
+                    return (SampleType) 1;
+
+                if (kneeDb <= (SampleType) 0)
+                    return std::pow(env * thresholdInverse, ratioInverse - (SampleType) 1);
+
+                const auto over = toDecibels(env) - thresholdDb;
+                const auto slope = ratioInverse - (SampleType) 1;
+                const auto halfKnee = kneeDb * (SampleType) 0.5;
+
+                return fromDecibels(over < halfKnee ? slope * square(over + halfKnee) / ((SampleType) 2 * kneeDb)
+                                                    : slope * over);
+            }
+
+            // The gate opens above the threshold and, with hysteresis, closes
+            // below the lower one
+            auto& isOpen = open[(size_t) channel];
+            isOpen = env > (isOpen ? closeThreshold : threshold);
+
+            const auto referenceDb = isOpen ? closeThresholdDb : thresholdDb;
+            auto target = (SampleType) 1;
+
+            if (kneeDb <= (SampleType) 0)
+            {
+                const auto reference = isOpen ? closeThreshold : threshold;
+                if (env <= reference)
+                    target = std::pow(env / reference, ratio - (SampleType) 1);
+            }
+            else
+            {
+                const auto under = toDecibels(env) - referenceDb;
+                const auto slope = ratio - (SampleType) 1;
+                const auto halfKnee = kneeDb * (SampleType) 0.5;
+
+                if (under < -halfKnee)
+                    target = fromDecibels(slope * under);
+                else if (under < halfKnee)
+                    target = fromDecibels(-slope * square(under - halfKnee) / ((SampleType) 2 * kneeDb));
+            }
+
+            if (!smoothsGain())
+                return target;
+
+            auto& g = smoothedGain[(size_t) channel];
+            const auto cte = target > g ? attack : release;
+            g = target + cte * (g - target);
+            return g;
+        }
+
+        bool smoothsGain() const { return curve == Curve::Gate && hysteresisDb > (SampleType) 0; }
+
+        void applyGain(SampleType* data, const SampleType* gain, int channel, int numSamples)
+        {
+            if (lookaheadSamples == 0)
+            {
+                juce::FloatVectorOperations::multiply(data, gain, numSamples);
+                return;
+            }
+
+            auto* line = lookaheadLine.getWritePointer(channel);
+            const auto length = lookaheadLine.getNumSamples();
+            auto write = writePosition;
+            auto read = write >= lookaheadSamples ? write - lookaheadSamples : write - lookaheadSamples + length;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                line[write] = data[i];
+                data[i] = line[read] * gain[i];
+
+                if (++write == length) write = 0;
+                if (++read == length)  read = 0;
+            }
+        }
+
+        void advanceLookahead(int numSamples)
+        {
+            if (lookaheadSamples > 0)
+                writePosition = (writePosition + numSamples) % lookaheadLine.getNumSamples();
+        }
+
+        void updateCurve()
+        {
+            threshold = juce::Decibels::decibelsToGain(thresholdDb, (SampleType) -200);
+            thresholdInverse = (SampleType) 1 / threshold;
+            ratioInverse = (SampleType) 1 / ratio;
+
+            closeThresholdDb = thresholdDb - hysteresisDb;
+            closeThreshold = juce::Decibels::decibelsToGain(closeThresholdDb, (SampleType) -200);
+
+            kneeStart = juce::Decibels::decibelsToGain(thresholdDb - kneeDb * (SampleType) 0.5, (SampleType) -200);
+        }
+
+        void updateTimes()
+        {
+            if (sampleRate <= 0.0)
+                return;
+
+            attack = ballistics(attackMs);
+            release = ballistics(releaseMs);
+
+            // juce::dsp::NoiseGate's RMS detector
+            rmsAttack = ballistics((SampleType) 0);
+            rmsRelease = ballistics((SampleType) 50);
+        }
+
+        void updateLookahead()
+        {
+            if (sampleRate > 0.0)
+                lookaheadSamples = juce::jlimit(0, lookaheadLine.getNumSamples() - 1, juce::roundToInt((double) lookaheadMs * 0.001 * sampleRate));
+        }
+
+        const Curve curve;
+        Detection detection = Detection::Peak;
+
+        double sampleRate = 0.0;
+        SampleType thresholdDb = 0, ratio = 1, kneeDb = 0, hysteresisDb = 0;
+        SampleType attackMs = 1, releaseMs = 100, lookaheadMs = 0;
+        SampleType link = 0;
+
+        SampleType threshold = 1, thresholdInverse = 1, ratioInverse = 1, kneeStart = 1;
+        SampleType closeThreshold = 1, closeThresholdDb = 0;
+        SampleType attack = 0, release = 0, rmsAttack = 0, rmsRelease = 0;
+
+        Groups input {}, meanSquare {}, level {}, envelope {};
+        std::array<SampleType, (size_t) maxChannels> smoothedGain {};
+        std::array<bool, (size_t) maxChannels> open {};
+
+        juce::AudioBuffer<SampleType> gains, lookaheadLine;
+        int lookaheadSamples = 0, writePosition = 0;
+    };
+}
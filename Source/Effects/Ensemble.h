@@ -0,0 +1,433 @@
+#pragma once
+#include <juce_dsp/juce_dsp.h>
+#include <array>
+#include <cmath>
+#include <vector>
+
+/**
+ * Voice layout and LFOs shared by the ensemble chorus and phaser.
+ *
+ * Up to maxVoices voices, each with its own LFO phase and a slightly detuned
+ * rate, spread across the stereo field. The LFOs are evaluated once per control
+ * chunk (at most controlInterval samples) for all channels, and whatever they
+ * drive is ramped linearly across the chunk.
+ *
+ * Per-voice state lives in lane arrays, and the per-sample stages are
+ * fixed-length loops over all maxVoices lanes, so the compiler vectorizes them
+ * across voices. Unused lanes run with zero weight: with 8 lanes that is one
+ * AVX register, and it keeps every loop the same length.
+ */
+template <typename SampleType>
+class EnsembleVoices
+{
+public:
+    static constexpr int maxVoices = 8;
+    static constexpr int controlInterval = 32;
+    static constexpr int maxChannels = 2;   // stereo spread; wider buses get unspread voices
+
+    using Lanes = std::array<SampleType, (size_t) maxVoices>;
+
+    void prepare(double newSampleRate, int newNumChannels)
+    {
+        sampleRate = newSampleRate;
+        numChannels = newNumChannels;
+        updateRates();
+        updateWeights();
+        reset();
+    }
+
+    void reset()
+    {
+        // Voices start evenly spaced round the cycle
+        for (int v = 0; v < maxVoices; ++v)
+            phase[(size_t) v] = (SampleType) v / (SampleType) juce::jmax(1, numVoices);
+    }
+
+    void setVoices(int newNumVoices, SampleType newSpread)
+    {
+        numVoices = juce::jlimit(1, maxVoices, newNumVoices);
+        spread = juce::jlimit((SampleType) 0, (SampleType) 1, newSpread);
+        updateRates();
+        updateWeights();
+    }
+
+    void setRate(SampleType newRateHz)
+    {
+        rateHz = juce::jmax((SampleType) 0, newRateHz);
+        updateRates();
+    }
+
+    int getNumVoices() const { return numVoices; }
+
+    // Advances every voice by numSamples and returns each LFO (-1..1) at the end
+    const Lanes& advance(int numSamples)
+    {
+        for (int v = 0; v < maxVoices; ++v)
+        {
+            auto p = phase[(size_t) v] + increment[(size_t) v] * (SampleType) numSamples;
+            p -= std::floor(p);
+            phase[(size_t) v] = p;
+            lfo[(size_t) v] = std::sin(juce::MathConstants<SampleType>::twoPi * p);
+        }
+
+        return lfo;
+    }
+
+    // Weight of each voice in an output channel: equal-power pans on a stereo
+    // bus, all voices equal otherwise. Scaled so the sum stays near unity gain.
+    const Lanes& getWeights(int channel) const
+    {
+        return weights[(size_t) (numChannels == 2 ? juce::jmin(channel, 1) : 0)];
+    }
+
+private:
+    // Voices run up to 5 % apart in rate, so they drift rather than beat
+    static constexpr SampleType detune = (SampleType) 0.05;
+
+    // Position of a voice across the field, -1 (left) to 1 (right)
+    SampleType position(int voice) const
+    {
+        return numVoices > 1 ? (SampleType) -1 + (SampleType) 2 * (SampleType) voice / (SampleType) (numVoices - 1) : (SampleType) 0;
+    }
+
+    void updateRates()
+    {
+        if (sampleRate <= 0.0)
+            return;
+
+        for (int v = 0; v < maxVoices; ++v)
+            increment[(size_t) v] = rateHz * ((SampleType) 1 + detune * position(v)) / (SampleType) sampleRate;
+    }
+
+    void updateWeights()
+    {
+        const auto norm = (SampleType) 1 / std::sqrt((SampleType) numVoices);
+
+        for (int v = 0; v < maxVoices; ++v)
+        {
+            const auto active = v < numVoices;
+            const auto angle = juce::MathConstants<SampleType>::pi * (SampleType) 0.25 * ((SampleType) 1 + spread * position(v));
+            const auto sqrt2 = juce::MathConstants<SampleType>::sqrt2;
+
+            weights[0][(size_t) v] = active ? norm * (numChannels == 2 ? sqrt2 * std::cos(angle) : (SampleType) 1) : (SampleType) 0;
+            weights[1][(size_t) v] = active ? norm * sqrt2 * std::sin(angle) : (SampleType) 0;
+        }
+    }
+
+    double sampleRate = 0.0;
+    int numChannels = 2;
+    int numVoices = 4;
+    SampleType spread = (SampleType) 0.7;
+    SampleType rateHz = (SampleType) 1;
+
+    Lanes phase {}, increment {}, lfo {};
+    std::array<Lanes, (size_t) maxChannels> weights {};
+};
+
+/**
+ * Multi-voice chorus ("mode: ensemble").
+ *
+ * Each channel has one delay line, and every voice reads it at its own
+ * modulated delay. The voices' delays are recomputed once per control chunk
+ * and ramped per sample. The read positions are computed once per sample for
+ * all channels, and the interpolation runs across the voice lanes.
+ *
+ * Parameters mean the same as in juce::dsp::Chorus: the delay sweeps from
+ * "delay" up to "delay" + 20 ms * depth.
+ */
+template <typename SampleType>
+class EnsembleChorus
+{
+public:
+    using Voices = EnsembleVoices<SampleType>;
+    using Lanes = typename Voices::Lanes;
+    static constexpr int maxVoices = Voices::maxVoices;
+
+    struct Parameters
+    {
+        SampleType rate = 1, depth = (SampleType) 0.25, centreDelayMs = 7, feedback = 0, mix = (SampleType) 0.5;
+        int voices = 4;
+        SampleType spread = (SampleType) 0.7;
+    };
+
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        sampleRate = spec.sampleRate;
+        numChannels = (int) spec.numChannels;
+
+        const auto longest = (maxCentreDelayMs + maxModulationMs) * 0.001 * sampleRate;
+        lineSize = juce::nextPowerOfTwo((int) std::ceil(longest) + 4);
+        lineMask = lineSize - 1;
+        lines.assign((size_t) (numChannels * lineSize), (SampleType) 0);
+
+        voices.prepare(sampleRate, numChannels);
+        mix.reset(sampleRate, 0.05);
+        setParameters(params);
+        reset();
+    }
+
+    void reset()
+    {
+        std::fill(lines.begin(), lines.end(), (SampleType) 0);
+        writePosition = 0;
+        voices.reset();
+        mix.setCurrentAndTargetValue(mix.getTargetValue());
+
+        // Start each voice at the delay its LFO asks for
+        const auto& lfo = voices.advance(0);
+        for (int v = 0; v < maxVoices; ++v)
+            delay[(size_t) v] = delayFor(lfo[(size_t) v]);
+    }
+
+    void setParameters(const Parameters& newParams)
+    {
+        params = newParams;
+        params.centreDelayMs = juce::jlimit((SampleType) 1, (SampleType) maxCentreDelayMs, params.centreDelayMs);
+        params.depth = juce::jlimit((SampleType) 0, (SampleType) 1, params.depth);
+        params.feedback = juce::jlimit((SampleType) -0.95, (SampleType) 0.95, params.feedback);
+
+        voices.setVoices(params.voices, params.spread);
+        voices.setRate(params.rate);
+        mix.setTargetValue(juce::jlimit((SampleType) 0, (SampleType) 1, params.mix));
+    }
+
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context)
+    {
+        auto& block = context.getOutputBlock();
+        if (context.usesSeparateInputAndOutputBlocks())
+            block.copyFrom(context.getInputBlock());
+
+        const auto channels = juce::jmin(numChannels, (int) block.getNumChannels());
+        const auto numSamples = (int) block.getNumSamples();
+        if (lines.empty() || channels == 0)
+            return;
+
+        Lanes step, frac;
+        std::array<int, (size_t) maxVoices> index0, index1;
+        Lanes a, b;
+
+        for (int start = 0; start < numSamples; start += Voices::controlInterval)
+        {
+            const auto n = juce::jmin(Voices::controlInterval, numSamples - start);
+
+            // Once per chunk for all channels: where each voice's delay ends up
+            const auto& lfo = voices.advance(n);
+            for (int v = 0; v < maxVoices; ++v)
+                step[(size_t) v] = (delayFor(lfo[(size_t) v]) - delay[(size_t) v]) / (SampleType) n;
+
+            for (int i = start; i < start + n; ++i)
+            {
+                // Read positions, shared by every channel
+                for (int v = 0; v < maxVoices; ++v)
+                {
+                    delay[(size_t) v] += step[(size_t) v];
+
+                    const auto position = (SampleType) writePosition - delay[(size_t) v];
+                    const auto whole = std::floor(position);
+                    frac[(size_t) v] = position - whole;
+                    index0[(size_t) v] = (int) whole & lineMask;
+                    index1[(size_t) v] = ((int) whole + 1) & lineMask;
+                }
+
+                const auto wetGain = mix.getNextValue();
+                const auto dryGain = (SampleType) 1 - wetGain;
+
+                for (int ch = 0; ch < channels; ++ch)
+                {
+                    auto* line = lines.data() + ch * lineSize;
+                    auto* samples = block.getChannelPointer((size_t) ch);
+                    const auto& weights = voices.getWeights(ch);
+
+                    // The gathers; everything around them runs across lanes
+                    for (int v = 0; v < maxVoices; ++v)
+                    {
+                        a[(size_t) v] = line[index0[(size_t) v]];
+                        b[(size_t) v] = line[index1[(size_t) v]];
+                    }
+
+                    SampleType wet = 0;
+                    for (int v = 0; v < maxVoices; ++v)
+                        wet += weights[(size_t) v] * (a[(size_t) v] + frac[(size_t) v] * (b[(size_t) v] - a[(size_t) v]));
+
+                    const auto input = samples[i];
+                    line[writePosition] = input + params.feedback * wet;
+                    samples[i] = dryGain * input + wetGain * wet;
+                }
+
+                writePosition = (writePosition + 1) & lineMask;
+            }
+        }
+    }
+
+private:
+    static constexpr double maxCentreDelayMs = 100.0;
+    static constexpr double maxModulationMs = 20.0;
+
+    SampleType delayFor(SampleType lfo) const
+    {
+        const auto ms = params.centreDelayMs + params.depth * (SampleType) (maxModulationMs * 0.5) * ((SampleType) 1 + lfo);
+        return ms * (SampleType) (0.001 * sampleRate);
+    }
+
+    Parameters params;
+    Voices voices;
+    juce::SmoothedValue<SampleType> mix;
+
+    double sampleRate = 44100.0;
+    int numChannels = 0;
+
+    std::vector<SampleType> lines;
+    int lineSize = 0, lineMask = 0, writePosition = 0;
+    Lanes delay {};
+};
+
+/**
+ * Multi-voice phaser ("mode: ensemble").
+ *
+ * Each voice is its own cascade of first-order allpass stages with its own
+ * sweep and feedback. The stages run across the voice lanes. The allpass
+ * coefficients (one tan() per voice) are recomputed once per control chunk
+ * and ramped per sample.
+ *
+ * The sweep covers "frequency" +/- 2 octaves * depth.
+ */
+template <typename SampleType>
+class EnsemblePhaser
+{
+public:
+    using Voices = EnsembleVoices<SampleType>;
+    using Lanes = typename Voices::Lanes;
+    static constexpr int maxVoices = Voices::maxVoices;
+    static constexpr int numStages = 6;
+
+    struct Parameters
+    {
+        SampleType rate = 1, depth = (SampleType) 0.5, centreFrequency = 1000, feedback = 0, mix = (SampleType) 0.5;
+        int voices = 4;
+        SampleType spread = (SampleType) 0.7;
+    };
+
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        sampleRate = spec.sampleRate;
+        numChannels = (int) spec.numChannels;
+
+        state.assign((size_t) (numChannels * numStages), Lanes {});
+        lastOutput.assign((size_t) numChannels, Lanes {});
+
+        voices.prepare(sampleRate, numChannels);
+        mix.reset(sampleRate, 0.05);
+        setParameters(params);
+        reset();
+    }
+
+    void reset()
+    {
+        for (auto& lanes : state)      lanes.fill((SampleType) 0);
+        for (auto& lanes : lastOutput) lanes.fill((SampleType) 0);
+
+        voices.reset();
+        mix.setCurrentAndTargetValue(mix.getTargetValue());
+
+        const auto& lfo = voices.advance(0);
+        for (int v = 0; v < maxVoices; ++v)
+            coefficient[(size_t) v] = coefficientFor(lfo[(size_t) v]);
+    }
+
+    void setParameters(const Parameters& newParams)
+    {
+        params = newParams;
+        params.depth = juce::jlimit((SampleType) 0, (SampleType) 1, params.depth);
+        params.feedback = juce::jlimit((SampleType) -0.95, (SampleType) 0.95, params.feedback);
+
+        voices.setVoices(params.voices, params.spread);
+        voices.setRate(params.rate);
+        mix.setTargetValue(juce::jlimit((SampleType) 0, (SampleType) 1, params.mix));
+    }
+
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context)
+    {
+        auto& block = context.getOutputBlock();
+        if (context.usesSeparateInputAndOutputBlocks())
+            block.copyFrom(context.getInputBlock());
+
+        const auto channels = juce::jmin(numChannels, (int) block.getNumChannels());
+        const auto numSamples = (int) block.getNumSamples();
+        if (channels == 0)
+            return;
+
+        Lanes step, x;
+
+        for (int start = 0; start < numSamples; start += Voices::controlInterval)
+        {
+            const auto n = juce::jmin(Voices::controlInterval, numSamples - start);
+
+            const auto& lfo = voices.advance(n);
+            for (int v = 0; v < maxVoices; ++v)
+                step[(size_t) v] = (coefficientFor(lfo[(size_t) v]) - coefficient[(size_t) v]) / (SampleType) n;
+
+            for (int i = start; i < start + n; ++i)
+            {
+                for (int v = 0; v < maxVoices; ++v)
+                    coefficient[(size_t) v] += step[(size_t) v];
+
+                const auto wetGain = mix.getNextValue();
+                const auto dryGain = (SampleType) 1 - wetGain;
+
+                for (int ch = 0; ch < channels; ++ch)
+                {
+                    auto* samples = block.getChannelPointer((size_t) ch);
+                    auto& last = lastOutput[(size_t) ch];
+                    const auto input = samples[i];
+
+                    for (int v = 0; v < maxVoices; ++v)
+                        x[(size_t) v] = input + params.feedback * last[(size_t) v];
+
+                    // Transposed direct form II: y = a x + z, z' = x - a y
+                    for (int s = 0; s < numStages; ++s)
+                    {
+                        auto& z = state[(size_t) (ch * numStages + s)];
+                        for (int v = 0; v < maxVoices; ++v)
+                        {
+                            const auto y = coefficient[(size_t) v] * x[(size_t) v] + z[(size_t) v];
+                            z[(size_t) v] = x[(size_t) v] - coefficient[(size_t) v] * y;
+                            x[(size_t) v] = y;
+                        }
+                    }
+
+                    last = x;
+
+                    const auto& weights = voices.getWeights(ch);
+                    SampleType wet = 0;
+                    for (int v = 0; v < maxVoices; ++v)
+                        wet += weights[(size_t) v] * x[(size_t) v];
+
+                    samples[i] = dryGain * input + wetGain * wet;
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr SampleType sweepOctaves = 2;
+
+    // First-order allpass coefficient for the voice's current frequency
+    SampleType coefficientFor(SampleType lfo) const
+    {
+        const auto frequency = juce::jlimit((SampleType) 20, (SampleType) (0.45 * sampleRate),
+                                            params.centreFrequency * std::exp2(sweepOctaves * params.depth * lfo));
+        const auto t = std::tan(juce::MathConstants<SampleType>::pi * frequency / (SampleType) sampleRate);
+        return (t - (SampleType) 1) / (t + (SampleType) 1);
+    }
+
+    Parameters params;
+    Voices voices;
+    juce::SmoothedValue<SampleType> mix;
+
+    double sampleRate = 44100.0;
+    int numChannels = 0;
+
+    std::vector<Lanes> state;       // [channel * numStages + stage]
+    std::vector<Lanes> lastOutput;  // per channel, for feedback
+    Lanes coefficient {};
+};
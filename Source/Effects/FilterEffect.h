@@ -1,10 +1,15 @@
 #pragma once
 #include "../AudioEffect.h"
+#include "../SharedResourceCache.h"
 #include <string>
 
-class FilterEffect : public AudioEffect
+template <typename SampleType = float>
+class FilterEffect : public AudioEffectBase<SampleType>
 {
 public:
+    using AudioEffectBase<SampleType>::getParameterValue;
+    using AudioEffectBase<SampleType>::processInChunks;
+
     FilterEffect() : filter(state)
     {
         updateCoefficients();
@@ -17,9 +22,16 @@ public:
         updateCoefficients();
     }
 
-    void process(const juce::dsp::ProcessContextReplacing<float>& context) override
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) override
     {
-        filter.process(context);
+        processInChunks(context, frequencyRamp.isGliding() || qRamp.isGliding(),
+                        [this](int numSamples)
+                        {
+                            frequency = frequencyRamp.advance(numSamples);
+                            q = qRamp.advance(numSamples);
+                            computeModulatedCoefficients();
+                        },
+                        [this](const auto& chunk) { filter.process(chunk); });
     }
 
     void reset() override
@@ -43,10 +55,51 @@ public:
         if (config.hasProperty("q") || config.getChildWithName("q").isValid()) 
             q = getParameterValue(config, "q", 0.707f);
 
+        frequencyRamp.setValue(frequency);
+        qRamp.setValue(q);
         updateCoefficients();
     }
 
+    ModulationTarget getModulationTarget(const juce::Identifier& id) const override
+    {
+        // The frequency is also kept below Nyquist when the coefficients are made
+        if (id == juce::Identifier("frequency")) return { (int) Target::frequency, 10.0f, 24000.0f };
+        if (id == juce::Identifier("q"))         return { (int) Target::q, 0.01f, 100.0f };
+        return {};
+    }
+
+    // The coefficients follow the ramps every ParameterRamp::controlChunk samples
+    void setModulatedParameter(int index, float value, int rampSamples) override
+    {
+        if ((Target) index == Target::frequency)
+            frequencyRamp.glideTo(value, rampSamples);
+        else
+            qRamp.glideTo(value, rampSamples);
+    }
+
 private:
+    enum class Target { frequency, q };
+
+    // Modulated settings are too many to be worth sharing: compute them in
+    // place, without touching the cache or the heap
+    void computeModulatedCoefficients()
+    {
+        if (sampleRate > 0)
+        {
+            using ArrayCoefficients = juce::dsp::IIR::ArrayCoefficients<SampleType>;
+
+            const auto f = (SampleType) juce::jlimit(10.0, sampleRate * 0.49, (double) frequency);
+            const auto resonance = (SampleType) q;
+
+            if (type == "HighPass")
+                *filter.state = ArrayCoefficients::makeHighPass(sampleRate, f, resonance);
+            else if (type == "BandPass")
+                *filter.state = ArrayCoefficients::makeBandPass(sampleRate, f, resonance);
+            else if (type == "LowPass")
+                *filter.state = ArrayCoefficients::makeLowPass(sampleRate, f, resonance);
+        }
+    }
+
     void updateCoefficients()
     {
         if (sampleRate <= 0) return;
@@ -61,27 +114,53 @@ private:
 
         // Correct approach: Update 'filter.state' directly.
 
-        typename juce::dsp::IIR::Coefficients<float>::Ptr newCoeffs;
+        sharedCoefficients = getSharedCoefficients(type, sampleRate, frequency, q);
 
-        if (type == "LowPass")
-            newCoeffs = juce::dsp::IIR::Coefficients<float>::makeLowPass(sampleRate, frequency, q);
-        else if (type == "HighPass")
-            newCoeffs = juce::dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, frequency, q);
-        else if (type == "BandPass")
-            newCoeffs = juce::dsp::IIR::Coefficients<float>::makeBandPass(sampleRate, frequency, q);
-
-        if (newCoeffs)
+        if (sharedCoefficients)
         {
-            *filter.state = *newCoeffs;
+            *filter.state = *sharedCoefficients;
         }
     }
 
+    // Identical filters across instances share one coefficient set from the SharedResourceCache
+    static std::shared_ptr<const juce::dsp::IIR::Coefficients<SampleType>> getSharedCoefficients(const std::string& type, double sampleRate, float frequency, float q)
+    {
+        using Coefficients = juce::dsp::IIR::Coefficients<SampleType>;
+
+        auto key = SharedResourceCache::hash(juce::String(type));
+        key = SharedResourceCache::hashValue(sampleRate, key);
+        key = SharedResourceCache::hashValue(frequency, key);
+        key = SharedResourceCache::hashValue(q, key);
+
+        const auto kind = juce::String("IIRCoefficients/") + juce::String((int) sizeof(SampleType));
+
+        return SharedResourceCache::getInstance().getOrCreate<Coefficients>({ kind, key }, [&]() -> std::unique_ptr<Coefficients>
+        {
+            typename Coefficients::Ptr newCoeffs;
+
+            if (type == "LowPass")
+                newCoeffs = Coefficients::makeLowPass(sampleRate, (SampleType) frequency, (SampleType) q);
+            else if (type == "HighPass")
+                newCoeffs = Coefficients::makeHighPass(sampleRate, (SampleType) frequency, (SampleType) q);
+            else if (type == "BandPass")
+                newCoeffs = Coefficients::makeBandPass(sampleRate, (SampleType) frequency, (SampleType) q);
+
+            if (newCoeffs == nullptr)
+                return nullptr;
+
+            return std::make_unique<Coefficients>(*newCoeffs);
+        },
+        [](const Coefficients& c) { return sizeof(Coefficients) + (size_t) c.coefficients.size() * sizeof(SampleType); });
+    }
+
     // Use ::Ptr type for the state so updates to 'state' are seen by 'filter'
-    typename juce::dsp::IIR::Coefficients<float>::Ptr state = juce::dsp::IIR::Coefficients<float>::makeLowPass(44100.0, 1000.0f);
-    juce::dsp::ProcessorDuplicator<juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Coefficients<float>> filter;
+    typename juce::dsp::IIR::Coefficients<SampleType>::Ptr state = juce::dsp::IIR::Coefficients<SampleType>::makeLowPass(44100.0, (SampleType) 1000);
+    juce::dsp::ProcessorDuplicator<juce::dsp::IIR::Filter<SampleType>, juce::dsp::IIR::Coefficients<SampleType>> filter;
+    std::shared_ptr<const juce::dsp::IIR::Coefficients<SampleType>> sharedCoefficients;
 
     double sampleRate = 0;
     std::string type = "LowPass";
     float frequency = 1000.0f;
     float q = 0.707f;
+    ParameterRamp frequencyRamp, qRamp;
 };
@@ -1,16 +1,20 @@
 #pragma once
 #include "../AudioEffect.h"
 
-class GainEffect : public AudioEffect
+template <typename SampleType = float>
+class GainEffect : public AudioEffectBase<SampleType>
 {
 public:
+    using AudioEffectBase<SampleType>::getParameterValue;
+
     void prepare(const juce::dsp::ProcessSpec& spec) override
     {
+        sampleRate = spec.sampleRate;
         gain.prepare(spec);
         gain.setRampDurationSeconds(0.05); // Smooth parameter changes
     }
 
-    void process(const juce::dsp::ProcessContextReplacing<float>& context) override
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) override
     {
         gain.process(context);
     }
@@ -31,6 +35,29 @@ public:
             gain.setGainDecibels(getParameterValue(config, "gain_db"));
     }
 
+    ModulationTarget getModulationTarget(const juce::Identifier& id) const override
+    {
+        if (id == juce::Identifier("gain"))    return { (int) Target::gain, 0.0f, 100.0f };
+        if (id == juce::Identifier("gain_db")) return { (int) Target::gainDb, -100.0f, 40.0f };
+        return {};
+    }
+
+    void setModulatedParameter(int index, float value, int rampSamples) override
+    {
+        // Each ramp ends exactly when the next control value arrives, so the
+        // gain is linearly interpolated between control points
+        if (sampleRate > 0.0)
+            gain.setRampDurationSeconds(rampSamples / sampleRate);
+
+        if ((Target) index == Target::gain)
+            gain.setGainLinear((SampleType) value);
+        else
+            gain.setGainDecibels((SampleType) value);
+    }
+
 private:
-    juce::dsp::Gain<float> gain;
+    enum class Target { gain, gainDb };
+
+    juce::dsp::Gain<SampleType> gain;
+    double sampleRate = 0.0;
 };
@@ -0,0 +1,224 @@
+#pragma once
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_dsp/juce_dsp.h>
+#include "../SharedResourceCache.h"
+#include <complex>
+#include <memory>
+#include <vector>
+
+/**
+ * An impulse response split for two-stage partitioned convolution.
+ *
+ * The first headLength samples are cut into small partitions of
+ * headPartitionSize samples and convolved on the audio thread. Everything after
+ * that is cut into tail partitions of tailPartitionSize samples. Each partition
+ * is stored as a spectrum of size partitionSize + 1 (FFT size
+ * 2 * partitionSize). Instances are immutable once built so they can be shared
+ * between any number of effects.
+ */
+struct PartitionedImpulse
+{
+    using Spectrum = std::vector<std::complex<float>>;
+    using Partitions = std::vector<std::vector<Spectrum>>; // [channel][partition]
+
+    static constexpr int headPartitionSize = 128;
+
+    double sampleRate = 0.0;
+    int numChannels = 0;
+    int headLength = 0;
+    int tailPartitionSize = 0;
+
+    Partitions headPartitions;
+    Partitions tailPartitions;
+
+    int getNumHeadPartitions() const
+    {
+        return headPartitions.empty() ? 0 : (int) headPartitions.front().size();
+    }
+
+    int getNumTailPartitions() const
+    {
+        return tailPartitions.empty() ? 0 : (int) tailPartitions.front().size();
+    }
+
+    size_t getSizeInBytes() const
+    {
+        size_t bytes = 0;
+        for (const auto* partitions : { &headPartitions, &tailPartitions })
+            for (const auto& channel : *partitions)
+                for (const auto& spectrum : channel)
+                    bytes += spectrum.size() * sizeof(std::complex<float>);
+        return bytes;
+    }
+};
+
+/**
+ * Loads and partitions impulse responses through the SharedResourceCache.
+ *
+ * Entries are keyed by file, size, modification time, target sample rate and
+ * partitioning, so every instance using the same hall shares one set of
+ * frequency-domain partitions.
+ */
+class ImpulseResponseCache
+{
+public:
+    static ImpulseResponseCache& getInstance()
+    {
+        static ImpulseResponseCache instance;
+        return instance;
+    }
+
+    std::shared_ptr<const PartitionedImpulse> get(const juce::File& file, double sampleRate,
+                                                  int tailPartitionSize, bool normalise)
+    {
+        const auto description = file.getFullPathName()
+                               + "|" + juce::String(file.getSize())
+                               + "|" + juce::String(file.getLastModificationTime().toMilliseconds())
+                               + "|" + juce::String(sampleRate)
+                               + "|" + juce::String(tailPartitionSize)
+                               + "|" + (normalise ? "n" : "r");
+
+        return SharedResourceCache::getInstance().getOrCreate<PartitionedImpulse>(
+            { "ImpulseResponse", SharedResourceCache::hash(description) },
+            [&] { return build(file, sampleRate, tailPartitionSize, normalise); },
+            [](const PartitionedImpulse& ir) { return ir.getSizeInBytes(); });
+    }
+
+    // Whether the file is audio a reader can open; reads the header only
+    static bool canRead(const juce::File& file)
+    {
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+
+        std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(file));
+        return reader != nullptr && reader->lengthInSamples > 0;
+    }
+
+private:
+    ImpulseResponseCache() = default;
+
+    static bool readFile(const juce::File& file, juce::AudioBuffer<float>& dest, double& fileSampleRate)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader;
+
+        // Prefer a memory-mapped WAV reader so large halls are paged in by the OS
+        // rather than copied through a stream.
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(wav.createMemoryMappedReader(file));
+        if (mapped != nullptr && mapped->mapEntireFile())
+        {
+            reader = std::move(mapped);
+        }
+        else
+        {
+            juce::AudioFormatManager formats;
+            formats.registerBasicFormats();
+            reader.reset(formats.createReaderFor(file));
+        }
+
+        if (reader == nullptr || reader->lengthInSamples <= 0)
+            return false;
+
+        const auto numChannels = juce::jlimit(1, 2, (int) reader->numChannels);
+        const auto numSamples = (int) reader->lengthInSamples;
+
+        dest.setSize(numChannels, numSamples);
+        reader->read(&dest, 0, numSamples, 0, true, numChannels > 1);
+        fileSampleRate = reader->sampleRate;
+        return true;
+    }
+
+    static juce::AudioBuffer<float> resample(const juce::AudioBuffer<float>& source, double sourceRate, double destRate)
+    {
+        const auto ratio = sourceRate / destRate;
+        const auto finalSize = juce::roundToInt(juce::jmax(1.0, source.getNumSamples() / ratio));
+
+        juce::AudioBuffer<float> original(source);
+        juce::MemoryAudioSource memorySource(original, false);
+        juce::ResamplingAudioSource resampler(&memorySource, false, source.getNumChannels());
+        resampler.setResamplingRatio(ratio);
+        resampler.prepareToPlay(finalSize, sourceRate);
+
+        juce::AudioBuffer<float> result(source.getNumChannels(), finalSize);
+        resampler.getNextAudioBlock({ &result, 0, result.getNumSamples() });
+        return result;
+    }
+
+    static std::unique_ptr<PartitionedImpulse> build(const juce::File& file, double sampleRate,
+                                                     int tailPartitionSize, bool normalise)
+    {
+        juce::AudioBuffer<float> ir;
+        double fileRate = 0.0;
+
+        if (sampleRate <= 0.0 || !file.existsAsFile() || !readFile(file, ir, fileRate))
+            return nullptr;
+
+        if (fileRate > 0.0 && fileRate != sampleRate)
+            ir = resample(ir, fileRate, sampleRate);
+
+        if (normalise)
+        {
+            float energy = 0.0f;
+            for (int ch = 0; ch < ir.getNumChannels(); ++ch)
+            {
+                auto* data = ir.getReadPointer(ch);
+                float channelEnergy = 0.0f;
+                for (int i = 0; i < ir.getNumSamples(); ++i)
+                    channelEnergy += data[i] * data[i];
+                energy = juce::jmax(energy, channelEnergy);
+            }
+
+            if (energy > 0.0f)
+                ir.applyGain(0.125f / std::sqrt(energy));
+        }
+
+        auto result = std::make_unique<PartitionedImpulse>();
+        result->sampleRate = sampleRate;
+        result->numChannels = ir.getNumChannels();
+        result->tailPartitionSize = tailPartitionSize;
+
+        // The tail worker has one full partition period to deliver each block, so
+        // the head has to cover the first two partitions.
+        const auto totalLength = ir.getNumSamples();
+        result->headLength = juce::jmin(totalLength, 2 * tailPartitionSize);
+
+        result->headPartitions = partition(ir, 0, result->headLength, PartitionedImpulse::headPartitionSize);
+        result->tailPartitions = partition(ir, result->headLength, totalLength - result->headLength, tailPartitionSize);
+        return result;
+    }
+
+    // Spectra of consecutive partitionSize-sample slices of ir from start
+    static PartitionedImpulse::Partitions partition(const juce::AudioBuffer<float>& ir, int start, int length, int partitionSize)
+    {
+        const auto numPartitions = (length + partitionSize - 1) / partitionSize;
+        const auto fftSize = 2 * partitionSize;
+        const auto numBins = partitionSize + 1;
+
+        juce::dsp::FFT fft(juce::roundToInt(std::log2((double) fftSize)));
+        std::vector<float> fftData((size_t) (2 * fftSize));
+
+        PartitionedImpulse::Partitions result((size_t) ir.getNumChannels());
+        for (int ch = 0; ch < ir.getNumChannels(); ++ch)
+        {
+            auto& partitions = result[(size_t) ch];
+            partitions.resize((size_t) numPartitions);
+
+            for (int p = 0; p < numPartitions; ++p)
+            {
+                const auto offset = start + p * partitionSize;
+                const auto sliceLength = juce::jmin(partitionSize, start + length - offset);
+
+                std::fill(fftData.begin(), fftData.end(), 0.0f);
+                std::copy(ir.getReadPointer(ch, offset), ir.getReadPointer(ch, offset) + sliceLength, fftData.begin());
+                fft.performRealOnlyForwardTransform(fftData.data(), true);
+
+                auto& spectrum = partitions[(size_t) p];
+                spectrum.resize((size_t) numBins);
+                for (int k = 0; k < numBins; ++k)
+                    spectrum[(size_t) k] = { fftData[(size_t) (2 * k)], fftData[(size_t) (2 * k + 1)] };
+            }
+        }
+
+        return result;
+    }
+};
@@ -1,17 +1,26 @@
 #pragma once
 #include "../AudioEffect.h"
+#include <algorithm>
 
-class LadderFilterEffect : public AudioEffect
+template <typename SampleType = float>
+class LadderFilterEffect : public AudioEffectBase<SampleType>
 {
 public:
+    using AudioEffectBase<SampleType>::getParameterValue;
+    using AudioEffectBase<SampleType>::processInChunks;
+
     void prepare(const juce::dsp::ProcessSpec& spec) override
     {
         filter.prepare(spec);
     }
 
-    void process(const juce::dsp::ProcessContextReplacing<float>& context) override
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) override
     {
-        filter.process(context);
+        const auto gliding = std::any_of(ramps.begin(), ramps.end(), [](const auto& r) { return r.isGliding(); });
+
+        processInChunks(context, gliding,
+                        [this](int numSamples) { advanceRamps(numSamples); },
+                        [this](const auto& chunk) { filter.process(chunk); });
     }
 
     void reset() override
@@ -22,13 +31,13 @@ public:
     void configure(const juce::ValueTree& config) override
     {
         if (config.hasProperty("frequency") || config.getChildWithName("frequency").isValid())
-            filter.setCutoffFrequencyHz(getParameterValue(config, "frequency", 1000.0f));
+            configureTarget(Target::frequency, getParameterValue(config, "frequency", 1000.0f));
             
         if (config.hasProperty("resonance") || config.getChildWithName("resonance").isValid())
-            filter.setResonance(getParameterValue(config, "resonance", 0.0f));
+            configureTarget(Target::resonance, getParameterValue(config, "resonance", 0.0f));
             
         if (config.hasProperty("drive") || config.getChildWithName("drive").isValid())
-            filter.setDrive(getParameterValue(config, "drive", 1.0f));
+            configureTarget(Target::drive, getParameterValue(config, "drive", 1.0f));
 
         if (config.hasProperty("mode"))
         {
@@ -42,6 +51,48 @@ public:
         }
     }
 
+    ModulationTarget getModulationTarget(const juce::Identifier& id) const override
+    {
+        // The ranges juce::dsp::LadderFilter accepts
+        if (id == juce::Identifier("frequency")) return { (int) Target::frequency, 10.0f, 20000.0f };
+        if (id == juce::Identifier("resonance")) return { (int) Target::resonance, 0.0f, 1.0f };
+        if (id == juce::Identifier("drive"))     return { (int) Target::drive, 1.0f, 100.0f };
+        return {};
+    }
+
+    // The filter takes the ramps' values every ParameterRamp::controlChunk samples
+    void setModulatedParameter(int index, float value, int rampSamples) override
+    {
+        ramps[(size_t) index].glideTo(value, rampSamples);
+    }
+
 private:
-    juce::dsp::LadderFilter<float> filter;
+    enum class Target { frequency, resonance, drive, count };
+
+    void configureTarget(Target target, float value)
+    {
+        ramps[(size_t) target].setValue(value);
+        apply(target, (SampleType) value);
+    }
+
+    void advanceRamps(int numSamples)
+    {
+        for (size_t i = 0; i < ramps.size(); ++i)
+            if (ramps[i].isGliding())
+                apply((Target) i, (SampleType) ramps[i].advance(numSamples));
+    }
+
+    void apply(Target target, SampleType value)
+    {
+        switch (target)
+        {
+            case Target::frequency: filter.setCutoffFrequencyHz(value); break;
+            case Target::resonance: filter.setResonance(value); break;
+            case Target::drive:     filter.setDrive(value); break;
+            case Target::count:     break;
+        }
+    }
+
+    std::array<ParameterRamp, (size_t) Target::count> ramps;
+    juce::dsp::LadderFilter<SampleType> filter;
 };
@@ -1,32 +1,132 @@
 #pragma once
 #include "../AudioEffect.h"
+#include "DynamicsCore.h"
 
-class LimiterEffect : public AudioEffect
+/**
+ * juce::dsp::Limiter's design on the shared dynamics core: a gentle 4:1 stage
+ * into a brickwall stage, then make-up gain and a hard clip. Link applies to
+ * both stages; knee and lookahead to the brickwall stage.
+ */
+template <typename SampleType = float>
+class LimiterEffect : public AudioEffectBase<SampleType>
 {
 public:
+    using AudioEffectBase<SampleType>::getParameterValue;
+
+    LimiterEffect()
+    {
+        firstStage.setThreshold((SampleType) -10);
+        firstStage.setRatio((SampleType) 4);
+        firstStage.setAttack((SampleType) 2);
+        firstStage.setRelease((SampleType) 200);
+
+        secondStage.setRatio((SampleType) 1000);
+        secondStage.setAttack((SampleType) 0.001);
+        updateStages();
+    }
+
     void prepare(const juce::dsp::ProcessSpec& spec) override
     {
-        limiter.prepare(spec);
+        detector.prepare(spec);
+        firstStage.prepare(spec);
+        secondStage.prepare(spec);
+        outputVolume.reset(spec.sampleRate, 0.001);
+        updateStages();
+        outputVolume.setCurrentAndTargetValue(outputVolume.getTargetValue());
     }
 
-    void process(const juce::dsp::ProcessContextReplacing<float>& context) override
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) override
     {
-        limiter.process(context);
+        const auto& block = context.getOutputBlock();
+        const auto numSamples = (int) block.getNumSamples();
+
+        if (context.usesSeparateInputAndOutputBlocks())
+            block.copyFrom(context.getInputBlock());
+
+        if (context.isBypassed)
+            return;
+
+        if (detector.isActive())
+        {
+            // Sidechain or filtered key: after the first stage every channel is
+            // scaled by the same gain, so the second stage's key is just the
+            // first key times that gain
+            auto* key = detector.compute(block);
+            auto* gain = detector.getGainBuffer();
+
+            firstStage.computeGain(key, gain, numSamples);
+            firstStage.applyGain(block, gain);
+            juce::FloatVectorOperations::multiply(key, gain, numSamples);
+
+            secondStage.computeGain(key, key, numSamples);
+            secondStage.applyGain(block, key);
+        }
+        else
+        {
+            firstStage.process(block);
+            secondStage.process(block);
+        }
+
+        if (outputVolume.isSmoothing())
+        {
+            auto* gain = detector.getGainBuffer();
+            for (int i = 0; i < numSamples; ++i)
+                gain[i] = outputVolume.getNextValue();
+
+            for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+                juce::FloatVectorOperations::multiply(block.getChannelPointer(ch), gain, numSamples);
+        }
+        else
+        {
+            block.multiplyBy(outputVolume.getTargetValue());
+        }
+
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+        {
+            auto* data = block.getChannelPointer(ch);
+            juce::FloatVectorOperations::clip(data, data, (SampleType) -1, (SampleType) 1, numSamples);
+        }
     }
 
     void reset() override
     {
-        limiter.reset();
+        detector.reset();
+        firstStage.reset();
+        secondStage.reset();
+        outputVolume.setCurrentAndTargetValue(outputVolume.getTargetValue());
     }
 
+    int getMaximumChannels() const override { return Dynamics::Core<SampleType>::maxChannels; }
+    int getLatencySamples() const override { return secondStage.getLatencySamples(); }
 
+    bool wantsSidechain() const override { return detector.wantsSidechain(); }
+    void setSidechain(const juce::dsp::AudioBlock<const SampleType>& key) override { detector.setSidechain(key); }
 
     void configure(const juce::ValueTree& config) override
     {
-        if (config.hasProperty("threshold")) limiter.setThreshold(config.getProperty("threshold"));
-        if (config.hasProperty("release")) limiter.setRelease(config.getProperty("release"));
+        if (config.hasProperty("threshold")) thresholdDb = (SampleType) (double) config.getProperty("threshold");
+        if (config.hasProperty("release"))   secondStage.setRelease((SampleType) (double) config.getProperty("release"));
+
+        secondStage.configure(config);
+        firstStage.setLink(secondStage.getLink());
+        detector.configure(config);
+
+        updateStages();
     }
 
 private:
-    juce::dsp::Limiter<float> limiter;
+    void updateStages()
+    {
+        secondStage.setThreshold(thresholdDb);
+
+        const auto ratioInverse = (SampleType) 0.25;
+        auto gain = (SampleType) std::pow(10.0, 10.0 * (1.0 - ratioInverse) / 40.0);
+        gain *= juce::Decibels::decibelsToGain(-thresholdDb, (SampleType) -100);
+        outputVolume.setTargetValue(gain);
+    }
+
+    SampleType thresholdDb = -10;
+    Dynamics::KeyDetector<SampleType> detector;
+    Dynamics::Core<SampleType> firstStage { Dynamics::Curve::Compressor }, secondStage { Dynamics::Curve::Compressor };
+    juce::SmoothedValue<SampleType, juce::ValueSmoothingTypes::Linear> outputVolume;
 };
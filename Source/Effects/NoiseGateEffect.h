@@ -1,39 +1,126 @@
 #pragma once
 #include "../AudioEffect.h"
+#include "DynamicsCore.h"
+#include <algorithm>
 
-class NoiseGateEffect : public AudioEffect
+template <typename SampleType = float>
+class NoiseGateEffect : public AudioEffectBase<SampleType>
 {
 public:
+    using AudioEffectBase<SampleType>::getParameterValue;
+
     void prepare(const juce::dsp::ProcessSpec& spec) override
     {
         gate.prepare(spec);
+        detector.prepare(spec);
     }
 
-    void process(const juce::dsp::ProcessContextReplacing<float>& context) override
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) override
     {
-        gate.process(context);
+        const auto& block = context.getOutputBlock();
+
+        if (context.usesSeparateInputAndOutputBlocks())
+            block.copyFrom(context.getInputBlock());
+
+        if (context.isBypassed)
+            return;
+
+        // Sidechain or filtered key: one detector, same gain on every channel
+        const SampleType* key = detector.isActive() ? detector.compute(block) : nullptr;
+
+        // Modulated settings move every ParameterRamp::controlChunk samples
+        const auto gliding = std::any_of(ramps.begin(), ramps.end(), [](const auto& r) { return r.isGliding(); });
+        const auto numSamples = (int) block.getNumSamples();
+        const auto chunkSize = gliding ? ParameterRamp::controlChunk : numSamples;
+
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            const auto length = juce::jmin(chunkSize, numSamples - start);
+            if (gliding)
+                advanceRamps(length);
+
+            const auto chunk = block.getSubBlock((size_t) start, (size_t) length);
+            if (key != nullptr)
+                gate.process(chunk, key + start);
+            else
+                gate.process(chunk);
+        }
     }
 
     void reset() override
     {
         gate.reset();
+        detector.reset();
     }
 
+    int getMaximumChannels() const override { return Dynamics::Core<SampleType>::maxChannels; }
+    int getLatencySamples() const override { return gate.getLatencySamples(); }
+
+    bool wantsSidechain() const override { return detector.wantsSidechain(); }
+    void setSidechain(const juce::dsp::AudioBlock<const SampleType>& key) override { detector.setSidechain(key); }
+
     void configure(const juce::ValueTree& config) override
     {
         if (config.hasProperty("threshold") || config.getChildWithName("threshold").isValid())
-            gate.setThreshold(getParameterValue(config, "threshold", -60.0f));
-            
+            gate.setThreshold((SampleType) getParameterValue(config, "threshold", -60.0f));
+
         if (config.hasProperty("ratio") || config.getChildWithName("ratio").isValid())
-            gate.setRatio(getParameterValue(config, "ratio", 2.0f));
-            
+            gate.setRatio((SampleType) getParameterValue(config, "ratio", 2.0f));
+
         if (config.hasProperty("attack") || config.getChildWithName("attack").isValid())
-            gate.setAttack(getParameterValue(config, "attack", 2.0f));
-            
+            gate.setAttack((SampleType) getParameterValue(config, "attack", 2.0f));
+
         if (config.hasProperty("release") || config.getChildWithName("release").isValid())
-            gate.setRelease(getParameterValue(config, "release", 100.0f));
+            gate.setRelease((SampleType) getParameterValue(config, "release", 100.0f));
+
+        gate.configure(config);
+        detector.configure(config);
+
+        ramps[(size_t) Target::threshold].setValue((float) gate.getThreshold());
+        ramps[(size_t) Target::ratio].setValue((float) gate.getRatio());
+        ramps[(size_t) Target::attack].setValue((float) gate.getAttack());
+        ramps[(size_t) Target::release].setValue((float) gate.getRelease());
+    }
+
+    ModulationTarget getModulationTarget(const juce::Identifier& id) const override
+    {
+        if (id == juce::Identifier("threshold")) return { (int) Target::threshold, -100.0f, 0.0f };
+        if (id == juce::Identifier("ratio"))     return { (int) Target::ratio, 1.0f, 100.0f };
+        if (id == juce::Identifier("attack"))    return { (int) Target::attack, 0.0f, 1000.0f };
+        if (id == juce::Identifier("release"))   return { (int) Target::release, 0.0f, 5000.0f };
+        return {};
+    }
+
+    void setModulatedParameter(int index, float value, int rampSamples) override
+    {
+        ramps[(size_t) index].glideTo(value, rampSamples);
     }
 
 private:
-    juce::dsp::NoiseGate<float> gate;
+    enum class Target { threshold, ratio, attack, release, count };
+
+    void advanceRamps(int numSamples)
+    {
+        for (size_t i = 0; i < ramps.size(); ++i)
+        {
+            if (!ramps[i].isGliding())
+                continue;
+
+            const auto value = (SampleType) ramps[i].advance(numSamples);
+
+            switch ((Target) i)
+            {
+                case Target::threshold: gate.setThreshold(value); break;
+                case Target::ratio:     gate.setRatio(value); break;
+                case Target::attack:    gate.setAttack(value); break;
+                case Target::release:   gate.setRelease(value); break;
+                case Target::count:     break;
+            }
+        }
+    }
+
+    std::array<ParameterRamp, (size_t) Target::count> ramps;
+
+    Dynamics::Core<SampleType> gate { Dynamics::Curve::Gate };
+    Dynamics::KeyDetector<SampleType> detector;
 };
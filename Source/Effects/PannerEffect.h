@@ -1,19 +1,27 @@
 #pragma once
 #include "../AudioEffect.h"
 
-class PannerEffect : public AudioEffect
+template <typename SampleType = float>
+class PannerEffect : public AudioEffectBase<SampleType>
 {
 public:
+    using AudioEffectBase<SampleType>::getParameterValue;
+    using AudioEffectBase<SampleType>::processInChunks;
+
     void prepare(const juce::dsp::ProcessSpec& spec) override
     {
         panner.prepare(spec);
     }
 
-    void process(const juce::dsp::ProcessContextReplacing<float>& context) override
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) override
     {
-        panner.process(context);
+        processInChunks(context, pan.isGliding(),
+                        [this](int numSamples) { panner.setPan((SampleType) pan.advance(numSamples)); },
+                        [this](const auto& chunk) { panner.process(chunk); });
     }
 
+    int getMaximumChannels() const override { return 2; }
+
     void reset() override
     {
         panner.reset();
@@ -22,7 +30,10 @@ public:
     void configure(const juce::ValueTree& config) override
     {
         if (config.hasProperty("pan") || config.getChildWithName("pan").isValid())
-            panner.setPan(getParameterValue(config, "pan", 0.0f));
+        {
+            pan.setValue(getParameterValue(config, "pan", 0.0f));
+            panner.setPan((SampleType) pan.getValue());
+        }
             
         if (config.hasProperty("rule"))
         {
@@ -36,6 +47,20 @@ public:
         }
     }
 
+    ModulationTarget getModulationTarget(const juce::Identifier& id) const override
+    {
+        if (id == juce::Identifier("pan"))
+            return { 0, -1.0f, 1.0f };
+
+        return {};
+    }
+
+    void setModulatedParameter(int, float value, int rampSamples) override
+    {
+        pan.glideTo(value, rampSamples);
+    }
+
 private:
-    juce::dsp::Panner<float> panner;
+    ParameterRamp pan;
+    juce::dsp::Panner<SampleType> panner;
 };
@@ -1,42 +1,151 @@
 #pragma once
 #include "../AudioEffect.h"
+#include "Ensemble.h"
+#include <algorithm>
 
-class PhaserEffect : public AudioEffect
+template <typename SampleType = float>
+class PhaserEffect : public AudioEffectBase<SampleType>
 {
 public:
+    using AudioEffectBase<SampleType>::getParameterValue;
+    using AudioEffectBase<SampleType>::processInChunks;
+
     void prepare(const juce::dsp::ProcessSpec& spec) override
     {
+        processSpec = spec;
         phaser.prepare(spec);
+
+        if (ensemble)
+            ensemble->prepare(spec);
     }
 
-    void process(const juce::dsp::ProcessContextReplacing<float>& context) override
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) override
     {
-        phaser.process(context);
+        const auto gliding = std::any_of(ramps.begin(), ramps.end(), [](const auto& r) { return r.isGliding(); });
+
+        processInChunks(context, gliding,
+                        [this](int numSamples) { advanceRamps(numSamples); },
+                        [this](const auto& chunk)
+                        {
+                            if (ensemble)
+                                ensemble->process(chunk);
+                            else
+                                phaser.process(chunk);
+                        });
     }
 
     void reset() override
     {
         phaser.reset();
+
+        if (ensemble)
+            ensemble->reset();
     }
 
     void configure(const juce::ValueTree& config) override
     {
+        // "mode: ensemble" selects the multi-voice engine, anything else juce::dsp::Phaser
+        if (config.hasProperty("mode"))
+        {
+            if (!config.getProperty("mode").toString().equalsIgnoreCase("ensemble"))
+                ensemble.reset();
+            else if (!ensemble)
+                createEnsemble();
+        }
+
+        if (config.hasProperty("voices"))
+            ensembleParams.voices = (int) config.getProperty("voices");
+
+        if (config.hasProperty("spread"))
+            ensembleParams.spread = (SampleType) (float) config.getProperty("spread");
+
         if (config.hasProperty("rate") || config.getChildWithName("rate").isValid())
-            phaser.setRate(getParameterValue(config, "rate", 1.0f));
+            phaser.setRate(ensembleParams.rate = getParameterValue(config, "rate", 1.0f));
             
         if (config.hasProperty("depth") || config.getChildWithName("depth").isValid())
-            phaser.setDepth(getParameterValue(config, "depth", 0.5f));
+            phaser.setDepth(ensembleParams.depth = getParameterValue(config, "depth", 0.5f));
             
         if (config.hasProperty("frequency") || config.getChildWithName("frequency").isValid())
-            phaser.setCentreFrequency(getParameterValue(config, "frequency", 1000.0f));
+            phaser.setCentreFrequency(ensembleParams.centreFrequency = getParameterValue(config, "frequency", 1000.0f));
             
         if (config.hasProperty("feedback") || config.getChildWithName("feedback").isValid())
-            phaser.setFeedback(getParameterValue(config, "feedback", 0.0f));
+            phaser.setFeedback(ensembleParams.feedback = getParameterValue(config, "feedback", 0.0f));
             
         if (config.hasProperty("mix") || config.getChildWithName("mix").isValid())
-            phaser.setMix(getParameterValue(config, "mix", 0.5f));
+            phaser.setMix(ensembleParams.mix = getParameterValue(config, "mix", 0.5f));
+
+        if (ensemble)
+            ensemble->setParameters(ensembleParams);
+
+        ramps[(size_t) Target::rate].setValue((float) ensembleParams.rate);
+        ramps[(size_t) Target::depth].setValue((float) ensembleParams.depth);
+        ramps[(size_t) Target::frequency].setValue((float) ensembleParams.centreFrequency);
+        ramps[(size_t) Target::feedback].setValue((float) ensembleParams.feedback);
+        ramps[(size_t) Target::mix].setValue((float) ensembleParams.mix);
+    }
+
+    ModulationTarget getModulationTarget(const juce::Identifier& id) const override
+    {
+        // The ranges juce::dsp::Phaser accepts; the frequency is also kept
+        // below Nyquist as it is applied
+        if (id == juce::Identifier("rate"))      return { (int) Target::rate, 0.0f, 99.0f };
+        if (id == juce::Identifier("depth"))     return { (int) Target::depth, 0.0f, 1.0f };
+        if (id == juce::Identifier("frequency")) return { (int) Target::frequency, 10.0f, 20000.0f };
+        if (id == juce::Identifier("feedback"))  return { (int) Target::feedback, -1.0f, 1.0f };
+        if (id == juce::Identifier("mix"))       return { (int) Target::mix, 0.0f, 1.0f };
+        return {};
+    }
+
+    // The processors take the ramps' values every ParameterRamp::controlChunk samples
+    void setModulatedParameter(int index, float value, int rampSamples) override
+    {
+        ramps[(size_t) index].glideTo(value, rampSamples);
     }
 
 private:
-    juce::dsp::Phaser<float> phaser;
+    enum class Target { rate, depth, frequency, feedback, mix, count };
+
+    void advanceRamps(int numSamples)
+    {
+        for (size_t i = 0; i < ramps.size(); ++i)
+            if (ramps[i].isGliding())
+                apply((Target) i, (SampleType) ramps[i].advance(numSamples));
+
+        if (ensemble)
+            ensemble->setParameters(ensembleParams);
+    }
+
+    void apply(Target target, SampleType value)
+    {
+        switch (target)
+        {
+            case Target::rate:     phaser.setRate(ensembleParams.rate = value); break;
+            case Target::depth:    phaser.setDepth(ensembleParams.depth = value); break;
+            case Target::feedback: phaser.setFeedback(ensembleParams.feedback = value); break;
+            case Target::mix:      phaser.setMix(ensembleParams.mix = value); break;
+            case Target::count:    break;
+
+            case Target::frequency:
+            {
+                const auto nyquist = processSpec.sampleRate > 0.0 ? (SampleType) (processSpec.sampleRate * 0.49) : (SampleType) 20000;
+                phaser.setCentreFrequency(ensembleParams.centreFrequency = juce::jmin(value, nyquist));
+                break;
+            }
+        }
+    }
+
+    void createEnsemble()
+    {
+        ensemble = std::make_unique<EnsemblePhaser<SampleType>>();
+        ensemble->setParameters(ensembleParams);
+
+        if (processSpec.sampleRate > 0.0)
+            ensemble->prepare(processSpec);
+    }
+
+    juce::dsp::Phaser<SampleType> phaser;
+    std::unique_ptr<EnsemblePhaser<SampleType>> ensemble;
+    typename EnsemblePhaser<SampleType>::Parameters ensembleParams;
+    juce::dsp::ProcessSpec processSpec {};
+    std::array<ParameterRamp, (size_t) Target::count> ramps;
 };
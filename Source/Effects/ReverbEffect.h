@@ -1,26 +1,62 @@
 #pragma once
 #include "../AudioEffect.h"
+#include "FdnReverb.h"
+#include <algorithm>
 
 class ReverbEffect : public AudioEffect
 {
 public:
     void prepare(const juce::dsp::ProcessSpec& spec) override
     {
+        sampleRate = spec.sampleRate;
         reverb.prepare(spec);
+
+        if (fdn)
+            fdn->prepare(sampleRate);
     }
 
     void process(const juce::dsp::ProcessContextReplacing<float>& context) override
     {
-        reverb.process(context);
+        if (fdn && context.usesSeparateInputAndOutputBlocks())
+            context.getOutputBlock().copyFrom(context.getInputBlock());
+
+        const auto gliding = std::any_of(ramps.begin(), ramps.end(), [](const auto& r) { return r.isGliding(); });
+
+        processInChunks(context, gliding,
+                        [this](int numSamples) { advanceRamps(numSamples); },
+                        [this](const auto& chunk)
+                        {
+                            if (fdn)
+                                fdn->process(chunk.getOutputBlock());
+                            else
+                                reverb.process(chunk);
+                        });
     }
 
+    int getMaximumChannels() const override { return 2; }
+
     void reset() override
     {
         reverb.reset();
+
+        if (fdn)
+            fdn->reset();
     }
 
     void configure(const juce::ValueTree& config) override
     {
+        // "mode: fdn" selects the feedback delay network, anything else the classic (Freeverb) engine
+        if (config.hasProperty("mode") || config.hasProperty("lines"))
+        {
+            const auto useFdn = config.getProperty("mode", fdn ? "fdn" : "classic").toString().equalsIgnoreCase("fdn");
+            const auto numLines = (int) config.getProperty("lines", fdnLines) >= 16 ? 16 : 8;
+
+            if (!useFdn)
+                fdn.reset();
+            else if (!fdn || numLines != fdnLines)
+                createFdn(numLines);
+        }
+
         auto params = reverb.getParameters();
         
         if (config.hasProperty("room_size") || config.getChildWithName("room_size").isValid())
@@ -39,8 +75,85 @@ public:
             params.width = getParameterValue(config, "width", 1.0f);
             
         reverb.setParameters(params);
+
+        if (fdn)
+            fdn->setParameters(params);
+
+        ramps[(size_t) Target::roomSize].setValue(params.roomSize);
+        ramps[(size_t) Target::damping].setValue(params.damping);
+        ramps[(size_t) Target::wet].setValue(params.wetLevel);
+        ramps[(size_t) Target::dry].setValue(params.dryLevel);
+        ramps[(size_t) Target::width].setValue(params.width);
+    }
+
+    // The levels and room settings only; the engine and its size ("mode",
+    // "lines") are fixed once built
+    ModulationTarget getModulationTarget(const juce::Identifier& id) const override
+    {
+        if (id == juce::Identifier("room_size")) return { (int) Target::roomSize, 0.0f, 1.0f };
+        if (id == juce::Identifier("damping"))   return { (int) Target::damping, 0.0f, 1.0f };
+        if (id == juce::Identifier("wet"))       return { (int) Target::wet, 0.0f, 1.0f };
+        if (id == juce::Identifier("dry"))       return { (int) Target::dry, 0.0f, 1.0f };
+        if (id == juce::Identifier("width"))     return { (int) Target::width, 0.0f, 1.0f };
+        return {};
+    }
+
+    // The engines take the ramps' values every ParameterRamp::controlChunk samples
+    void setModulatedParameter(int index, float value, int rampSamples) override
+    {
+        ramps[(size_t) index].glideTo(value, rampSamples);
     }
 
 private:
+    enum class Target { roomSize, damping, wet, dry, width, count };
+
+    void advanceRamps(int numSamples)
+    {
+        auto params = reverb.getParameters();
+
+        for (size_t i = 0; i < ramps.size(); ++i)
+        {
+            if (!ramps[i].isGliding())
+                continue;
+
+            const auto value = ramps[i].advance(numSamples);
+
+            switch ((Target) i)
+            {
+                case Target::roomSize: params.roomSize = value; break;
+                case Target::damping:  params.damping = value; break;
+                case Target::wet:      params.wetLevel = value; break;
+                case Target::dry:      params.dryLevel = value; break;
+                case Target::width:    params.width = value; break;
+                case Target::count:    break;
+            }
+        }
+
+        reverb.setParameters(params);
+
+        if (fdn)
+            fdn->setParameters(params);
+    }
+
+    void createFdn(int numLines)
+    {
+        fdnLines = numLines;
+
+        if (numLines == 16)
+            fdn = std::make_unique<FdnReverb<16>>();
+        else
+            fdn = std::make_unique<FdnReverb<8>>();
+
+        fdn->setParameters(reverb.getParameters());
+
+        if (sampleRate > 0.0)
+            fdn->prepare(sampleRate);
+    }
+
+    std::array<ParameterRamp, (size_t) Target::count> ramps;
+
     juce::dsp::Reverb reverb;
+    std::unique_ptr<FdnReverbEngine> fdn;
+    int fdnLines = 16;
+    double sampleRate = 0.0;
 };
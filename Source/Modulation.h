@@ -0,0 +1,216 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_data_structures/juce_data_structures.h>
+#include <functional>
+#include <vector>
+
+/**
+ * A control-rate modulation source declared in a preset:
+ *
+ *   - type: Modulator
+ *     name: wobble
+ *     source: lfo          # lfo | envelope | random | step
+ *     rate: 0.5            # Hz (cycles, new random values or steps per second)
+ *
+ * LFO, random and step sources are bipolar (-1..1) unless "polarity: unipolar";
+ * the envelope follower is always 0..1 and tracks the audio at its position in
+ * the chain.
+ */
+class Modulator
+{
+public:
+    enum class Source { LFO, Envelope, Random, Step };
+    enum class Shape { Sine, Triangle, Saw, Square };
+
+    void configure(const juce::ValueTree& config)
+    {
+        name = config.getProperty("name").toString();
+
+        const auto sourceStr = config.getProperty("source", "lfo").toString().trim().toLowerCase();
+        if (sourceStr == "envelope" || sourceStr == "follower") source = Source::Envelope;
+        else if (sourceStr == "random")                          source = Source::Random;
+        else if (sourceStr == "step" || sourceStr == "steps")    source = Source::Step;
+        else                                                     source = Source::LFO;
+
+        const auto shapeStr = config.getProperty("shape", "sine").toString().trim().toLowerCase();
+        if (shapeStr == "triangle")    shape = Shape::Triangle;
+        else if (shapeStr == "saw")    shape = Shape::Saw;
+        else if (shapeStr == "square") shape = Shape::Square;
+        else                           shape = Shape::Sine;
+
+        rateHz = juce::jmax(0.0, (double) config.getProperty("rate", 1.0));
+        startPhase = std::fmod(juce::jmax(0.0, (double) config.getProperty("phase", 0.0)), 1.0);
+        unipolar = config.getProperty("polarity", "bipolar").toString().equalsIgnoreCase("unipolar");
+        smooth = (bool) config.getProperty("smooth", false);
+        seed = (juce::int64) config.getProperty("seed", 1);
+
+        attackMs = juce::jmax(0.0, (double) config.getProperty("attack", 10.0));
+        releaseMs = juce::jmax(0.0, (double) config.getProperty("release", 150.0));
+
+        controlRateHz = juce::jlimit(10.0, 48000.0, (double) config.getProperty("control_rate", 1000.0));
+
+        steps.clear();
+        for (const auto& item : config.getChildWithName("steps"))
+            steps.push_back((float) item.getProperty("value"));
+        if (steps.empty())
+            steps.push_back(0.0f);
+    }
+
+    void prepare(double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        attackCoeff = getCoefficient(attackMs);
+        releaseCoeff = getCoefficient(releaseMs);
+        reset();
+    }
+
+    void reset()
+    {
+        phase = startPhase;
+        stepIndex = 0;
+        envelope = 0.0f;
+        random.setSeed(seed);
+        previousRandom = nextRandom();
+        currentRandom = nextRandom();
+        value = computeValue();
+    }
+
+    // Moves time-based sources on by numSamples; getValue() is then the value at
+    // the end of that span.
+    void advance(int numSamples)
+    {
+        if (source == Source::Envelope || sampleRate <= 0.0)
+            return;
+
+        phase += rateHz * numSamples / sampleRate;
+
+        if (phase >= 1.0)
+        {
+            const auto cycles = std::floor(phase);
+            phase -= cycles;
+
+            if (source == Source::Random)
+            {
+                previousRandom = currentRandom;
+                currentRandom = nextRandom();
+            }
+            else if (source == Source::Step)
+            {
+                stepIndex = (stepIndex + (int) cycles) % (int) steps.size();
+            }
+        }
+
+        value = computeValue();
+    }
+
+    // Envelope follower: peak of all channels with separate attack and release
+    template <typename SampleType>
+    void follow(const juce::AudioBuffer<SampleType>& buffer)
+    {
+        if (source != Source::Envelope)
+            return;
+
+        auto env = envelope;
+        const auto numChannels = buffer.getNumChannels();
+
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        {
+            float peak = 0.0f;
+            for (int ch = 0; ch < numChannels; ++ch)
+                peak = juce::jmax(peak, (float) std::abs(buffer.getReadPointer(ch)[i]));
+
+            env = peak + (peak > env ? attackCoeff : releaseCoeff) * (env - peak);
+        }
+
+        envelope = env;
+        value = juce::jlimit(0.0f, 1.0f, envelope);
+    }
+
+    float getValue() const { return value; }
+    bool isEnvelope() const { return source == Source::Envelope; }
+
+    const juce::String& getName() const { return name; }
+    double getControlRate() const { return controlRateHz; }
+
+private:
+    float getCoefficient(double timeMs) const
+    {
+        return timeMs > 0.0 ? (float) std::exp(-1000.0 / (timeMs * sampleRate)) : 0.0f;
+    }
+
+    float nextRandom() { return random.nextFloat() * 2.0f - 1.0f; }
+
+    float computeValue() const
+    {
+        float v = 0.0f;
+        const auto p = (float) phase;
+
+        switch (source)
+        {
+            case Source::LFO:
+                switch (shape)
+                {
+                    case Shape::Sine:     v = std::sin(juce::MathConstants<float>::twoPi * p); break;
+                    case Shape::Triangle: v = 1.0f - 4.0f * std::abs(p - 0.5f); break;
+                    case Shape::Saw:      v = 2.0f * p - 1.0f; break;
+                    case Shape::Square:   v = p < 0.5f ? 1.0f : -1.0f; break;
+                }
+                break;
+
+            case Source::Random:
+                v = smooth ? previousRandom + p * (currentRandom - previousRandom) : currentRandom;
+                break;
+
+            case Source::Step:
+                v = juce::jlimit(-1.0f, 1.0f, steps[(size_t) stepIndex]);
+                break;
+
+            case Source::Envelope:
+                return juce::jlimit(0.0f, 1.0f, envelope);
+        }
+
+        return unipolar ? 0.5f * (v + 1.0f) : v;
+    }
+
+    juce::String name;
+    Source source = Source::LFO;
+    Shape shape = Shape::Sine;
+
+    double rateHz = 1.0, startPhase = 0.0, controlRateHz = 1000.0;
+    double attackMs = 10.0, releaseMs = 150.0;
+    bool unipolar = false, smooth = false;
+    juce::int64 seed = 1;
+    std::vector<float> steps;
+
+    double sampleRate = 0.0;
+    double phase = 0.0;
+    int stepIndex = 0;
+    float attackCoeff = 0.0f, releaseCoeff = 0.0f, envelope = 0.0f;
+    juce::Random random;
+    float previousRandom = 0.0f, currentRandom = 0.0f;
+    float value = 0.0f;
+};
+
+/**
+ * One modulated parameter: value = base + amount * source, clamped to the
+ * range the effect accepts, narrowed by the preset's min/max when given:
+ *
+ *   frequency: { value: 800, mod: wobble, amount: 600, min: 20, max: 20000 }
+ */
+struct ModulationRoute
+{
+    const Modulator* source = nullptr;
+    float base = 0.0f;
+    float amount = 1.0f;
+    float minValue = std::numeric_limits<float>::lowest();
+    float maxValue = std::numeric_limits<float>::max();
+
+    // Sets the target parameter, gliding to it over rampSamples where the effect can
+    std::function<void(float value, int rampSamples)> apply;
+
+    void update(int rampSamples) const
+    {
+        apply(juce::jlimit(minValue, maxValue, base + amount * source->getValue()), rampSamples);
+    }
+};
@@ -0,0 +1,400 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_dsp/juce_dsp.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+/**
+ * Level and loudness meters on effect outputs.
+ *
+ * Every effect in a preset has a slot, numbered like the names the sentinel
+ * reports ("Delay #3" is slot 3). A node only measures while its slot has
+ * subscribers; until then metering costs it one relaxed atomic load per
+ * block. Readings are published through atomics every 100 ms, so readers
+ * never wait on the audio thread.
+ */
+class NodeMeters
+{
+public:
+    static constexpr int maxSlots = 256;
+
+    struct Reading
+    {
+        float peak = 0.0f;              // sample peak over the last 100 ms, linear
+        float rms = 0.0f;               // over the last 400 ms and all channels, linear
+        float momentary = -100.0f;      // LUFS, K-weighted over 400 ms
+        float shortTerm = -100.0f;      // LUFS, K-weighted over 3 s
+        float truePeak = 0.0f;          // 4x oversampled peak over the last 100 ms, linear
+        float truePeakHold = 0.0f;      // highest true peak since clearHold()
+    };
+
+    class Slot
+    {
+    public:
+        bool isSubscribed() const { return subscribers.load(std::memory_order_relaxed) > 0; }
+
+        void publish(const Reading& r)
+        {
+            peak.store(r.peak, std::memory_order_relaxed);
+            rms.store(r.rms, std::memory_order_relaxed);
+            momentary.store(r.momentary, std::memory_order_relaxed);
+            shortTerm.store(r.shortTerm, std::memory_order_relaxed);
+            truePeak.store(r.truePeak, std::memory_order_relaxed);
+
+            if (r.truePeak > truePeakHold.load(std::memory_order_relaxed))
+                truePeakHold.store(r.truePeak, std::memory_order_relaxed);
+        }
+
+        Reading read() const
+        {
+            return { peak.load(std::memory_order_relaxed), rms.load(std::memory_order_relaxed),
+                     momentary.load(std::memory_order_relaxed), shortTerm.load(std::memory_order_relaxed),
+                     truePeak.load(std::memory_order_relaxed), truePeakHold.load(std::memory_order_relaxed) };
+        }
+
+    private:
+        friend class NodeMeters;
+
+        std::atomic<int> subscribers { 0 };
+        std::atomic<float> peak { 0.0f }, rms { 0.0f }, momentary { -100.0f }, shortTerm { -100.0f },
+                           truePeak { 0.0f }, truePeakHold { 0.0f };
+    };
+
+    // Effect numbers start at 1; nullptr outside the range
+    Slot* getSlot(int effectNumber)
+    {
+        return effectNumber >= 1 && effectNumber <= maxSlots ? &slots[(size_t) effectNumber - 1] : nullptr;
+    }
+
+    // Any thread. Subscriptions are counted, so several views can watch one node.
+    void subscribe(int effectNumber)
+    {
+        if (auto* slot = getSlot(effectNumber))
+            slot->subscribers.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void unsubscribe(int effectNumber)
+    {
+        if (auto* slot = getSlot(effectNumber))
+            slot->subscribers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    Reading read(int effectNumber)
+    {
+        if (auto* slot = getSlot(effectNumber))
+            return slot->read();
+
+        return {};
+    }
+
+    void clearHold(int effectNumber)
+    {
+        if (auto* slot = getSlot(effectNumber))
+            slot->truePeakHold.store(0.0f, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<Slot, (size_t) maxSlots> slots;
+};
+
+//==============================================================================
+/**
+ * The measurement behind one slot, owned by the node it meters.
+ *
+ * Loudness follows ITU-R BS.1770: K-weighting (high shelf then high pass),
+ * channel weights from the node's layout (LFE left out, surrounds at +1.5 dB),
+ * 400 ms momentary and 3 s short-term windows built from 100 ms blocks. True
+ * peak interpolates 4x with a 48-tap windowed-sinc polyphase filter. Peak,
+ * sum of squares and the interpolation dot products are plain loops over
+ * contiguous samples with independent accumulators, so they vectorize; only
+ * the K-weighting filters are sample-serial.
+ */
+class LevelMeter
+{
+public:
+    LevelMeter()
+    {
+        // h[k] = sinc((k - centre) / 4) with a Blackman window, split into 4
+        // phases; each phase is reversed so the dot product runs forwards
+        // over the input, and normalised to unity gain at DC
+        constexpr int length = tapsPerPhase * oversampling;
+        const auto centre = (length - 1) * 0.5;
+
+        for (int phase = 0; phase < oversampling; ++phase)
+        {
+            double sum = 0.0;
+
+            for (int t = 0; t < tapsPerPhase; ++t)
+            {
+                const auto k = oversampling * (tapsPerPhase - 1 - t) + phase;
+                const auto x = (k - centre) / oversampling;
+                const auto sinc = x == 0.0 ? 1.0 : std::sin(juce::MathConstants<double>::pi * x) / (juce::MathConstants<double>::pi * x);
+                const auto w = 0.42 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * k / (length - 1))
+                                    + 0.08 * std::cos(2.0 * juce::MathConstants<double>::twoPi * k / (length - 1));
+
+                phaseTaps[(size_t) phase][(size_t) t] = (float) (sinc * w);
+                sum += sinc * w;
+            }
+
+            for (auto& tap : phaseTaps[(size_t) phase])
+                tap = (float) (tap / sum);
+        }
+    }
+
+    // Build time: per-channel loudness weights for the layout the node sees
+    void setChannelLayout(const juce::AudioChannelSet& layout)
+    {
+        weights.clear();
+
+        for (int ch = 0; ch < layout.size(); ++ch)
+        {
+            switch (layout.getTypeOfChannel(ch))
+            {
+                case juce::AudioChannelSet::LFE:
+                case juce::AudioChannelSet::LFE2:
+                    weights.push_back(0.0);
+                    break;
+
+                case juce::AudioChannelSet::leftSurround:
+                case juce::AudioChannelSet::rightSurround:
+                case juce::AudioChannelSet::leftSurroundSide:
+                case juce::AudioChannelSet::rightSurroundSide:
+                case juce::AudioChannelSet::leftSurroundRear:
+                case juce::AudioChannelSet::rightSurroundRear:
+                    weights.push_back(1.41);
+                    break;
+
+                default:
+                    weights.push_back(1.0);
+                    break;
+            }
+        }
+    }
+
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        numChannels = (int) spec.numChannels;
+        blockLength = juce::jmax(1, juce::roundToInt(spec.sampleRate * 0.1));
+
+        weights.resize((size_t) numChannels, 1.0);
+        filterState.assign((size_t) numChannels, {});
+        history.assign((size_t) (numChannels * (tapsPerPhase - 1)), 0.0f);
+
+        designKWeighting(spec.sampleRate);
+        reset();
+    }
+
+    void reset()
+    {
+        std::fill(filterState.begin(), filterState.end(), FilterState {});
+        std::fill(history.begin(), history.end(), 0.0f);
+        weightedBlocks.fill(0.0);
+        plainBlocks.fill(0.0);
+        blocksWritten = 0;
+        clearBlock();
+    }
+
+    // Audio thread, after the node has processed the buffer
+    template <typename SampleType>
+    void process(const juce::AudioBuffer<SampleType>& buffer, NodeMeters::Slot& slot)
+    {
+        // Stale state from before the last subscription would skew the windows
+        if (!slot.isSubscribed())
+        {
+            active = false;
+            return;
+        }
+
+        if (!active)
+        {
+            reset();
+            active = true;
+        }
+
+        const int channels = juce::jmin(numChannels, buffer.getNumChannels());
+        const int numSamples = buffer.getNumSamples();
+
+        for (int start = 0; start < numSamples;)
+        {
+            const auto length = juce::jmin(numSamples - start, blockLength - samplesInBlock);
+
+            for (int ch = 0; ch < channels; ++ch)
+                measure(ch, buffer.getReadPointer(ch, start), length);
+
+            samplesInBlock += length;
+            start += length;
+
+            if (samplesInBlock == blockLength)
+                finishBlock(slot, channels);
+        }
+    }
+
+private:
+    static constexpr int oversampling = 4;
+    static constexpr int tapsPerPhase = 12;
+    static constexpr int chunkSize = 64;
+    static constexpr int shortTermBlocks = 30;
+    static constexpr int momentaryBlocks = 4;
+
+    struct Biquad
+    {
+        double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+    };
+
+    struct FilterState
+    {
+        double s1 = 0.0, s2 = 0.0, t1 = 0.0, t2 = 0.0;
+    };
+
+    // BS.1770 pre-filter and RLB high pass, re-derived for the sample rate
+    void designKWeighting(double sampleRate)
+    {
+        {
+            const double f0 = 1681.974450955533, gainDb = 3.999843853973347, q = 0.7071752369554196;
+            const auto k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+            const auto vh = std::pow(10.0, gainDb / 20.0);
+            const auto vb = std::pow(vh, 0.4996667741545416);
+            const auto a0 = 1.0 + k / q + k * k;
+
+            shelf = { (vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+                      2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+        }
+
+        {
+            const double f0 = 38.13547087602444, q = 0.5003270373238773;
+            const auto k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+            const auto a0 = 1.0 + k / q + k * k;
+
+            highPass = { 1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+        }
+    }
+
+    template <typename SampleType>
+    void measure(int ch, const SampleType* data, int numSamples)
+    {
+        const auto range = juce::FloatVectorOperations::findMinAndMax(data, numSamples);
+        blockPeak = juce::jmax(blockPeak, (float) juce::jmax(std::abs(range.getStart()), std::abs(range.getEnd())));
+
+        // Four accumulators so the reduction doesn't serialise on one register
+        double acc[4] = {};
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4)
+            for (int lane = 0; lane < 4; ++lane)
+                acc[lane] += (double) data[i + lane] * (double) data[i + lane];
+        for (; i < numSamples; ++i)
+            acc[0] += (double) data[i] * (double) data[i];
+
+        blockSquares += acc[0] + acc[1] + acc[2] + acc[3];
+
+        // K-weighting, transposed direct form II
+        auto& s = filterState[(size_t) ch];
+        double weighted = 0.0;
+
+        for (i = 0; i < numSamples; ++i)
+        {
+            const auto x = (double) data[i];
+
+            const auto y = shelf.b0 * x + s.s1;
+            s.s1 = shelf.b1 * x - shelf.a1 * y + s.s2;
+            s.s2 = shelf.b2 * x - shelf.a2 * y;
+
+            const auto z = highPass.b0 * y + s.t1;
+            s.t1 = highPass.b1 * y - highPass.a1 * z + s.t2;
+            s.t2 = highPass.b2 * y - highPass.a2 * z;
+
+            weighted += z * z;
+        }
+
+        blockWeighted += weighted * weights[(size_t) ch];
+
+        // True peak in chunks: the last taps of the previous chunk, then the new samples
+        auto* channelHistory = history.data() + ch * (tapsPerPhase - 1);
+
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            const auto length = juce::jmin(chunkSize, numSamples - start);
+
+            std::copy(channelHistory, channelHistory + tapsPerPhase - 1, window.begin());
+            for (int j = 0; j < length; ++j)
+                window[(size_t) (tapsPerPhase - 1 + j)] = (float) data[start + j];
+
+            float peak = 0.0f;
+            for (int j = 0; j < length; ++j)
+            {
+                for (const auto& taps : phaseTaps)
+                {
+                    float y = 0.0f;
+                    for (int t = 0; t < tapsPerPhase; ++t)
+                        y += window[(size_t) (j + t)] * taps[(size_t) t];
+
+                    peak = juce::jmax(peak, std::abs(y));
+                }
+            }
+
+            blockTruePeak = juce::jmax(blockTruePeak, peak);
+            std::copy(window.begin() + length, window.begin() + length + tapsPerPhase - 1, channelHistory);
+        }
+    }
+
+    void finishBlock(NodeMeters::Slot& slot, int channels)
+    {
+        const auto index = (size_t) (blocksWritten % shortTermBlocks);
+        weightedBlocks[index] = blockWeighted / blockLength;
+        plainBlocks[index] = blockSquares / (blockLength * juce::jmax(1, channels));
+        ++blocksWritten;
+
+        auto meanOfLast = [this](const std::array<double, shortTermBlocks>& blocks, int count)
+        {
+            count = juce::jmin(count, blocksWritten);
+            double sum = 0.0;
+            for (int i = 1; i <= count; ++i)
+                sum += blocks[(size_t) ((blocksWritten - i) % shortTermBlocks)];
+            return sum / juce::jmax(1, count);
+        };
+
+        auto toLufs = [](double meanSquare)
+        {
+            return meanSquare > 0.0 ? juce::jmax(-100.0f, (float) (-0.691 + 10.0 * std::log10(meanSquare))) : -100.0f;
+        };
+
+        NodeMeters::Reading reading;
+        reading.peak = blockPeak;
+        reading.rms = (float) std::sqrt(meanOfLast(plainBlocks, momentaryBlocks));
+        reading.momentary = toLufs(meanOfLast(weightedBlocks, momentaryBlocks));
+        reading.shortTerm = toLufs(meanOfLast(weightedBlocks, shortTermBlocks));
+        reading.truePeak = juce::jmax(blockTruePeak, blockPeak);
+        slot.publish(reading);
+
+        clearBlock();
+    }
+
+    void clearBlock()
+    {
+        samplesInBlock = 0;
+        blockPeak = blockTruePeak = 0.0f;
+        blockSquares = blockWeighted = 0.0;
+    }
+
+    std::array<std::array<float, (size_t) tapsPerPhase>, (size_t) oversampling> phaseTaps {};
+    std::array<float, (size_t) (tapsPerPhase - 1 + chunkSize)> window {};
+
+    Biquad shelf, highPass;
+    std::vector<double> weights;
+    std::vector<FilterState> filterState;
+    std::vector<float> history;
+
+    int numChannels = 0;
+    int blockLength = 4800;
+    bool active = false;
+
+    int samplesInBlock = 0;
+    float blockPeak = 0.0f, blockTruePeak = 0.0f;
+    double blockSquares = 0.0, blockWeighted = 0.0;
+
+    std::array<double, (size_t) shortTermBlocks> weightedBlocks {}, plainBlocks {};
+    int blocksWritten = 0;
+};
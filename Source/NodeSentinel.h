@@ -0,0 +1,144 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+// Compile the per-node output scan in (1) or out (0). When compiled in it can
+// still be switched off at runtime with EffectChain::setSentinelEnabled().
+#ifndef PRESET_ENGINE_SENTINEL
+ #define PRESET_ENGINE_SENTINEL 1
+#endif
+
+/**
+ * Watches node outputs for denormals and non-finite samples.
+ *
+ * Feedback paths (delays, phasers, chorus) can decay into denormals, which are
+ * slow on x86 on any thread without FTZ/DAZ, or blow up to NaN/Inf, which then
+ * silence everything downstream. The graph scans each effect's output, repairs
+ * the block, and reports the node through a lock-free event queue that the
+ * message thread drains.
+ */
+class NodeSentinel
+{
+public:
+    struct Counts
+    {
+        int denormals = 0;
+        int nonFinite = 0;
+    };
+
+    struct Event
+    {
+        char nodeName[48] {};
+        int denormals = 0;
+        int nonFinite = 0;
+        bool quarantined = false;
+    };
+
+    //==============================================================================
+    // Branch-free scan on the IEEE bit patterns: exponent all zeros with a
+    // non-zero mantissa is a denormal, exponent all ones is Inf or NaN. The
+    // loop is plain integer arithmetic, so it vectorizes.
+    template <typename SampleType>
+    static Counts scan(const SampleType* data, int numSamples)
+    {
+        using Bits = typename std::conditional<std::is_same<SampleType, double>::value, juce::uint64, juce::uint32>::type;
+
+        constexpr int mantissaBits = std::is_same<SampleType, double>::value ? 52 : 23;
+        constexpr Bits exponentMask = std::is_same<SampleType, double>::value ? (Bits) 0x7ff0000000000000ULL : (Bits) 0x7f800000u;
+        constexpr Bits mantissaMask = ((Bits) 1 << mantissaBits) - 1;
+
+        int denormals = 0, nonFinite = 0;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            Bits bits;
+            std::memcpy(&bits, data + i, sizeof(Bits));
+
+            const auto exponent = bits & exponentMask;
+            denormals += (exponent == 0) & ((bits & mantissaMask) != 0);
+            nonFinite += (exponent == exponentMask);
+        }
+
+        return { denormals, nonFinite };
+    }
+
+    template <typename SampleType>
+    static Counts scan(const juce::AudioBuffer<SampleType>& buffer)
+    {
+        Counts total;
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        {
+            const auto c = scan(buffer.getReadPointer(ch), buffer.getNumSamples());
+            total.denormals += c.denormals;
+            total.nonFinite += c.nonFinite;
+        }
+        return total;
+    }
+
+    // Zeroes denormals in place; only called once a scan found some
+    template <typename SampleType>
+    static void flushDenormals(juce::AudioBuffer<SampleType>& buffer)
+    {
+        const auto smallest = std::numeric_limits<SampleType>::min();
+
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        {
+            auto* data = buffer.getWritePointer(ch);
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                data[i] = std::abs(data[i]) < smallest ? (SampleType) 0 : data[i];
+        }
+    }
+
+    //==============================================================================
+    void setEnabled(bool shouldBeEnabled) { enabled.store(shouldBeEnabled, std::memory_order_relaxed); }
+    bool isEnabled() const                { return PRESET_ENGINE_SENTINEL != 0 && enabled.load(std::memory_order_relaxed); }
+
+    // Called from whichever thread processed the node. Never blocks: if another
+    // thread is posting at the same moment, or the queue is full, the event is
+    // dropped and counted instead.
+    void post(const juce::String& nodeName, Counts counts, bool quarantined)
+    {
+        const juce::SpinLock::ScopedTryLockType lock(writeLock);
+        if (!lock.isLocked() || fifo.getFreeSpace() == 0)
+        {
+            droppedEvents.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        const auto scope = fifo.write(1);
+        auto& event = events[(size_t) (scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2)];
+
+        nodeName.copyToUTF8(event.nodeName, sizeof(event.nodeName));
+        event.denormals = counts.denormals;
+        event.nonFinite = counts.nonFinite;
+        event.quarantined = quarantined;
+    }
+
+    // Message thread
+    bool pop(Event& event)
+    {
+        if (fifo.getNumReady() == 0)
+            return false;
+
+        const auto scope = fifo.read(1);
+        event = events[(size_t) (scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2)];
+        return true;
+    }
+
+    int getNumDroppedEvents() const { return droppedEvents.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr int queueSize = 64;
+
+    std::atomic<bool> enabled { true };
+
+    juce::SpinLock writeLock;
+    juce::AbstractFifo fifo { queueSize };
+    std::array<Event, (size_t) queueSize> events {};
+    std::atomic<int> droppedEvents { 0 };
+};
@@ -43,10 +43,10 @@ public:
     }
 
     DynamicParameterComponent(const juce::String& name, const juce::ValueTree& config)
-        : paramName(name)
+        : paramName(name),
+          uiType(config.getProperty("ui", "Slider").toString()),
+          style(config.getProperty("style", "Rotary").toString())
     {
-        juce::String uiType = config.getProperty("ui", "Slider").toString();
-        
         // Label (except for Button/Label types where it's redundant or handled differently)
         if (!uiType.equalsIgnoreCase("Button") && !uiType.equalsIgnoreCase("ToggleButton") && !uiType.equalsIgnoreCase("Label"))
         {
@@ -63,7 +63,6 @@ public:
             auto* s = new juce::Slider();
             component.reset(s);
             
-            juce::String style = config.getProperty("style", "Rotary").toString();
             if (style.equalsIgnoreCase("Linear")) s->setSliderStyle(juce::Slider::LinearHorizontal);
             else if (style.equalsIgnoreCase("LinearVertical")) s->setSliderStyle(juce::Slider::LinearVertical);
             else s->setSliderStyle(juce::Slider::RotaryVerticalDrag);
@@ -72,6 +71,64 @@ public:
             s->setColour(juce::Slider::textBoxTextColourId, juce::Colours::white);
             s->setColour(juce::Slider::textBoxOutlineColourId, juce::Colours::transparentBlack);
             
+            // 2. The Interaction Link: Value Formatting
+            s->textFromValueFunction = [name](double value) {
+                juce::String suffix = "";
+                if (name.containsIgnoreCase("db") || name.containsIgnoreCase("gain") || name.containsIgnoreCase("threshold")) suffix = " dB";
+                else if (name.containsIgnoreCase("hz") || name.containsIgnoreCase("freq")) suffix = " Hz";
+                else if (name.containsIgnoreCase("ms") || name.containsIgnoreCase("time")) suffix = " ms";
+                else if (name.containsIgnoreCase("ratio")) suffix = ":1";
+                else if (name.containsIgnoreCase("percent") || name.containsIgnoreCase("mix") || name.containsIgnoreCase("dry") || name.containsIgnoreCase("wet")) suffix = " %";
+                
+                return juce::String(value, 1) + suffix;
+            };
+        }
+        else if (uiType.equalsIgnoreCase("Button") || uiType.equalsIgnoreCase("ToggleButton"))
+        {
+            auto* b = new juce::ToggleButton();
+            component.reset(b);
+            b->setButtonText(formatParamLabel(name));
+        }
+        else if (uiType.equalsIgnoreCase("ComboBox"))
+        {
+            component.reset(new juce::ComboBox());
+        }
+        else if (uiType.equalsIgnoreCase("Label"))
+        {
+            auto* l = new juce::Label();
+            component.reset(l);
+            l->setJustificationType(juce::Justification::centred);
+            l->setColour(juce::Label::textColourId, juce::Colours::cyan);
+        }
+        else if (uiType.equalsIgnoreCase("Meter"))
+        {
+            component.reset(new juce::ProgressBar(dummyProgress));
+        }
+        else
+        {
+            // Default
+            component.reset(new juce::Label());
+        }
+
+        update(config);
+
+        if (component)
+            addAndMakeVisible(component.get());
+    }
+
+    // True when config shows as the same kind of control, so update() can reuse this one
+    bool matches(const juce::String& name, const juce::ValueTree& config) const
+    {
+        return name == paramName
+            && config.getProperty("ui", "Slider").toString() == uiType
+            && config.getProperty("style", "Rotary").toString() == style;
+    }
+
+    // Shows new values (and ranges or options) without recreating the control
+    void update(const juce::ValueTree& config)
+    {
+        if (auto* s = dynamic_cast<juce::Slider*>(component.get()))
+        {
             float val = config.getProperty("value", 0.0f);
             float min = config.getProperty("min", 0.0f);
             float max = config.getProperty("max", 1.0f);
@@ -88,34 +145,17 @@ public:
             }
 
             s->setRange(min, max);
-            
-            // 2. The Interaction Link: Value Formatting
-            s->textFromValueFunction = [name](double value) {
-                juce::String suffix = "";
-                if (name.containsIgnoreCase("db") || name.containsIgnoreCase("gain") || name.containsIgnoreCase("threshold")) suffix = " dB";
-                else if (name.containsIgnoreCase("hz") || name.containsIgnoreCase("freq")) suffix = " Hz";
-                else if (name.containsIgnoreCase("ms") || name.containsIgnoreCase("time")) suffix = " ms";
-                else if (name.containsIgnoreCase("ratio")) suffix = ":1";
-                else if (name.containsIgnoreCase("percent") || name.containsIgnoreCase("mix") || name.containsIgnoreCase("dry") || name.containsIgnoreCase("wet")) suffix = " %";
-                
-                return juce::String(value, 1) + suffix;
-            };
-            
             s->setValue(val, juce::dontSendNotification);
         }
-        else if (uiType.equalsIgnoreCase("Button") || uiType.equalsIgnoreCase("ToggleButton"))
+        else if (auto* b = dynamic_cast<juce::ToggleButton*>(component.get()))
         {
-            auto* b = new juce::ToggleButton();
-            component.reset(b);
-            b->setButtonText(formatParamLabel(name));
             bool val = config.getProperty("value", false);
             b->setToggleState(val, juce::dontSendNotification);
         }
-        else if (uiType.equalsIgnoreCase("ComboBox"))
+        else if (auto* c = dynamic_cast<juce::ComboBox*>(component.get()))
         {
-            auto* c = new juce::ComboBox();
-            component.reset(c);
-            
+            c->clear(juce::dontSendNotification);
+
             // Parse options from children named "Item"
             int id = 1;
             for (const auto& child : config)
@@ -142,43 +182,27 @@ public:
                 {
                     if (c->getItemText(i).equalsIgnoreCase(val.toString()))
                     {
-                        c->setSelectedItemIndex(i);
+                        c->setSelectedItemIndex(i, juce::dontSendNotification);
                         found = true;
                         break;
                     }
                 }
-                if (!found) c->setSelectedId(1);
+                if (!found) c->setSelectedId(1, juce::dontSendNotification);
             }
             else
             {
-                c->setSelectedId((int)val > 0 ? (int)val : 1);
+                c->setSelectedId((int)val > 0 ? (int)val : 1, juce::dontSendNotification);
             }
         }
-        else if (uiType.equalsIgnoreCase("Label"))
+        else if (auto* l = dynamic_cast<juce::Label*>(component.get()))
         {
-            auto* l = new juce::Label();
-            component.reset(l);
             l->setText(config.getProperty("value").toString(), juce::dontSendNotification);
-            l->setJustificationType(juce::Justification::centred);
-            l->setColour(juce::Label::textColourId, juce::Colours::cyan);
         }
-        else if (uiType.equalsIgnoreCase("Meter"))
+        else if (dynamic_cast<juce::ProgressBar*>(component.get()) != nullptr)
         {
-            auto* p = new juce::ProgressBar(dummyProgress);
-            component.reset(p);
             // Static value for now
             dummyProgress = config.getProperty("value", 0.5f);
         }
-        else
-        {
-            // Default
-            auto* l = new juce::Label();
-            component.reset(l);
-            l->setText(config.getProperty("value").toString(), juce::dontSendNotification);
-        }
-
-        if (component)
-            addAndMakeVisible(component.get());
     }
 
     void resized() override
@@ -204,29 +228,217 @@ public:
 
 private:
     juce::String paramName;
+    juce::String uiType;
+    juce::String style;
     juce::Label label;
     std::unique_ptr<juce::Component> component;
     double dummyProgress = 0.0;
 };
 
 //==============================================================================
-// Component to render a group of parameters for one Effect
-// Component to render a group of parameters for one Effect
-// Component to render a group of parameters for one Effect
-// Component to render a group of parameters for one Effect
-class DynamicEffectComponent : public juce::Component
+// Output meter in an effect's header: RMS and peak bars, a true-peak hold
+// tick (red once over 0 dBTP; click to clear) and momentary loudness. It
+// subscribes while it shows an effect, so only rows on screen make their
+// nodes measure.
+class EffectMeterComponent : public juce::Component, private juce::Timer
 {
 public:
-    DynamicEffectComponent(const juce::ValueTree& effectTree)
+    explicit EffectMeterComponent(NodeMeters& m) : meters(m) {}
+
+    ~EffectMeterComponent() override
     {
-        // Title
-        juce::String type = effectTree.getProperty("type").toString();
+        setEffectNumber(0);
+    }
 
-        effectNameLabel.setText(type.toUpperCase(), juce::dontSendNotification);
+    void setEffectNumber(int number)
+    {
+        if (number == effectNumber)
+            return;
+
+        meters.unsubscribe(effectNumber);
+        effectNumber = number;
+        meters.subscribe(effectNumber);
+
+        reading = {};
+        if (effectNumber > 0)
+            startTimerHz(15);
+        else
+            stopTimer();
+
+        repaint();
+    }
+
+    void paint(juce::Graphics& g) override
+    {
+        if (effectNumber <= 0)
+            return;
+
+        auto bounds = getLocalBounds().toFloat();
+        auto textArea = bounds.removeFromRight(62.0f);
+        auto bar = bounds.withSizeKeepingCentre(bounds.getWidth(), 6.0f);
+
+        auto toProportion = [](float gain)
+        {
+            return juce::jmap(juce::Decibels::gainToDecibels(gain, minDb), minDb, 0.0f, 0.0f, 1.0f);
+        };
+
+        g.setColour(juce::Colour(0xff1a1a1a));
+        g.fillRoundedRectangle(bar, 2.0f);
+
+        const auto accent = juce::Colour(0xff00bcd4);
+        g.setColour(accent.withAlpha(0.35f));
+        g.fillRoundedRectangle(bar.withWidth(bar.getWidth() * juce::jmin(1.0f, toProportion(reading.peak))), 2.0f);
+        g.setColour(accent);
+        g.fillRoundedRectangle(bar.withWidth(bar.getWidth() * juce::jmin(1.0f, toProportion(reading.rms))), 2.0f);
+
+        if (reading.truePeakHold > 0.0f)
+        {
+            const auto x = bar.getX() + bar.getWidth() * juce::jmin(1.0f, toProportion(reading.truePeakHold));
+            g.setColour(reading.truePeakHold > 1.0f ? juce::Colours::red : juce::Colours::lightgrey);
+            g.fillRect(juce::Rectangle<float>(x - 1.0f, bar.getY() - 2.0f, 2.0f, bar.getHeight() + 4.0f));
+        }
+
+        g.setColour(juce::Colours::lightgrey);
+        g.setFont(juce::Font(11.0f));
+        g.drawText(reading.momentary > minLufs ? juce::String(reading.momentary, 1) + " LU" : juce::String("-inf LU"),
+                   textArea, juce::Justification::centredRight);
+    }
+
+    void mouseDown(const juce::MouseEvent&) override
+    {
+        meters.clearHold(effectNumber);
+    }
+
+private:
+    void timerCallback() override
+    {
+        const auto next = meters.read(effectNumber);
+
+        if (next.peak != reading.peak || next.rms != reading.rms || next.momentary != reading.momentary
+            || next.truePeakHold != reading.truePeakHold)
+        {
+            reading = next;
+            repaint();
+        }
+    }
+
+    static constexpr float minDb = -60.0f;
+    static constexpr float minLufs = -70.0f;
+
+    NodeMeters& meters;
+    int effectNumber = 0;
+    NodeMeters::Reading reading;
+};
+
+//==============================================================================
+// Component to render a group of parameters for one Effect. Used as a row of
+// the editor's effect list, so it can be pointed at another effect in place.
+class DynamicEffectComponent : public juce::Component
+{
+public:
+    // Space left below each row, between effect blocks
+    static constexpr int rowGap = 5;
+
+    DynamicEffectComponent(NodeMeters& meters, const juce::ValueTree& effectTree, int level, int effectNumber)
+        : meter(meters)
+    {
         effectNameLabel.setFont(juce::Font(14.0f, juce::Font::bold));
         effectNameLabel.setColour(juce::Label::textColourId, juce::Colour(0xff00bcd4)); // Cyan
         effectNameLabel.setJustificationType(juce::Justification::centredLeft);
         addAndMakeVisible(effectNameLabel);
+        addAndMakeVisible(meter);
+
+        setEffect(effectTree, level, effectNumber);
+    }
+
+    // Shows another effect, or new values of the same one. Controls are reused
+    // when the effect has the same parameters shown the same way.
+    void setEffect(const juce::ValueTree& effectTree, int level, int effectNumber)
+    {
+        meter.setEffectNumber(effectNumber);
+
+        // Title
+        juce::String type = effectTree.getProperty("type").toString();
+        effectNameLabel.setText(type.toUpperCase(), juce::dontSendNotification);
+
+        auto configs = getParameterConfigs(effectTree);
+
+        bool reusable = configs.size() == (size_t) params.size();
+        for (size_t i = 0; reusable && i < configs.size(); ++i)
+            reusable = params[(int) i]->matches(configs[i].first, configs[i].second);
+
+        if (reusable)
+        {
+            for (size_t i = 0; i < configs.size(); ++i)
+                params[(int) i]->update(configs[i].second);
+        }
+        else
+        {
+            params.clear();
+
+            for (const auto& config : configs)
+            {
+                auto* comp = new DynamicParameterComponent(config.first, config.second);
+                params.add(comp);
+                addAndMakeVisible(comp);
+            }
+        }
+
+        if (indentLevel != level || !reusable)
+        {
+            indentLevel = level;
+            resized();
+            repaint();
+        }
+    }
+
+    void paint(juce::Graphics& g) override
+    {
+        auto bounds = getLocalBounds().withTrimmedBottom(rowGap).toFloat().reduced(2);
+        int indentPx = indentLevel * 20;
+        bounds.removeFromLeft((float)indentPx);
+
+        // Background for the effect block
+        g.setColour(juce::Colour(0xff2a2a2a));
+        g.fillRoundedRectangle(bounds, 6.0f);
+        
+        // Border
+        g.setColour(juce::Colour(0xff3a3a3a));
+        g.drawRoundedRectangle(bounds, 6.0f, 1.0f);
+    }
+
+    void resized() override
+    {
+        auto area = getLocalBounds().withTrimmedBottom(rowGap).reduced(5); // Padding inside the block
+        int indentPx = indentLevel * 20;
+        area.removeFromLeft(indentPx);
+        
+        // Header: name, and the output meter on the right
+        auto header = area.removeFromTop(25);
+        meter.setBounds(header.removeFromRight(juce::jmin(170, header.getWidth() / 2)).reduced(5, 0));
+        effectNameLabel.setBounds(header.reduced(5, 0));
+
+        // Content
+        juce::FlexBox flex;
+        flex.flexWrap = juce::FlexBox::Wrap::wrap;
+        flex.justifyContent = juce::FlexBox::JustifyContent::flexStart; // Or spaceBetween if we want them spread out
+        flex.alignContent = juce::FlexBox::AlignContent::flexStart;
+
+        for (auto* p : params)
+        {
+            // 3. The Layout Link: FlexBox vs setBounds
+            flex.items.add(juce::FlexItem(*p).withWidth(70.0f).withHeight(80.0f).withMargin(juce::FlexItem::Margin(5.0f)));
+        }
+
+        flex.performLayout(area);
+    }
+
+private:
+    // The controls an effect shows: its scalar properties and its parameter maps
+    static std::vector<std::pair<juce::String, juce::ValueTree>> getParameterConfigs(const juce::ValueTree& effectTree)
+    {
+        std::vector<std::pair<juce::String, juce::ValueTree>> configs;
+        juce::String type = effectTree.getProperty("type").toString();
 
         // Iterate properties and children to find parameters
         // 1. Properties (Simple scalars)
@@ -264,6 +476,10 @@ public:
                     options.add("HP12"); options.add("HP24");
                     options.add("BP12"); options.add("BP24");
                 }
+                else if (type.equalsIgnoreCase("Reverb"))
+                {
+                    options.add("Classic"); options.add("FDN");
+                }
                 else if (type.equalsIgnoreCase("Group"))
                 {
                     options.add("Series"); options.add("Parallel");
@@ -277,9 +493,7 @@ public:
                 }
             }
 
-            auto* comp = new DynamicParameterComponent(name, simpleConfig);
-            params.add(comp);
-            addAndMakeVisible(comp);
+            configs.push_back({ name, simpleConfig });
         }
 
         // 2. Children (Complex params only, skip nested effects)
@@ -288,55 +502,31 @@ public:
             if (child.hasProperty("type")) continue; // Skip nested effects
 
             auto name = child.getType().toString();
-            auto* comp = new DynamicParameterComponent(name, child);
-            params.add(comp);
-            addAndMakeVisible(comp);
-        }
-    }
 
-    void setIndent(int level) { indentLevel = level; }
-
-    void paint(juce::Graphics& g) override
-    {
-        auto bounds = getLocalBounds().toFloat().reduced(2);
-        int indentPx = indentLevel * 20;
-        bounds.removeFromLeft((float)indentPx);
-
-        // Background for the effect block
-        g.setColour(juce::Colour(0xff2a2a2a));
-        g.fillRoundedRectangle(bounds, 6.0f);
-        
-        // Border
-        g.setColour(juce::Colour(0xff3a3a3a));
-        g.drawRoundedRectangle(bounds, 6.0f, 1.0f);
-    }
+            // Channel routing lists show as a read-only "L R" label
+            if (name == "channels")
+            {
+                juce::StringArray channelNames;
+                for (const auto& item : child)
+                    channelNames.add(item.getProperty("value").toString());
 
-    void resized() override
-    {
-        auto area = getLocalBounds().reduced(5); // Padding inside the block
-        int indentPx = indentLevel * 20;
-        area.removeFromLeft(indentPx);
-        
-        // Header
-        effectNameLabel.setBounds(area.removeFromTop(25).reduced(5, 0));
+                juce::ValueTree routingConfig("Param");
+                routingConfig.setProperty("value", channelNames.joinIntoString(" "), nullptr);
+                routingConfig.setProperty("ui", "Label", nullptr);
 
-        // Content
-        juce::FlexBox flex;
-        flex.flexWrap = juce::FlexBox::Wrap::wrap;
-        flex.justifyContent = juce::FlexBox::JustifyContent::flexStart; // Or spaceBetween if we want them spread out
-        flex.alignContent = juce::FlexBox::AlignContent::flexStart;
+                configs.push_back({ name, routingConfig });
+                continue;
+            }
 
-        for (auto* p : params)
-        {
-            // 3. The Layout Link: FlexBox vs setBounds
-            flex.items.add(juce::FlexItem(*p).withWidth(70.0f).withHeight(80.0f).withMargin(juce::FlexItem::Margin(5.0f)));
+            configs.push_back({ name, child });
         }
 
-        flex.performLayout(area);
+        return configs;
     }
 
-private:
+
     juce::Label effectNameLabel;
+    EffectMeterComponent meter;
     juce::OwnedArray<DynamicParameterComponent> params;
     int indentLevel = 0;
 };
@@ -366,11 +556,12 @@ PresetEngineAudioProcessorEditor::PresetEngineAudioProcessorEditor (PresetEngine
     // Spectrum
     addAndMakeVisible(spectrumComponent);
 
-    // Dynamic UI Viewport
-    addAndMakeVisible(viewport);
-    viewport.setScrollBarsShown(true, false);
-    container.reset(new juce::Component());
-    viewport.setViewedComponent(container.get(), false);
+    // Dynamic UI list
+    effectList.setModel(this);
+    effectList.setRowHeight(110 + DynamicEffectComponent::rowGap);
+    effectList.setColour(juce::ListBox::backgroundColourId, juce::Colours::transparentBlack);
+    effectList.getViewport()->setScrollBarsShown(true, false);
+    addAndMakeVisible(effectList);
 
     // Code Editor Controls
     languageBox.addItem("YAML", 1);
@@ -417,6 +608,9 @@ PresetEngineAudioProcessorEditor::PresetEngineAudioProcessorEditor (PresetEngine
     statusLabel.setJustificationType(juce::Justification::centredRight);
     addAndMakeVisible(statusLabel);
 
+    // Poll for nodes the sentinel had to repair
+    startTimerHz(4);
+
     applyButton.setButtonText("APPLY");
     applyButton.onClick = [this] {
         juce::String configToLoad = codeEditor.getText();
@@ -434,18 +628,36 @@ PresetEngineAudioProcessorEditor::PresetEngineAudioProcessorEditor (PresetEngine
              }
         }
 
-        auto result = audioProcessor.loadConfig(configToLoad);
-        if (result.wasOk())
-        {
-            statusLabel.setText("Loaded Successfully", juce::dontSendNotification);
-            statusLabel.setColour(juce::Label::textColourId, juce::Colours::lightgreen);
-            rebuildUi();
-        }
-        else
-        {
-            statusLabel.setText("Error: " + result.getErrorMessage(), juce::dontSendNotification);
-            statusLabel.setColour(juce::Label::textColourId, juce::Colours::red);
-        }
+        // Parsing, building and preparing happen on the loader thread
+        juce::Component::SafePointer<PresetEngineAudioProcessorEditor> editor(this);
+
+        audioProcessor.loadConfigAsync(configToLoad,
+            [editor](EffectChain::LoadStage stage)
+            {
+                if (editor == nullptr)
+                    return;
+
+                static const char* const stageNames[] = { "Parsing...", "Building...", "Preparing...", "Swapping in..." };
+                editor->statusLabel.setText(stageNames[(int) stage], juce::dontSendNotification);
+                editor->statusLabel.setColour(juce::Label::textColourId, juce::Colours::lightgrey);
+            },
+            [editor](juce::Result result)
+            {
+                if (editor == nullptr)
+                    return;
+
+                if (result.wasOk())
+                {
+                    editor->statusLabel.setText("Loaded Successfully", juce::dontSendNotification);
+                    editor->statusLabel.setColour(juce::Label::textColourId, juce::Colours::lightgreen);
+                    editor->rebuildUi();
+                }
+                else
+                {
+                    editor->statusLabel.setText("Error: " + result.getErrorMessage(), juce::dontSendNotification);
+                    editor->statusLabel.setColour(juce::Label::textColourId, juce::Colours::red);
+                }
+            });
     };
     addAndMakeVisible(applyButton);
 
@@ -454,8 +666,31 @@ PresetEngineAudioProcessorEditor::PresetEngineAudioProcessorEditor (PresetEngine
 
 PresetEngineAudioProcessorEditor::~PresetEngineAudioProcessorEditor()
 {
+    stopTimer();
     setLookAndFeel(nullptr);
-    viewport.setViewedComponent(nullptr, false);
+    effectList.setModel(nullptr);
+}
+
+void PresetEngineAudioProcessorEditor::timerCallback()
+{
+    NodeSentinel::Event event;
+    bool any = false;
+
+    // Only the most recent report is shown; older ones are just drained
+    while (audioProcessor.popSentinelEvent(event))
+        any = true;
+
+    if (!any)
+        return;
+
+    juce::String message(event.nodeName);
+    if (event.nonFinite > 0)
+        message << ": " << event.nonFinite << " NaN/Inf samples, bypassed briefly";
+    else
+        message << ": decayed into denormals, reset";
+
+    statusLabel.setText(message, juce::dontSendNotification);
+    statusLabel.setColour(juce::Label::textColourId, juce::Colours::orange);
 }
 
 juce::String PresetEngineAudioProcessorEditor::getPresetSource(int presetId, int languageId)
@@ -625,11 +860,10 @@ juce::String PresetEngineAudioProcessorEditor::parsePythonToYaml(const juce::Str
 
 void PresetEngineAudioProcessorEditor::rebuildUi()
 {
-    container->removeAllChildren();
-    effectComponents.clear();
+    effectRows.clear();
 
     auto tree = audioProcessor.getCurrentConfigTree();
-    
+
     // Recursive helper to flatten the tree with indentation
     std::function<void(const juce::ValueTree&, int)> addEffects;
     addEffects = [&](const juce::ValueTree& parent, int level)
@@ -639,10 +873,8 @@ void PresetEngineAudioProcessorEditor::rebuildUi()
             // Check if it is an effect (has type)
             if (child.hasProperty("type"))
             {
-                auto* comp = new DynamicEffectComponent(child);
-                comp->setIndent(level);
-                effectComponents.add(comp);
-                container->addAndMakeVisible(comp);
+                // Numbered as the chain built it, so the row finds its meters
+                effectRows.push_back({ child, level, audioProcessor.getEffectNumber(child) });
                 
                 // Recurse for children
                 addEffects(child, level + 1);
@@ -652,29 +884,42 @@ void PresetEngineAudioProcessorEditor::rebuildUi()
 
     // Start recursion from root
     addEffects(tree, 0);
-    
-    // Layout logic: Stack effects vertically
-    int y = 0;
-    const int effectHeight = 110;
-    
-    int w = container->getWidth();
-    if (w <= 0) w = viewport.getWidth() - 20; // Fallback to viewport width
-    if (w <= 0) w = 400; // Fallback to default
 
-    for (auto* comp : effectComponents)
+    // Visible rows are refreshed in place through refreshComponentForRow()
+    effectList.updateContent();
+    effectList.repaint();
+}
+
+int PresetEngineAudioProcessorEditor::getNumRows()
+{
+    return (int) effectRows.size();
+}
+
+void PresetEngineAudioProcessorEditor::paintListBoxItem(int, juce::Graphics&, int, int, bool)
+{
+    // Rows are drawn by their DynamicEffectComponent
+}
+
+juce::Component* PresetEngineAudioProcessorEditor::refreshComponentForRow(int rowNumber, bool, juce::Component* existingComponentToUpdate)
+{
+    auto* comp = dynamic_cast<DynamicEffectComponent*>(existingComponentToUpdate);
+
+    if (rowNumber < 0 || rowNumber >= (int) effectRows.size())
     {
-        comp->setBounds(0, y, w, effectHeight);
-        y += effectHeight + 5;
+        delete existingComponentToUpdate;
+        return nullptr;
     }
 
-    if (container->getWidth() > 0)
+    const auto& row = effectRows[(size_t) rowNumber];
+
+    if (comp == nullptr)
     {
-         // Refresh bounds
-         for (auto* comp : effectComponents)
-            comp->setBounds(0, comp->getY(), container->getWidth(), comp->getHeight());
+        delete existingComponentToUpdate;
+        return new DynamicEffectComponent(audioProcessor.getMeters(), row.tree, row.indent, row.effectNumber);
     }
 
-    container->setSize(w, std::max(300, y));
+    comp->setEffect(row.tree, row.indent, row.effectNumber);
+    return comp;
 }
 
 void PresetEngineAudioProcessorEditor::paint (juce::Graphics& g)
@@ -704,10 +949,8 @@ void PresetEngineAudioProcessorEditor::resized()
     auto leftArea = area.removeFromLeft((int)(getWidth() * 0.4));
     auto rightArea = area; // Remaining
 
-    // Right Side: Viewport (Controls)
-    viewport.setBounds(rightArea.reduced(10));
-    if (container)
-        container->setSize(viewport.getWidth() - 15, container->getHeight());
+    // Right Side: Effect list (Controls)
+    effectList.setBounds(rightArea.reduced(10));
 
     // Left Side:
     // Top 33%: Spectrum
@@ -729,17 +972,4 @@ void PresetEngineAudioProcessorEditor::resized()
     
     // Bottom: Code Editor
     codeEditor.setBounds(leftArea.reduced(10));
-    
-    // Trigger rebuild layout to ensure container widths are correct
-    if (container && container->getWidth() > 0)
-    {
-        int y = 0;
-        const int effectHeight = 110;
-        for (auto* comp : effectComponents)
-        {
-            comp->setBounds(0, y, container->getWidth(), effectHeight);
-            y += effectHeight + 5;
-        }
-        container->setSize(container->getWidth(), std::max(300, y));
-    }
 }
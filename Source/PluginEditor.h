@@ -3,19 +3,23 @@
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
 #include "ModernLookAndFeel.h"
+#include "SpectrumRenderer.h"
 #include <cmath>
+#include <vector>
 
 //==============================================================================
 /**
- * A dummy spectrum visualizer component that draws a pleasing gradient curve.
- * In a real plugin, this would read FFT data from the processor.
+ * Input and output spectra of the processor. Redraws only when a new FFT frame
+ * changed the picture, polls slowly while both spectra are silent, and stops
+ * polling altogether while hidden.
  */
 class SpectrumComponent : public juce::Component, public juce::Timer
 {
 public:
     SpectrumComponent(PresetEngineAudioProcessor& p) : processor(p)
     {
-        startTimerHz(30);
+        renderer.setTraceColour(inputTrace, juce::Colours::grey);
+        renderer.setTraceColour(outputTrace, juce::Colour(0xff00bcd4));
     }
 
     ~SpectrumComponent() override
@@ -25,76 +29,78 @@ public:
 
     void timerCallback() override
     {
-        if (processor.inputFFT.nextFFTBlockReady)
-        {
-            processor.inputFFT.forwardFFT.performFrequencyOnlyForwardTransform(processor.inputFFT.fftData.data());
-            processor.inputFFT.nextFFTBlockReady = false;
-            repaint();
-        }
-        
-        if (processor.outputFFT.nextFFTBlockReady)
-        {
-            processor.outputFFT.forwardFFT.performFrequencyOnlyForwardTransform(processor.outputFFT.fftData.data());
-            processor.outputFFT.nextFFTBlockReady = false;
+        updateLayout();
+
+        const auto changed = pullFrame(processor.inputFFT, inputTrace)
+                           | pullFrame(processor.outputFFT, outputTrace);
+
+        if (changed)
             repaint();
-        }
+
+        // Something has to notice the signal coming back, so idle at a low rate
+        const auto rate = renderer.isSilent() ? idleRateHz : activeRateHz;
+        if (getTimerInterval() != 1000 / rate)
+            startTimerHz(rate);
     }
 
     void paint(juce::Graphics& g) override
     {
-        g.fillAll(juce::Colour(0xff121212));
-        
-        g.setOpacity(1.0f);
-        
-        auto drawSpectrum = [&](const std::vector<float>& data, juce::Colour color)
-        {
-            juce::Path path;
-            path.startNewSubPath(0, (float)getHeight());
-            
-            const float mindB = -100.0f;
-            const float maxdB = 0.0f;
-            const int fftSize = PresetEngineAudioProcessor::fftSize;
-            const int halfSize = fftSize / 2;
-            
-            for (int i = 0; i < halfSize; ++i)
-            {
-                float skewedProportionX = 1.0f - std::exp(std::log(1.0f - (float)i / (float)halfSize) * 0.2f);
-                
-                // Map skewed proportion to FFT bin index
-                float fftDataIndex = juce::jlimit(0.0f, (float)halfSize, skewedProportionX * (float)halfSize);
-                
-                // Calculate magnitude in dB
-                float magnitude = data[(int)fftDataIndex];
-                float levelDb = juce::Decibels::gainToDecibels(magnitude) - juce::Decibels::gainToDecibels((float)fftSize);
-                
-                // Map dB to height (0.0 to 1.0)
-                float level = juce::jmap(juce::jlimit(mindB, maxdB, levelDb), mindB, maxdB, 0.0f, 1.0f);
-                
-                path.lineTo(skewedProportionX * (float)getWidth(), (float)getHeight() - level * (float)getHeight());
-            }
-            
-            g.setColour(color);
-            g.strokePath(path, juce::PathStrokeType(1.0f));
-            
-            // Fill
-            path.lineTo((float)getWidth(), (float)getHeight());
-            path.closeSubPath();
-            g.setColour(color.withAlpha(0.2f));
-            g.fillPath(path);
-        };
-
-        drawSpectrum(processor.inputFFT.fftData, juce::Colours::grey);
-        drawSpectrum(processor.outputFFT.fftData, juce::Colour(0xff00bcd4));
+        updateLayout();
+        renderer.paint(g);
     }
 
+    void visibilityChanged() override      { updateTimer(); }
+    void parentHierarchyChanged() override { updateTimer(); }
+
 private:
+    static constexpr int inputTrace = 0, outputTrace = 1;
+    static constexpr int activeRateHz = 30, idleRateHz = 5;
+
+    // Transforms a waiting frame in place and hands it to the renderer. The
+    // flag is cleared only afterwards, so the audio thread can't refill the
+    // buffer while it is being read.
+    bool pullFrame(PresetEngineAudioProcessor::FFTData& fft, int trace)
+    {
+        if (!fft.nextFFTBlockReady.load(std::memory_order_acquire))
+            return renderer.update(trace, silence.data());
+
+        fft.forwardFFT.performFrequencyOnlyForwardTransform(fft.fftData.data());
+        const auto changed = renderer.update(trace, fft.fftData.data());
+        fft.nextFFTBlockReady.store(false, std::memory_order_release);
+        return changed;
+    }
+
+    void updateLayout()
+    {
+        renderer.setLayout(getWidth(), getHeight(), PresetEngineAudioProcessor::fftOrder, processor.getSampleRate() > 0.0 ? processor.getSampleRate() : 44100.0);
+    }
+
+    void updateTimer()
+    {
+        if (isShowing())
+        {
+            if (!isTimerRunning())
+                startTimerHz(activeRateHz);
+        }
+        else
+        {
+            stopTimer();
+        }
+    }
+
     PresetEngineAudioProcessor& processor;
+    SpectrumRenderer renderer;
+
+    // Fed in place of a frame when none arrived, so held peaks keep falling
+    std::vector<float> silence = std::vector<float>((size_t) PresetEngineAudioProcessor::fftSize, 0.0f);
 };
 
 //==============================================================================
 /**
 */
-class PresetEngineAudioProcessorEditor  : public juce::AudioProcessorEditor
+class PresetEngineAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                          private juce::Timer,
+                                          private juce::ListBoxModel
 {
 public:
     PresetEngineAudioProcessorEditor (PresetEngineAudioProcessor&);
@@ -106,7 +112,14 @@ public:
     void resized() override;
 
 private:
+    void timerCallback() override;
     void rebuildUi();
+
+    // Effect list: one row per effect of the flattened preset tree. Only rows
+    // on screen have components, which are reused as the list scrolls.
+    int getNumRows() override;
+    void paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected) override;
+    juce::Component* refreshComponentForRow(int rowNumber, bool isRowSelected, juce::Component* existingComponentToUpdate) override;
     juce::String parsePythonToYaml(const juce::String& pythonCode);
 
     PresetEngineAudioProcessor& audioProcessor;
@@ -132,9 +145,15 @@ private:
     juce::String getPresetSource(int presetId, int languageId);
 
     // Right Column Components
-    juce::Viewport  viewport;
-    std::unique_ptr<juce::Component> container;
-    juce::OwnedArray<juce::Component> effectComponents;
+    struct EffectRow
+    {
+        juce::ValueTree tree;
+        int indent = 0;
+        int effectNumber = 0;       // meter slot; 0 for groups, sends and other structure
+    };
+
+    juce::ListBox effectList;
+    std::vector<EffectRow> effectRows;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetEngineAudioProcessorEditor)
 };
@@ -8,6 +8,7 @@ PresetEngineAudioProcessor::PresetEngineAudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
@@ -15,10 +16,17 @@ PresetEngineAudioProcessor::PresetEngineAudioProcessor()
        apvts(*this, nullptr, "PARAMETERS", createParameterLayout())
 #endif
 {
+    // Presets come from the editor or the host state rather than from files,
+    // so relative impulse paths resolve against a fixed folder
+    effectChain.setFileDirectory(juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+                                     .getChildFile(JucePlugin_Name).getChildFile("Impulses"));
+
+    startTimerHz(retireTimerHz);
 }
 
 PresetEngineAudioProcessor::~PresetEngineAudioProcessor()
 {
+    stopTimer();
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout PresetEngineAudioProcessor::createParameterLayout()
@@ -72,25 +80,43 @@ double PresetEngineAudioProcessor::getTailLengthSeconds() const
 
 int PresetEngineAudioProcessor::getNumPrograms()
 {
-    return 1;
+    return EffectChain::maxPrograms;
 }
 
 int PresetEngineAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return effectChain.getCurrentProgram();
 }
 
 void PresetEngineAudioProcessor::setCurrentProgram (int index)
 {
+    if (! juce::isPositiveAndBelow (index, EffectChain::maxPrograms))
+        return;
+
+    // A slot that was never filled plays as an empty chain
+    auto result = effectChain.selectProgram (index);
+    if (result.failed() && effectChain.setProgram (index, programSources[(size_t) index]).wasOk())
+        result = effectChain.selectProgram (index);
+
+    if (result.wasOk())
+        currentConfigCode = programSources[(size_t) index];
+
+    updateLatency();
 }
 
 const juce::String PresetEngineAudioProcessor::getProgramName (int index)
 {
-    return {};
+    if (! juce::isPositiveAndBelow (index, EffectChain::maxPrograms))
+        return {};
+
+    const auto& name = programNames[(size_t) index];
+    return name.isNotEmpty() ? name : "Program " + juce::String (index + 1);
 }
 
 void PresetEngineAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    if (juce::isPositiveAndBelow (index, EffectChain::maxPrograms))
+        programNames[(size_t) index] = newName;
 }
 
 //==============================================================================
@@ -101,7 +127,13 @@ void PresetEngineAudioProcessor::prepareToPlay (double sampleRate, int samplesPe
     spec.maximumBlockSize = samplesPerBlock;
     spec.numChannels = getTotalNumOutputChannels();
 
+    effectChain.setPrecision(getProcessingPrecision() == doublePrecision ? EffectChain::Precision::Double
+                                                                         : EffectChain::Precision::Single);
+    effectChain.setChannelLayout(getChannelLayoutOfBus(false, 0));
+    effectChain.setSubBlockSize(internalSubBlockSize);
+    effectChain.setTransition(presetCrossfadeSeconds, maxPresetTailSeconds);
     effectChain.prepare(spec);
+    updateLatency();
 }
 
 void PresetEngineAudioProcessor::releaseResources()
@@ -115,13 +147,19 @@ bool PresetEngineAudioProcessor::isBusesLayoutSupported (const BusesLayout& layo
     juce::ignoreUnused (layouts);
     return true;
   #else
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any named layout, from mono up to immersive beds and higher-order
+    // ambisonics; nodes pick their channels by name via "channels:"
+    const auto& mainOutput = layouts.getMainOutputChannelSet();
+    if (mainOutput.isDisabled() || mainOutput.size() > maxBusChannels)
         return false;
 
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+
+    // Optional sidechain: off, or any layout up to the same width
+    if (layouts.inputBuses.size() > 1 && layouts.getChannelSet(true, 1).size() > maxBusChannels)
+        return false;
    #endif
 
     return true;
@@ -129,8 +167,33 @@ bool PresetEngineAudioProcessor::isBusesLayoutSupported (const BusesLayout& layo
 }
 
 void PresetEngineAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processBlockInternal (buffer, midiMessages);
+}
+
+void PresetEngineAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processBlockInternal (buffer, midiMessages);
+}
+
+template <typename SampleType>
+void PresetEngineAudioProcessor::processBlockInternal (juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
+
+    // Program change: a warm program is swapped in right here, a cold one is
+    // built on the message thread (this block keeps the current program)
+    for (const auto metadata : midiMessages)
+    {
+        const auto message = metadata.getMessage();
+        if (message.isProgramChange() && message.getProgramChangeNumber() < EffectChain::maxPrograms)
+        {
+            effectChain.selectWarmProgram (message.getProgramChangeNumber());
+            pendingProgram.store (message.getProgramChangeNumber());
+            triggerAsyncUpdate();
+        }
+    }
+
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -142,17 +205,30 @@ void PresetEngineAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
     {
         auto* channelData = buffer.getReadPointer(0);
         for (int i = 0; i < buffer.getNumSamples(); ++i)
-            inputFFT.pushNextSample(channelData[i]);
+            inputFFT.pushNextSample(static_cast<float>(channelData[i]));
+    }
+
+    // The chain runs on the main bus only; the sidechain is handed over read-only
+    auto mainBuffer = getBusBuffer (buffer, false, 0);
+    juce::dsp::AudioBlock<const SampleType> sidechain;
+
+    if (getBusCount (true) > 1 && getBus (true, 1)->isEnabled())
+    {
+        const auto firstChannel = getChannelIndexInProcessBlockBuffer (true, 1, 0);
+        const auto numChannels = juce::jmin (getBus (true, 1)->getNumberOfChannels(), buffer.getNumChannels() - firstChannel);
+
+        if (numChannels > 0)
+            sidechain = juce::dsp::AudioBlock<SampleType> (buffer).getSubsetChannelBlock ((size_t) firstChannel, (size_t) numChannels);
     }
 
-    effectChain.process(buffer);
+    effectChain.process (mainBuffer, sidechain);
     
     // Push to Output FFT
     if (totalNumOutputChannels > 0)
     {
         auto* channelData = buffer.getReadPointer(0);
         for (int i = 0; i < buffer.getNumSamples(); ++i)
-            outputFFT.pushNextSample(channelData[i]);
+            outputFFT.pushNextSample(static_cast<float>(channelData[i]));
     }
 }
 
@@ -175,6 +251,14 @@ void PresetEngineAudioProcessor::getStateInformation (juce::MemoryBlock& destDat
     // Actually, we should store the 'source code' that generated the chain.
     juce::MemoryOutputStream stream(destData, true);
     stream.writeString(currentConfigCode);
+
+    // The program bank follows; older states end after the config
+    stream.writeInt(effectChain.getCurrentProgram());
+    for (int i = 0; i < EffectChain::maxPrograms; ++i)
+    {
+        stream.writeString(programNames[(size_t) i]);
+        stream.writeString(programSources[(size_t) i]);
+    }
 }
 
 void PresetEngineAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
@@ -182,21 +266,79 @@ void PresetEngineAudioProcessor::setStateInformation (const void* data, int size
     juce::MemoryInputStream stream(data, sizeInBytes, false);
     juce::String config = stream.readString();
 
-    loadConfig(config);
+    if (stream.isExhausted())
+    {
+        loadConfig(config);
+        return;
+    }
+
+    const auto current = stream.readInt();
+    for (int i = 0; i < EffectChain::maxPrograms; ++i)
+    {
+        programNames[(size_t) i] = stream.readString();
+        programSources[(size_t) i] = stream.readString();
+
+        if (programSources[(size_t) i].isNotEmpty())
+            effectChain.setProgram(i, programSources[(size_t) i]);
+    }
+
+    setCurrentProgram(current);
+}
+
+void PresetEngineAudioProcessor::timerCallback()
+{
+    effectChain.releaseRetiredGraphs();
+}
+
+void PresetEngineAudioProcessor::updateLatency()
+{
+    const auto latency = effectChain.getLatencySamples();
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
+}
+
+void PresetEngineAudioProcessor::handleAsyncUpdate()
+{
+    const auto index = pendingProgram.exchange(-1);
+    if (index < 0)
+        return;
+
+    setCurrentProgram(index);
+    updateHostDisplay(ChangeDetails().withProgramChanged(true));
 }
 
 juce::Result PresetEngineAudioProcessor::loadConfig(const juce::String& config)
 {
+    // Loading a preset replaces the current program; a MIDI program change on
+    // the audio thread may move it meanwhile, so ask the chain which one
     currentConfigCode = config;
 
-    // Detect format
-    juce::String trimmed = config.trim();
-    if (trimmed.startsWith("<"))
-        return effectChain.loadFromXml(config);
-    else if (trimmed.startsWith("{") || trimmed.startsWith("["))
-        return effectChain.loadFromJson(config);
-    else
-        return effectChain.loadFromYaml(config);
+    int program = -1;
+    const auto result = effectChain.loadFromSource(config, {}, {}, &program);
+    if (result.wasOk())
+        programSources[(size_t) program] = config;
+
+    updateLatency();
+    return result;
+}
+
+void PresetEngineAudioProcessor::loadConfigAsync(const juce::String& config, PresetLoader::ProgressCallback onProgress,
+                                                 std::function<void(juce::Result)> onFinished)
+{
+    // The source goes into the slot the chain wrote, not whichever program is
+    // current by the time this callback runs
+    presetLoader.load(config, std::move(onProgress), [this, config, onFinished](juce::Result result, int program)
+    {
+        if (result.wasOk() && juce::isPositiveAndBelow(program, EffectChain::maxPrograms))
+        {
+            currentConfigCode = config;
+            programSources[(size_t) program] = config;
+            updateLatency();
+        }
+
+        if (onFinished != nullptr)
+            onFinished(result);
+    });
 }
 
 //==============================================================================
@@ -2,8 +2,11 @@
 
 #include <JuceHeader.h>
 #include "EffectChain.h"
+#include "PresetLoader.h"
 
-class PresetEngineAudioProcessor  : public juce::AudioProcessor
+class PresetEngineAudioProcessor  : public juce::AudioProcessor,
+                                    private juce::AsyncUpdater,
+                                    private juce::Timer
 {
 public:
     //==============================================================================
@@ -19,6 +22,8 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override { return true; }
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -44,9 +49,24 @@ public:
     void setStateInformation (const void* data, int sizeInBytes) override;
 
     juce::Result loadConfig(const juce::String& config);
+
+    // Message thread. Parses, builds and prepares on a background thread; a
+    // newer call supersedes this one, which then never calls back. Callbacks
+    // arrive on the message thread.
+    void loadConfigAsync(const juce::String& config, PresetLoader::ProgressCallback onProgress,
+                         std::function<void(juce::Result)> onFinished);
     juce::String getCurrentConfig() const { return currentConfigCode; }
     juce::ValueTree getCurrentConfigTree() const { return effectChain.getCurrentConfig(); }
 
+    // Meter number of the effect at a node of getCurrentConfigTree(), or 0
+    int getEffectNumber(const juce::ValueTree& node) const { return effectChain.getEffectNumber(node); }
+
+    // Message thread: next report of a node the sentinel repaired, if any
+    bool popSentinelEvent(NodeSentinel::Event& event) { return effectChain.popSentinelEvent(event); }
+
+    // Output meters of the running preset's effects; see EffectChain::getMeters()
+    NodeMeters& getMeters() { return effectChain.getMeters(); }
+
     // Visualization
     // Visualization - FFT
     enum
@@ -62,7 +82,7 @@ public:
         std::vector<float> fifo;
         std::vector<float> fftData;
         int fifoIndex = 0;
-        bool nextFFTBlockReady = false;
+        std::atomic<bool> nextFFTBlockReady { false };   // set by the audio thread, cleared by the editor
         
         FFTData() : fifo(fftSize), fftData(2 * fftSize) {}
         
@@ -87,12 +107,50 @@ public:
     FFTData outputFFT;
 
 private:
+    // Widest bus accepted; covers 9.1.6 and 4th-order ambisonics (25 channels).
+    // juce::AudioBuffer keeps up to 31 channel pointers inline: a wider bus
+    // would allocate in getBusBuffer() and every channel view, every block.
+    static constexpr int maxBusChannels = 31;
+
+    // Host blocks are processed in slices of this size (see the "subblock" benchmark)
+    static constexpr int internalSubBlockSize = 128;
+
+    // Preset switches crossfade over this long; the old preset's tail may ring
+    // on for at most maxPresetTailSeconds while both run
+    static constexpr double presetCrossfadeSeconds = 0.05;
+    static constexpr double maxPresetTailSeconds = 6.0;
+
+    // How often retired graphs are freed and switched-away programs cleared
+    static constexpr int retireTimerHz = 10;
+
+    template <typename SampleType>
+    void processBlockInternal (juce::AudioBuffer<SampleType>&, juce::MidiBuffer&);
+
+    // Finishes a MIDI program change on the message thread: builds the program
+    // if it wasn't warm, and brings the config and host display up to date
+    void handleAsyncUpdate() override;
+
+    // Frees graphs that stopped playing (crossfaded out, switched away from)
+    // and clears programs switched away from, so they are warm again for the
+    // next MIDI program change, whether or not the editor is open
+    void timerCallback() override;
+
+    // Tells the host the live graph's latency (lookahead) for delay
+    // compensation; called whenever a graph is published or prepared
+    void updateLatency();
+
     juce::AudioProcessorValueTreeState apvts;
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
     EffectChain effectChain;
     juce::String currentConfigCode;
 
+    std::array<juce::String, EffectChain::maxPrograms> programNames;
+    std::array<juce::String, EffectChain::maxPrograms> programSources;
+    std::atomic<int> pendingProgram { -1 };
+
+    PresetLoader presetLoader { effectChain };
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetEngineAudioProcessor)
 };
@@ -0,0 +1,826 @@
+#include "PresetAnalyzer.h"
+#include <map>
+
+namespace
+{
+    using Precision = EffectChain::Precision;
+    using Severity = PresetAnalyzer::Issue::Severity;
+
+    //==============================================================================
+    // What each node type accepts
+
+    enum class Kind
+    {
+        Number,     // plain number
+        Parameter,  // number, or a map such as { value: 800, ui: knob, mod: wobble }
+        Flag,       // true/false, yes/no or a number
+        Option,     // one of a fixed set of words, or a number when the spec has a range
+        Text,       // any non-empty string
+        List        // list or comma-separated string
+    };
+
+    struct ParameterSpec
+    {
+        const char* name;
+        Kind kind;
+        double minValue = 0.0;
+        double maxValue = 0.0;
+        const char* options = "";       // "|"-separated
+        bool caseSensitive = false;
+    };
+
+    enum class Structure { Effect, Group, Feedback, Modulator, Send, Bus };
+
+    struct NodeSpec
+    {
+        std::vector<const char*> types;  // canonical name first, then aliases
+        Structure structure;
+        std::vector<ParameterSpec> parameters;
+        bool dynamics = false;           // takes the shared dynamics keys (DynamicsCore.h)
+    };
+
+    const std::vector<ParameterSpec>& getCommonParameters()
+    {
+        static const std::vector<ParameterSpec> common {
+            { "type",      Kind::Text },
+            { "precision", Kind::Option, 0, 0, "double|64|float|single|32" },
+            { "channels",  Kind::List },
+        };
+        return common;
+    }
+
+    const std::vector<ParameterSpec>& getDynamicsParameters()
+    {
+        static const std::vector<ParameterSpec> dynamics {
+            { "link",          Kind::Option, 0, 1, "all|none|true|false|yes|no" },
+            { "lookahead",     Kind::Number, 0, 20 },
+            { "key",           Kind::Option, 0, 0, "sidechain|input" },
+            { "key_filter",    Kind::Option, 0, 0, "none|highpass|lowpass|bandpass" },
+            { "key_frequency", Kind::Number, 10, 22000 },
+            { "key_q",         Kind::Number, 0.01, 40 },
+        };
+        return dynamics;
+    }
+
+    const std::vector<NodeSpec>& getNodeSpecs()
+    {
+        // Group, Feedback and Bus bodies are built as groups, so they all take mode and repeat
+        static const std::vector<NodeSpec> specs {
+            { { "Group" }, Structure::Group, {
+                { "mode",   Kind::Option, 0, 0, "series|parallel" },
+                { "repeat", Kind::Number, 1, 64 } } },
+
+            { { "Feedback" }, Structure::Feedback, {
+                { "delay",         Kind::Number, 0.001, 10000 },
+                { "delay_samples", Kind::Number, 1, 1 << 20 },
+                { "feedback",      Kind::Number, -1, 1 },
+                { "mode",          Kind::Option, 0, 0, "series|parallel" },
+                { "repeat",        Kind::Number, 1, 64 } } },
+
+            { { "Modulator" }, Structure::Modulator, {
+                { "name",         Kind::Text },
+                { "source",       Kind::Option, 0, 0, "lfo|envelope|follower|random|step|steps" },
+                { "shape",        Kind::Option, 0, 0, "sine|triangle|saw|square" },
+                { "rate",         Kind::Number, 0, 1000 },
+                { "phase",        Kind::Number, 0, 1 },
+                { "polarity",     Kind::Option, 0, 0, "bipolar|unipolar" },
+                { "smooth",       Kind::Flag },
+                { "seed",         Kind::Number, -2147483648.0, 2147483647.0 },
+                { "attack",       Kind::Number, 0, 10000 },
+                { "release",      Kind::Number, 0, 10000 },
+                { "control_rate", Kind::Number, 10, 48000 },
+                { "steps",        Kind::List } } },
+
+            { { "Send" }, Structure::Send, {
+                { "send",  Kind::Text },
+                { "bus",   Kind::Text },
+                { "level", Kind::Number, -100, 24 } } },
+
+            { { "Bus" }, Structure::Bus, {
+                { "name",   Kind::Text },
+                { "level",  Kind::Number, -100, 24 },
+                { "output", Kind::Text },
+                { "mode",   Kind::Option, 0, 0, "series|parallel" },
+                { "repeat", Kind::Number, 1, 64 } } },
+
+            { { "Gain" }, Structure::Effect, {
+                { "gain_db", Kind::Parameter, -100, 24 },
+                { "gain",    Kind::Parameter, 0, 16 } } },
+
+            // FilterEffect compares the mode names exactly
+            { { "Filter", "EQ" }, Structure::Effect, {
+                { "mode",      Kind::Option, 0, 0, "LowPass|HighPass|BandPass", true },
+                { "frequency", Kind::Parameter, 10, 22000 },
+                { "q",         Kind::Parameter, 0.01, 40 } } },
+
+            { { "Compressor" }, Structure::Effect, {
+                { "threshold", Kind::Number, -100, 0 },
+                { "ratio",     Kind::Number, 1, 100 },
+                { "attack",    Kind::Number, 0, 1000 },
+                { "release",   Kind::Number, 0, 5000 },
+                { "knee",      Kind::Number, 0, 48 },
+                { "detection", Kind::Option, 0, 0, "peak|rms" } }, true },
+
+            { { "Limiter" }, Structure::Effect, {
+                { "threshold", Kind::Number, -60, 0 },
+                { "release",   Kind::Number, 0, 5000 },
+                { "knee",      Kind::Number, 0, 48 } }, true },
+
+            { { "NoiseGate", "Gate" }, Structure::Effect, {
+                { "threshold",  Kind::Parameter, -100, 0 },
+                { "ratio",      Kind::Parameter, 1, 100 },
+                { "attack",     Kind::Parameter, 0, 1000 },
+                { "release",    Kind::Parameter, 0, 5000 },
+                { "knee",       Kind::Number, 0, 48 },
+                { "hysteresis", Kind::Number, 0, 40 },
+                { "detection",  Kind::Option, 0, 0, "peak|rms" } }, true },
+
+            { { "Chorus" }, Structure::Effect, {
+                { "mode",     Kind::Option, 0, 0, "classic|ensemble" },
+                { "voices",   Kind::Number, 1, 8 },
+                { "spread",   Kind::Number, 0, 1 },
+                { "rate",     Kind::Parameter, 0, 99 },
+                { "depth",    Kind::Parameter, 0, 1 },
+                { "delay",    Kind::Parameter, 1, 100 },
+                { "feedback", Kind::Parameter, -1, 1 },
+                { "mix",      Kind::Parameter, 0, 1 } } },
+
+            { { "Distortion" }, Structure::Effect, {
+                { "drive", Kind::Parameter, 0, 60 } } },
+
+            { { "Phaser" }, Structure::Effect, {
+                { "mode",      Kind::Option, 0, 0, "classic|ensemble" },
+                { "voices",    Kind::Number, 1, 8 },
+                { "spread",    Kind::Number, 0, 1 },
+                { "rate",      Kind::Parameter, 0, 99 },
+                { "depth",     Kind::Parameter, 0, 1 },
+                { "frequency", Kind::Parameter, 20, 20000 },
+                { "feedback",  Kind::Parameter, -1, 1 },
+                { "mix",       Kind::Parameter, 0, 1 } } },
+
+            // The upper limit on "time" also depends on the sample rate, see checkDelayTime()
+            { { "Delay" }, Structure::Effect, {
+                { "time",          Kind::Parameter, 0, 4 },
+                { "feedback",      Kind::Parameter, -1, 1 },
+                { "mix",           Kind::Parameter, 0, 1 },
+                { "interpolation", Kind::Option, 0, 0, "linear|lagrange|lagrange3|lagrange5|thiran|allpass|sinc" } } },
+
+            { { "LadderFilter", "MoogFilter" }, Structure::Effect, {
+                { "mode",      Kind::Option, 0, 0, "LP12|LP24|HP12|HP24|BP12|BP24" },
+                { "frequency", Kind::Parameter, 10, 22000 },
+                { "resonance", Kind::Parameter, 0, 1 },
+                { "drive",     Kind::Parameter, 1, 100 } } },
+
+            { { "Panner", "Pan" }, Structure::Effect, {
+                { "pan",  Kind::Parameter, -1, 1 },
+                { "rule", Kind::Option, 0, 0, "linear|balanced|sin3db|sin4.5db|sin6db|square" } } },
+
+            { { "Reverb" }, Structure::Effect, {
+                { "mode",      Kind::Option, 0, 0, "classic|fdn" },
+                { "lines",     Kind::Number, 8, 16 },
+                { "room_size", Kind::Parameter, 0, 1 },
+                { "damping",   Kind::Parameter, 0, 1 },
+                { "wet",       Kind::Parameter, 0, 1 },
+                { "dry",       Kind::Parameter, 0, 1 },
+                { "width",     Kind::Parameter, 0, 1 } } },
+
+            { { "Convolution", "IR" }, Structure::Effect, {
+                { "file",           Kind::Text },
+                { "normalise",      Kind::Flag },
+                { "tail_partition", Kind::Number, 256, 65536 },
+                { "wet",            Kind::Parameter, 0, 4 },
+                { "dry",            Kind::Parameter, 0, 4 } } },
+        };
+        return specs;
+    }
+
+    const NodeSpec* findNodeSpec(const juce::String& type)
+    {
+        for (const auto& spec : getNodeSpecs())
+            for (const auto* name : spec.types)
+                if (type == name)
+                    return &spec;
+
+        return nullptr;
+    }
+
+    //==============================================================================
+    // Reference costs of one instance, per channel at 48 kHz in single precision.
+    // Regenerate with "EffectBenchmarks costs" after changing an effect.
+    const std::map<juce::String, PresetAnalyzer::EffectCost>& getCostTable()
+    {
+        //                                 nsPerSample  nsPerCall  stateSeconds  stateSamples
+        static const std::map<juce::String, PresetAnalyzer::EffectCost> table {
+            { "Gain",            {  0.3,   40.0, 0.0,  0 } },
+            { "Filter",          {  1.5,   60.0, 0.0,  0 } },
+            { "Compressor",      {  9.0,   80.0, 0.02, 0 } },   // lookahead line, allocated whether used or not
+            { "Limiter",         { 14.0,   80.0, 0.04, 0 } },
+            { "NoiseGate",       { 14.0,   80.0, 0.02, 0 } },
+            { "Chorus",          {  9.0,  120.0, 0.1,  0 } },
+            { "Chorus ensemble", {  7.0,  150.0, 0.13, 0 } },   // any voice count: all 8 lanes always run
+            { "Distortion",      {  7.0,   80.0, 0.0,  0 } },
+            { "Phaser",          { 16.0,  120.0, 0.0,  0 } },
+            { "Phaser ensemble", { 12.0,  150.0, 0.0,  0 } },
+            { "Delay",           {  7.0,   60.0, 0.0,  262160 } },
+            { "Delay lagrange3", {  8.0,   60.0, 0.0,  262160 } },
+            { "Delay lagrange5", { 10.0,   60.0, 0.0,  262160 } },
+            { "Delay thiran",    {  9.0,   60.0, 0.0,  262160 } },
+            { "Delay sinc",      { 16.0,   60.0, 0.0,  262160 } },
+            { "LadderFilter",    { 22.0,   80.0, 0.0,  0 } },
+            { "Panner",          {  1.5,   60.0, 0.0,  0 } },
+            { "Reverb",          { 14.0,  150.0, 0.15, 0 } },
+            { "Reverb fdn 8",    { 12.0,  200.0, 2.8,  0 } },
+            { "Reverb fdn 16",   { 22.0,  200.0, 2.8,  0 } },
+            { "Convolution",     { 30.0,  600.0, 1.0,  0 } },   // depends on the impulse; this is for ~2 s
+        };
+        return table;
+    }
+
+    // Graph overheads, in ns per channel and sample
+    constexpr double doublePrecisionFactor = 1.4;   // effects running in double precision
+    constexpr double conversionCost = 1.0;          // float <-> double at a precision boundary
+    constexpr double parallelBranchCost = 0.5;      // copying a parallel branch's input and mixing it back
+    constexpr double sendCost = 0.5;                // adding into a bus
+    constexpr double busReturnCost = 1.0;           // mixing a bus out and clearing it
+    constexpr double feedbackRingCost = 1.0;        // reading and writing a feedback loop's ring buffer
+    constexpr double envelopeFollowerCost = 1.0;    // per channel, every sample
+
+    // Per control-rate tick
+    constexpr double modulatorTickCost = 50.0;
+    constexpr double modulationRouteTickCost = 200.0;
+
+    //==============================================================================
+    struct Scope
+    {
+        int numChannels = 2;
+        Precision precision = Precision::Single;
+        int passes = 1;
+        int sliceSize = 512;
+    };
+
+    struct Analysis
+    {
+        const PresetAnalyzer::Settings& settings;
+        PresetAnalyzer::Report& report;
+
+        std::map<juce::String, double> modulatorRates;    // name -> control rate
+        std::vector<std::pair<juce::String, juce::String>> modulationRefs, busRefs;  // path, name
+        juce::StringArray busNames;
+
+        void add(Severity severity, const juce::String& path, const juce::String& message)
+        {
+            report.issues.push_back({ severity, path, message });
+        }
+
+        size_t sampleBytes(Precision p) const { return p == Precision::Double ? sizeof(double) : sizeof(float); }
+
+        size_t blockBytes(int numChannels, Precision p) const
+        {
+            return static_cast<size_t>(settings.spec.maximumBlockSize) * static_cast<size_t>(numChannels) * sampleBytes(p);
+        }
+    };
+
+    bool isNode(const juce::ValueTree& tree)
+    {
+        return tree.hasProperty("type") || tree.hasProperty("send");
+    }
+
+    juce::String getNodeType(const juce::ValueTree& tree)
+    {
+        const auto type = tree.getProperty("type").toString();
+        return type.isEmpty() && tree.hasProperty("send") ? juce::String("Send") : type;
+    }
+
+    Precision getNodePrecision(const juce::ValueTree& tree, Precision parent)
+    {
+        const auto precision = tree.getProperty("precision", "").toString().trim().toLowerCase();
+
+        if (precision == "double" || precision == "64")
+            return Precision::Double;
+        if (precision == "float" || precision == "single" || precision == "32")
+            return Precision::Single;
+
+        return parent;
+    }
+
+    // Channels a "channels:" selection covers; names can't be resolved without
+    // the host's layout, so every entry is assumed to match one channel
+    int getNodeChannels(const juce::ValueTree& tree, int parentChannels)
+    {
+        juce::StringArray names;
+
+        auto channelsTree = tree.getChildWithName("channels");
+        if (channelsTree.isValid())
+        {
+            for (const auto& item : channelsTree)
+                names.add(item.getProperty("value").toString());
+        }
+        else if (tree.hasProperty("channels"))
+        {
+            auto value = tree.getProperty("channels");
+            if (auto* array = value.getArray())
+                for (const auto& item : *array)
+                    names.add(item.toString());
+            else
+                names.addTokens(value.toString(), " ,", "");
+        }
+        else
+        {
+            return parentChannels;
+        }
+
+        names.trim();
+        names.removeEmptyStrings();
+        names.removeDuplicates(true);
+        return juce::jmin(parentChannels, names.size());
+    }
+
+    bool isNumber(const juce::var& value)
+    {
+        if (value.isInt() || value.isInt64() || value.isDouble() || value.isBool())
+            return true;
+
+        const auto text = value.toString().trim();
+        return text.isNotEmpty() && text.containsOnly("0123456789.-+eE")
+            && text.containsAnyOf("0123456789");
+    }
+
+    juce::String formatNumber(double value)
+    {
+        if (value == std::floor(value) && std::abs(value) < 1.0e15)
+            return juce::String(static_cast<juce::int64>(value));
+
+        return juce::String(value, 3).trimCharactersAtEnd("0");
+    }
+
+    void checkNumber(Analysis& analysis, const juce::String& path, const ParameterSpec& spec, const juce::var& value)
+    {
+        if (!isNumber(value))
+        {
+            analysis.add(Severity::Error, path, "'" + juce::String(spec.name) + "' must be a number, not \"" + value.toString() + "\"");
+            return;
+        }
+
+        const auto number = static_cast<double>(value);
+        if (number < spec.minValue || number > spec.maxValue)
+            analysis.add(Severity::Error, path, "'" + juce::String(spec.name) + "' is " + formatNumber(number)
+                                                + " but must be between " + formatNumber(spec.minValue)
+                                                + " and " + formatNumber(spec.maxValue));
+    }
+
+    void checkValue(Analysis& analysis, const juce::String& path, const ParameterSpec& spec, const juce::var& value)
+    {
+        switch (spec.kind)
+        {
+            case Kind::Number:
+            case Kind::Parameter:
+                checkNumber(analysis, path, spec, value);
+                break;
+
+            case Kind::Flag:
+            {
+                const auto text = value.toString().trim().toLowerCase();
+                if (!isNumber(value) && text != "true" && text != "false" && text != "yes" && text != "no")
+                    analysis.add(Severity::Error, path, "'" + juce::String(spec.name) + "' must be true or false, not \"" + value.toString() + "\"");
+                break;
+            }
+
+            case Kind::Option:
+            {
+                if (spec.maxValue > spec.minValue && isNumber(value))
+                {
+                    checkNumber(analysis, path, spec, value);
+                    break;
+                }
+
+                const auto text = value.toString().trim();
+                const auto options = juce::StringArray::fromTokens(spec.options, "|", "");
+                const auto index = options.indexOf(text, !spec.caseSensitive);
+
+                if (index < 0)
+                    analysis.add(Severity::Error, path, "'" + juce::String(spec.name) + "' is \"" + text
+                                                        + "\" but must be one of: " + options.joinIntoString(", ")
+                                                        + (spec.maxValue > spec.minValue ? ", or a number from " + formatNumber(spec.minValue)
+                                                                                             + " to " + formatNumber(spec.maxValue) : juce::String()));
+                break;
+            }
+
+            case Kind::Text:
+                if (value.toString().trim().isEmpty())
+                    analysis.add(Severity::Error, path, "'" + juce::String(spec.name) + "' is empty");
+                break;
+
+            case Kind::List:
+                break;
+        }
+    }
+
+    // A parameter given as a map: { value: 800, mod: wobble, amount: 600, min: 20, max: 20000 }
+    void checkParameterMap(Analysis& analysis, const juce::String& path, const ParameterSpec& spec, const juce::ValueTree& param)
+    {
+        const auto modulated = param.hasProperty("mod");
+
+        if (spec.kind != Kind::Parameter && !modulated)
+        {
+            analysis.add(Severity::Warning, path, "'" + juce::String(spec.name) + "' is only read as a plain "
+                                                  "value here; the map form is ignored unless it sets 'mod'");
+            return;
+        }
+
+        // Only parameters the effect can change on the audio thread; the builder rejects the rest too
+        if (spec.kind != Kind::Parameter)
+        {
+            analysis.add(Severity::Error, path, "'" + juce::String(spec.name) + "' can't be modulated");
+            return;
+        }
+
+        if (param.hasProperty("value"))
+            checkValue(analysis, path, spec, param.getProperty("value"));
+        else if (param.hasProperty("default"))
+            checkValue(analysis, path, spec, param.getProperty("default"));
+        else if (!modulated)
+            analysis.add(Severity::Warning, path, "'" + juce::String(spec.name) + "' has no value; the effect's default is used");
+
+        if (!modulated)
+            return;
+
+        analysis.modulationRefs.push_back({ path, param.getProperty("mod").toString() });
+
+        for (const auto* limit : { "min", "max" })
+        {
+            if (!param.hasProperty(limit))
+                continue;
+
+            const auto value = param.getProperty(limit);
+            if (!isNumber(value))
+                analysis.add(Severity::Error, path, "'" + juce::String(spec.name) + "." + limit + "' must be a number");
+            else if ((double) value < spec.minValue || (double) value > spec.maxValue)
+                analysis.add(Severity::Warning, path, "'" + juce::String(spec.name) + "." + limit + "' lets modulation leave the range "
+                                                      + formatNumber(spec.minValue) + " to " + formatNumber(spec.maxValue));
+        }
+    }
+
+    const ParameterSpec* findParameter(const NodeSpec& spec, const juce::String& name)
+    {
+        for (const auto* list : { &getCommonParameters(), &spec.parameters, spec.dynamics ? &getDynamicsParameters() : nullptr })
+            if (list != nullptr)
+                for (const auto& parameter : *list)
+                    if (name == parameter.name)
+                        return &parameter;
+
+        return nullptr;
+    }
+
+    // Checks a node's own keys; child nodes are left to the caller
+    void checkKeys(Analysis& analysis, const juce::String& path, const NodeSpec& spec, const juce::ValueTree& tree)
+    {
+        for (int i = 0; i < tree.getNumProperties(); ++i)
+        {
+            const auto name = tree.getPropertyName(i).toString();
+            const auto* parameter = findParameter(spec, name);
+
+            if (parameter == nullptr)
+                analysis.add(Severity::Warning, path, "Unknown key '" + name + "' for " + spec.types.front());
+            else if (name != "type")
+                checkValue(analysis, path, *parameter, tree.getProperty(name));
+        }
+
+        for (const auto& child : tree)
+        {
+            if (isNode(child))
+                continue;
+
+            const auto name = child.getType().toString();
+            const auto* parameter = findParameter(spec, name);
+
+            if (parameter == nullptr)
+                analysis.add(Severity::Warning, path, "Unknown key '" + name + "' for " + spec.types.front());
+            else if (parameter->kind != Kind::List)
+                checkParameterMap(analysis, path, *parameter, child);
+        }
+    }
+
+    // Delays reach 192000 samples, which is less than 4 s above 48 kHz
+    void checkDelayTime(Analysis& analysis, const juce::String& path, const juce::ValueTree& tree)
+    {
+        auto time = tree.getProperty("time");
+        if (auto param = tree.getChildWithName("time"); param.isValid())
+            time = param.getProperty("value", param.getProperty("default"));
+
+        const auto maxSeconds = 192000.0 / analysis.settings.spec.sampleRate;
+        if (isNumber(time) && (double) time > maxSeconds)
+            analysis.add(Severity::Error, path, "'time' is " + formatNumber((double) time) + " s but the delay line holds at most "
+                                                + formatNumber(maxSeconds) + " s at " + formatNumber(analysis.settings.spec.sampleRate) + " Hz");
+    }
+
+    //==============================================================================
+    void analyzeNode(Analysis& analysis, const juce::ValueTree& tree, const Scope& parent, const juce::String& path, bool topLevel);
+
+    // Children of a group-like node, run as a series or parallel group
+    void analyzeGroupBody(Analysis& analysis, const juce::ValueTree& tree, const Scope& scope, const juce::String& path)
+    {
+        const auto parallel = tree.getProperty("mode", "series").toString().equalsIgnoreCase("parallel");
+        const auto repeat = juce::jmax(1, static_cast<int>(tree.getProperty("repeat", 1)));
+
+        auto childScope = scope;
+        childScope.passes = scope.passes * repeat;
+
+        int numBranches = 0;
+        for (int i = 0; i < tree.getNumChildren(); ++i)
+        {
+            const auto child = tree.getChild(i);
+            if (!isNode(child))
+                continue;
+
+            ++numBranches;
+            analyzeNode(analysis, child, childScope, path + " > #" + juce::String(i + 1) + " " + getNodeType(child), false);
+        }
+
+        // Every group keeps a scratch and a mix buffer
+        analysis.report.memoryBytes += 2 * analysis.blockBytes(scope.numChannels, scope.precision);
+
+        if (parallel)
+            analysis.report.nsPerSample += childScope.passes * numBranches * scope.numChannels * parallelBranchCost;
+    }
+
+    void analyzeEffect(Analysis& analysis, const juce::ValueTree& tree, const Scope& scope, const juce::String& path)
+    {
+        const auto type = tree.getProperty("type").toString().toStdString();
+        auto effect = EffectChain::createEffect<float>(type);
+        if (effect == nullptr)
+            return;
+
+        // Float-only effects in a double scope run in single precision behind a conversion
+        const auto runsInDouble = scope.precision == Precision::Double && EffectChain::createEffect<double>(type) != nullptr;
+        const auto effectPrecision = runsInDouble ? Precision::Double : Precision::Single;
+
+        const auto maxChannels = effect->getMaximumChannels();
+        const auto instances = maxChannels > 0 ? (scope.numChannels + maxChannels - 1) / maxChannels : 1;
+        analysis.report.numEffects += juce::jmax(1, instances);
+
+        const auto* cost = PresetAnalyzer::getEffectCost(tree);
+        if (cost == nullptr)
+        {
+            analysis.add(Severity::Warning, path, "No cost figures for " + PresetAnalyzer::getCostVariant(tree) + "; it isn't counted");
+            return;
+        }
+
+        auto perSample = cost->nsPerSample * (runsInDouble ? doublePrecisionFactor : 1.0);
+        if (scope.precision == Precision::Double && !runsInDouble)
+            perSample += 2.0 * conversionCost;
+
+        analysis.report.nsPerSample += scope.passes * (scope.numChannels * perSample
+                                                       + instances * cost->nsPerCall / scope.sliceSize);
+
+        const auto stateSamples = cost->stateSeconds * analysis.settings.spec.sampleRate + cost->stateSamples;
+        analysis.report.memoryBytes += static_cast<size_t>(stateSamples) * static_cast<size_t>(scope.numChannels) * analysis.sampleBytes(effectPrecision)
+                                     + 2 * analysis.blockBytes(scope.numChannels, effectPrecision);
+    }
+
+    void analyzeNode(Analysis& analysis, const juce::ValueTree& tree, const Scope& parent, const juce::String& path, bool topLevel)
+    {
+        const auto type = getNodeType(tree);
+        const auto* spec = findNodeSpec(type);
+
+        if (spec == nullptr || (spec->structure == Structure::Effect && EffectChain::createEffect<float>(type.toStdString()) == nullptr))
+        {
+            analysis.add(Severity::Error, path, "Unknown or invalid effect/group type: " + type);
+            return;
+        }
+
+        checkKeys(analysis, path, *spec, tree);
+
+        if (spec->structure == Structure::Bus && !topLevel)
+        {
+            analysis.add(Severity::Warning, path, "Buses are only declared at the top level; this one is ignored");
+            return;
+        }
+
+        auto scope = parent;
+        scope.precision = getNodePrecision(tree, parent.precision);
+
+        if (spec->structure != Structure::Bus)
+        {
+            scope.numChannels = getNodeChannels(tree, parent.numChannels);
+
+            // A selection that matches nothing leaves the node idle
+            if (scope.numChannels == 0)
+                return;
+        }
+
+        if (spec->structure == Structure::Effect)
+        {
+            for (const auto& child : tree)
+                if (isNode(child))
+                    analysis.add(Severity::Warning, path, "Effects don't take child nodes; '" + getNodeType(child) + "' is ignored");
+
+            if (juce::String(spec->types.front()) == "Delay")
+                checkDelayTime(analysis, path, tree);
+        }
+
+        // Crossing into another precision converts in and out
+        if (scope.precision != parent.precision)
+            analysis.report.nsPerSample += scope.passes * scope.numChannels * 2.0 * conversionCost;
+
+        switch (spec->structure)
+        {
+            case Structure::Effect:
+                analyzeEffect(analysis, tree, scope, path);
+                break;
+
+            case Structure::Group:
+                analyzeGroupBody(analysis, tree, scope, path);
+                break;
+
+            case Structure::Feedback:
+            {
+                const auto sampleRate = analysis.settings.spec.sampleRate;
+                const auto delaySamples = tree.hasProperty("delay_samples")
+                    ? juce::jmax(1, static_cast<int>(tree.getProperty("delay_samples")))
+                    : juce::jmax(1, juce::roundToInt(juce::jmax(0.001, static_cast<double>(tree.getProperty("delay", 1.0))) * 0.001 * sampleRate));
+
+                // The body runs in chunks no longer than the loop delay
+                auto bodyScope = scope;
+                bodyScope.sliceSize = juce::jmin(scope.sliceSize, delaySamples);
+
+                analysis.report.nsPerSample += scope.passes * scope.numChannels * feedbackRingCost;
+                analysis.report.memoryBytes += static_cast<size_t>(juce::nextPowerOfTwo(delaySamples + 1))
+                                             * static_cast<size_t>(scope.numChannels) * analysis.sampleBytes(scope.precision);
+
+                analyzeGroupBody(analysis, tree, bodyScope, path);
+                break;
+            }
+
+            case Structure::Modulator:
+            {
+                const auto name = tree.getProperty("name").toString();
+                const auto controlRate = juce::jlimit(10.0, 48000.0, static_cast<double>(tree.getProperty("control_rate", 1000.0)));
+
+                if (name.isEmpty())
+                    analysis.add(Severity::Warning, path, "Modulator without a name can't be referenced");
+                else if (analysis.modulatorRates.count(name) > 0)
+                    analysis.add(Severity::Warning, path, "Duplicate modulator name: " + name);
+
+                analysis.modulatorRates[name] = controlRate;
+
+                const auto source = tree.getProperty("source", "lfo").toString().trim().toLowerCase();
+                if (source == "envelope" || source == "follower")
+                    analysis.report.nsPerSample += scope.passes * scope.numChannels * envelopeFollowerCost;
+
+                analysis.report.nsPerSample += modulatorTickCost * controlRate / analysis.settings.spec.sampleRate;
+                break;
+            }
+
+            case Structure::Send:
+            {
+                const auto busName = tree.getProperty("send", tree.getProperty("bus")).toString().trim();
+                if (busName.isEmpty())
+                    analysis.add(Severity::Error, path, "Send without a bus");
+                else
+                    analysis.busRefs.push_back({ path, busName });
+
+                analysis.report.nsPerSample += scope.passes * scope.numChannels * sendCost;
+                break;
+            }
+
+            case Structure::Bus:
+            {
+                const auto name = tree.getProperty("name").toString().trim();
+                if (name.isEmpty())
+                    analysis.add(Severity::Error, path, "Bus without a name");
+                else if (analysis.busNames.contains(name))
+                    analysis.add(Severity::Error, path, "Duplicate bus name: " + name);
+
+                analysis.busNames.add(name);
+
+                if (tree.hasProperty("output") && !tree.getProperty("output").toString().equalsIgnoreCase("main"))
+                    analysis.busRefs.push_back({ path, tree.getProperty("output").toString().trim() });
+
+                // Pool slot in the graph's precision; buses that never overlap share one, this counts one each
+                analysis.report.memoryBytes += analysis.blockBytes(scope.numChannels, parent.precision);
+                analysis.report.nsPerSample += scope.numChannels * busReturnCost;
+
+                analyzeGroupBody(analysis, tree, scope, path);
+                break;
+            }
+        }
+    }
+}
+
+//==============================================================================
+bool PresetAnalyzer::Report::hasErrors() const
+{
+    for (const auto& issue : issues)
+        if (issue.severity == Issue::Severity::Error)
+            return true;
+
+    return false;
+}
+
+juce::String PresetAnalyzer::getCostVariant(const juce::ValueTree& effect)
+{
+    const auto type = effect.getProperty("type").toString();
+
+    if (const auto* spec = findNodeSpec(type))
+    {
+        const juce::String canonical = spec->types.front();
+
+        // Mirrors ReverbEffect::configure(): FDN only with "mode: fdn", 16 lines unless fewer are asked for
+        if (canonical == "Reverb" && effect.getProperty("mode", "classic").toString().equalsIgnoreCase("fdn"))
+            return (int) effect.getProperty("lines", 16) >= 16 ? "Reverb fdn 16" : "Reverb fdn 8";
+
+        // Mirrors DelayInterpolation::fromString()
+        if (canonical == "Delay" && effect.hasProperty("interpolation"))
+        {
+            const auto name = effect.getProperty("interpolation").toString().toLowerCase();
+            if (name == "lagrange" || name == "lagrange3") return "Delay lagrange3";
+            if (name == "lagrange5")                      return "Delay lagrange5";
+            if (name == "thiran" || name == "allpass")    return "Delay thiran";
+            if (name == "sinc")                           return "Delay sinc";
+        }
+
+        if ((canonical == "Chorus" || canonical == "Phaser") && effect.getProperty("mode", "classic").toString().equalsIgnoreCase("ensemble"))
+            return canonical + " ensemble";
+
+        return canonical;
+    }
+
+    return type;
+}
+
+const PresetAnalyzer::EffectCost* PresetAnalyzer::getEffectCost(const juce::ValueTree& effect)
+{
+    const auto& table = getCostTable();
+    const auto it = table.find(getCostVariant(effect));
+    return it != table.end() ? &it->second : nullptr;
+}
+
+PresetAnalyzer::Report PresetAnalyzer::analyze(const juce::ValueTree& preset, const Settings& settings)
+{
+    Report report;
+    Analysis analysis { settings, report };
+
+    const auto maxBlock = juce::jmax(1, static_cast<int>(settings.spec.maximumBlockSize));
+
+    Scope scope;
+    scope.numChannels = static_cast<int>(settings.spec.numChannels);
+    scope.precision = settings.precision;
+    scope.sliceSize = settings.subBlockSize > 0 ? juce::jmin(settings.subBlockSize, maxBlock) : maxBlock;
+
+    // The root group's buffers
+    report.memoryBytes += 2 * analysis.blockBytes(scope.numChannels, scope.precision);
+
+    for (int i = 0; i < preset.getNumChildren(); ++i)
+    {
+        const auto child = preset.getChild(i);
+        const auto path = "#" + juce::String(i + 1) + " " + getNodeType(child);
+
+        if (!isNode(child))
+        {
+            analysis.add(Severity::Error, "#" + juce::String(i + 1), "Entry without a type");
+            continue;
+        }
+
+        analyzeNode(analysis, child, scope, path, true);
+    }
+
+    // References are resolved once every modulator and bus is known, as the builder does
+    for (const auto& ref : analysis.modulationRefs)
+    {
+        const auto it = analysis.modulatorRates.find(ref.second);
+        if (ref.second.isEmpty() || it == analysis.modulatorRates.end())
+            analysis.add(Severity::Error, ref.first, "Unknown modulation source: " + ref.second);
+        else
+            report.nsPerSample += modulationRouteTickCost * it->second / settings.spec.sampleRate;
+    }
+
+    for (const auto& ref : analysis.busRefs)
+        if (!analysis.busNames.contains(ref.second))
+            analysis.add(Severity::Error, ref.first, "Unknown bus: " + ref.second);
+
+    const auto cpuLoad = report.getCpuLoad(settings.spec.sampleRate);
+    if (settings.cpuBudget > 0.0 && cpuLoad > settings.cpuBudget)
+        analysis.add(Severity::Error, {}, "Predicted CPU load of " + juce::String(cpuLoad * 100.0, 2) + " % of a core exceeds the budget of "
+                                          + juce::String(settings.cpuBudget * 100.0, 2) + " %");
+
+    if (settings.memoryBudget > 0 && report.memoryBytes > settings.memoryBudget)
+        analysis.add(Severity::Error, {}, "Predicted memory of " + juce::File::descriptionOfSizeInBytes((juce::int64) report.memoryBytes)
+                                          + " exceeds the budget of " + juce::File::descriptionOfSizeInBytes((juce::int64) settings.memoryBudget));
+
+    return report;
+}
+
+PresetAnalyzer::Report PresetAnalyzer::analyzeSource(const juce::String& source, const Settings& settings)
+{
+    juce::ValueTree preset;
+    const auto result = EffectChain::parse(source, preset);
+
+    if (result.failed())
+    {
+        Report report;
+        report.issues.push_back({ Issue::Severity::Error, {}, result.getErrorMessage() });
+        return report;
+    }
+
+    return analyze(preset, settings);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_dsp/juce_dsp.h>
+#include <juce_data_structures/juce_data_structures.h>
+#include "EffectChain.h"
+#include <vector>
+
+/**
+ * Checks a preset without building it, and predicts what it would cost.
+ *
+ * Every node's keys are checked against what that node type accepts. Numbers
+ * are checked against each parameter's range and options against their
+ * allowed values, and modulator, send and bus references are resolved. The
+ * cost model walks the same tree the builder would, so it counts repeated
+ * groups once per pass, adds the copy and mix work of parallel groups, and
+ * counts one instance per channel group for stereo-only effects. It then adds
+ * up per-effect costs from the table in PresetAnalyzer.cpp. Recalibrate that
+ * table with "EffectBenchmarks costs".
+ */
+class PresetAnalyzer
+{
+public:
+    struct Settings
+    {
+        juce::dsp::ProcessSpec spec { 48000.0, 512, 2 };
+        EffectChain::Precision precision = EffectChain::Precision::Single;
+        int subBlockSize = 0;
+
+        // Presets predicted to need more than this are reported as errors; 0 disables
+        double cpuBudget = 0.0;     // share of one core, e.g. 0.05 for 5 %
+        size_t memoryBudget = 0;    // bytes
+    };
+
+    struct Issue
+    {
+        enum class Severity { Warning, Error };
+
+        Severity severity = Severity::Error;
+        juce::String path;          // e.g. "#3 Group > #1 Delay"; empty for the whole preset
+        juce::String message;
+    };
+
+    struct Report
+    {
+        std::vector<Issue> issues;
+
+        int numEffects = 0;         // effect instances the graph would hold
+        double nsPerSample = 0.0;   // predicted processing time per sample frame
+        size_t memoryBytes = 0;     // buffers and effect state, erring on the large side
+
+        bool hasErrors() const;
+
+        // Share of one core at this sample rate (1.0 = a whole core)
+        double getCpuLoad(double sampleRate) const { return nsPerSample * sampleRate * 1.0e-9; }
+    };
+
+    static Report analyze(const juce::ValueTree& preset, const Settings& settings);
+
+    // Parses a YAML, JSON or XML preset first; a parse error is reported as an issue
+    static Report analyzeSource(const juce::String& source, const Settings& settings);
+
+    // Cost of one instance of an effect, per channel unless noted
+    struct EffectCost
+    {
+        double nsPerSample = 0.0;       // float processing, per channel
+        double nsPerCall = 0.0;         // fixed overhead of each process() call
+        double stateSeconds = 0.0;      // delay memory, scaled by the sample rate
+        int stateSamples = 0;           // delay memory of a fixed length
+    };
+
+    // Table entry for a configured effect (e.g. "Reverb fdn 16" for
+    // "type: Reverb, mode: fdn"), or nullptr for unknown types
+    static const EffectCost* getEffectCost(const juce::ValueTree& effect);
+    static juce::String getCostVariant(const juce::ValueTree& effect);
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "EffectChain.h"
+#include <functional>
+#include <memory>
+
+/**
+ * Loads presets on a background thread: parse, build and prepare all happen
+ * off the message thread, and EffectChain swaps the finished graph in at the
+ * end. A newer request supersedes an older one, which stops at its next stage
+ * boundary and never reports back.
+ *
+ * Progress and completion callbacks are delivered on the message thread.
+ * Completion also gets the program slot the preset went into (-1 on failure).
+ */
+class PresetLoader : private juce::Thread
+{
+public:
+    using ProgressCallback = std::function<void(EffectChain::LoadStage)>;
+    using FinishedCallback = std::function<void(juce::Result, int program)>;
+
+    explicit PresetLoader(EffectChain& chainToLoad)
+        : juce::Thread("Preset Loader"), chain(chainToLoad) {}
+
+    ~PresetLoader() override
+    {
+        generation->fetch_add(1);
+        stopThread(10000);
+    }
+
+    // Message thread
+    void load(const juce::String& source, ProgressCallback onProgress, FinishedCallback onFinished)
+    {
+        {
+            const juce::ScopedLock sl(requestLock);
+            request = { source, std::move(onProgress), std::move(onFinished), true };
+            generation->fetch_add(1);
+        }
+
+        if (!isThreadRunning())
+            startThread();
+
+        notify();
+    }
+
+private:
+    struct Request
+    {
+        juce::String source;
+        ProgressCallback onProgress;
+        FinishedCallback onFinished;
+        bool pending = false;
+    };
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            Request next;
+            juce::uint64 requestGeneration = 0;
+
+            {
+                const juce::ScopedLock sl(requestLock);
+                std::swap(next, request);
+                requestGeneration = generation->load();
+            }
+
+            if (!next.pending)
+            {
+                wait(-1);
+                continue;
+            }
+
+            auto isSuperseded = [this, requestGeneration]
+            {
+                return threadShouldExit() || generation->load() != requestGeneration;
+            };
+
+            auto reportStage = [this, &next, requestGeneration](EffectChain::LoadStage stage)
+            {
+                if (next.onProgress != nullptr)
+                    post(requestGeneration, [callback = next.onProgress, stage] { callback(stage); });
+            };
+
+            int program = -1;
+            auto result = chain.loadFromSource(next.source, isSuperseded, reportStage, &program);
+
+            if (next.onFinished != nullptr)
+                post(requestGeneration, [callback = next.onFinished, result, program] { callback(result, program); });
+        }
+    }
+
+    // Runs on the message thread unless a newer request has come in meanwhile
+    void post(juce::uint64 requestGeneration, std::function<void()> callback)
+    {
+        if (generation->load() != requestGeneration)
+            return;
+
+        // The counter outlives the loader, which bumps it when it goes away
+        juce::MessageManager::callAsync([latest = generation, requestGeneration, callback]
+        {
+            if (latest->load() == requestGeneration)
+                callback();
+        });
+    }
+
+    EffectChain& chain;
+
+    juce::CriticalSection requestLock;
+    Request request;
+    std::shared_ptr<std::atomic<juce::uint64>> generation = std::make_shared<std::atomic<juce::uint64>>(0);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetLoader)
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+// Compile the realtime-safety scope markers in (1) or out (0). When compiled
+// in, code running inside EffectChain::process() and selectWarmProgram() is
+// marked on its thread, so a checker (see Tests/RealtimeSafetyTest.cpp) can
+// trap allocations and lock acquisitions made there. Off in shipping builds.
+#ifndef PRESET_ENGINE_RT_CHECK
+ #define PRESET_ENGINE_RT_CHECK 0
+#endif
+
+namespace RealtimeCheck
+{
+    // Nesting depth of realtime scopes on this thread. Constant-initialised,
+    // so reading it from an allocator hook can't itself allocate.
+    inline thread_local int realtimeDepth = 0;
+
+    // Checks are suspended while this is non-zero, e.g. while a checker
+    // records a violation
+    inline thread_local int suspendDepth = 0;
+
+    inline bool isInRealtimeScope() { return realtimeDepth > 0 && suspendDepth == 0; }
+
+    struct ScopedRealtime
+    {
+        ScopedRealtime()  { ++realtimeDepth; }
+        ~ScopedRealtime() { --realtimeDepth; }
+    };
+
+    struct ScopedSuspend
+    {
+        ScopedSuspend()  { ++suspendDepth; }
+        ~ScopedSuspend() { --suspendDepth; }
+    };
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <typeindex>
+#include <type_traits>
+
+/**
+ * Process-wide cache for immutable, read-only artifacts shared between plugin
+ * instances: parsed presets, filter coefficient sets, lookup tables, impulse
+ * responses.
+ *
+ * Resources are keyed by a kind and a 64-bit content hash. The cache only holds
+ * weak references, so a resource lives exactly as long as some instance uses it;
+ * its memory is returned (and accounted for) when the last user lets go.
+ */
+class SharedResourceCache
+{
+public:
+    struct Key
+    {
+        juce::String kind;
+        juce::uint64 hash = 0;
+
+        bool operator<(const Key& other) const
+        {
+            return hash != other.hash ? hash < other.hash : kind < other.kind;
+        }
+    };
+
+    struct Stats
+    {
+        juce::int64 hits = 0;
+        juce::int64 misses = 0;
+        juce::int64 liveEntries = 0;
+        juce::int64 liveBytes = 0;
+        juce::int64 peakBytes = 0;
+
+        double getHitRate() const
+        {
+            const auto lookups = hits + misses;
+            return lookups > 0 ? (double) hits / (double) lookups : 0.0;
+        }
+    };
+
+    static SharedResourceCache& getInstance()
+    {
+        static SharedResourceCache instance;
+        return instance;
+    }
+
+    //==============================================================================
+    static constexpr juce::uint64 hashSeed = 14695981039346656037ULL;
+
+    // FNV-1a; cheap and stable across runs, which is all a content key needs.
+    static juce::uint64 hash(const void* data, size_t numBytes, juce::uint64 seed = hashSeed)
+    {
+        auto h = seed;
+        auto* bytes = static_cast<const juce::uint8*>(data);
+        for (size_t i = 0; i < numBytes; ++i)
+        {
+            h ^= bytes[i];
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    static juce::uint64 hash(const juce::String& text, juce::uint64 seed = hashSeed)
+    {
+        return hash(text.toRawUTF8(), text.getNumBytesAsUTF8(), seed);
+    }
+
+    template <typename Value>
+    static juce::uint64 hashValue(const Value& value, juce::uint64 seed = hashSeed)
+    {
+        static_assert(std::is_trivially_copyable<Value>::value, "hashValue needs a plain value type");
+        return hash(&value, sizeof(Value), seed);
+    }
+
+    //==============================================================================
+    /**
+     * Returns the cached resource for key, or calls create() to build it.
+     *
+     * create() runs without the cache lock held, so slow builds (disk reads, FFTs)
+     * don't stall other instances. If two instances race to build the same key,
+     * the first one published wins and the other result is discarded.
+     * sizeOf() reports the resource's footprint for the memory statistics.
+     */
+    template <typename Resource>
+    std::shared_ptr<const Resource> getOrCreate(const Key& key,
+                                                const std::function<std::unique_ptr<Resource>()>& create,
+                                                const std::function<size_t(const Resource&)>& sizeOf = {})
+    {
+        if (auto existing = find<Resource>(key))
+        {
+            ++hits;
+            return existing;
+        }
+
+        ++misses;
+
+        auto created = create();
+        if (created == nullptr)
+            return nullptr;
+
+        const auto bytes = (juce::int64) (sizeOf ? sizeOf(*created) : sizeof(Resource));
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto& entry = entries[key];
+        if (entry.type == std::type_index(typeid(Resource)))
+            if (auto raced = std::static_pointer_cast<const Resource>(entry.resource.lock()))
+                return raced;
+
+        // The deleter keeps the statistics honest and drops the map slot once the
+        // last instance releases the resource.
+        std::shared_ptr<const Resource> shared(created.release(), [this, key, bytes](const Resource* r)
+        {
+            release(key, bytes);
+            delete r;
+        });
+
+        entry.resource = shared;
+        entry.type = std::type_index(typeid(Resource));
+        entry.bytes = bytes;
+
+        ++liveEntries;
+        liveBytes += bytes;
+        peakBytes = juce::jmax(peakBytes.load(), liveBytes.load());
+
+        return shared;
+    }
+
+    Stats getStats() const
+    {
+        Stats s;
+        s.hits = hits.load();
+        s.misses = misses.load();
+        s.liveEntries = liveEntries.load();
+        s.liveBytes = liveBytes.load();
+        s.peakBytes = peakBytes.load();
+        return s;
+    }
+
+private:
+    struct Entry
+    {
+        std::weak_ptr<const void> resource;
+        std::type_index type { typeid(void) };
+        juce::int64 bytes = 0;
+    };
+
+    SharedResourceCache() = default;
+
+    template <typename Resource>
+    std::shared_ptr<const Resource> find(const Key& key)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = entries.find(key);
+        if (it == entries.end() || it->second.type != std::type_index(typeid(Resource)))
+            return nullptr;
+
+        return std::static_pointer_cast<const Resource>(it->second.resource.lock());
+    }
+
+    void release(const Key& key, juce::int64 bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        --liveEntries;
+        liveBytes -= bytes;
+
+        auto it = entries.find(key);
+        if (it != entries.end() && it->second.resource.expired())
+            entries.erase(it);
+    }
+
+    mutable std::mutex mutex;
+    std::map<Key, Entry> entries;
+
+    std::atomic<juce::int64> hits { 0 }, misses { 0 };
+    std::atomic<juce::int64> liveEntries { 0 }, liveBytes { 0 }, peakBytes { 0 };
+};
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <cmath>
+#include <vector>
+
+/**
+ * Draws magnitude spectra onto a log-like frequency axis without per-bin work
+ * at paint time.
+ *
+ * The bin range behind each pixel column is worked out once per size, FFT
+ * order and sample rate. Each frame then reduces to one peak per column, which
+ * falls back slowly (peak hold). The background and grid are drawn once into
+ * an image, and the trace paths keep their storage between frames.
+ */
+class SpectrumRenderer
+{
+public:
+    static constexpr int maxTraces = 2;
+
+    void setTraceColour(int trace, juce::Colour colour) { traces[(size_t) trace].colour = colour; }
+
+    // Rebuilds the column mapping and the grid when anything changed
+    void setLayout(int newWidth, int newHeight, int newFftOrder, double newSampleRate)
+    {
+        if (newWidth == width && newHeight == height && newFftOrder == fftOrder && newSampleRate == sampleRate)
+            return;
+
+        width = juce::jmax(0, newWidth);
+        height = juce::jmax(0, newHeight);
+        fftOrder = newFftOrder;
+        sampleRate = newSampleRate;
+
+        const auto halfSize = (1 << fftOrder) / 2;
+
+        // Column x shows proportion p = x / width of the axis, where
+        // p = 1 - (1 - bin / halfSize)^0.2, so bin = halfSize * (1 - (1 - p)^5)
+        columnFirstBin.resize((size_t) width + 1);
+        for (int x = 0; x <= width; ++x)
+        {
+            const auto p = width > 0 ? (double) x / width : 0.0;
+            columnFirstBin[(size_t) x] = juce::jlimit(0, halfSize - 1, (int) (halfSize * (1.0 - std::pow(1.0 - p, 5.0))));
+        }
+
+        for (auto& trace : traces)
+        {
+            trace.levels.assign((size_t) width, 0.0f);
+            trace.linePath.preallocateSpace(3 * (width + 2));
+            trace.fillPath.preallocateSpace(3 * (width + 4));
+        }
+
+        gridImage = {};
+    }
+
+    // Takes one frame of magnitudes (halfSize bins, as left by
+    // performFrequencyOnlyForwardTransform). Returns true if the trace changed.
+    bool update(int trace, const float* magnitudes)
+    {
+        auto& t = traces[(size_t) trace];
+        if (width <= 0 || height <= 0)
+            return false;
+
+        const auto fftSize = (float) (1 << fftOrder);
+        const auto offsetDb = juce::Decibels::gainToDecibels(fftSize);
+        bool changed = false;
+
+        for (int x = 0; x < width; ++x)
+        {
+            const auto first = columnFirstBin[(size_t) x];
+            const auto last = juce::jmax(first + 1, columnFirstBin[(size_t) x + 1]);
+
+            float peak = 0.0f;
+            for (int bin = first; bin < last; ++bin)
+                peak = juce::jmax(peak, magnitudes[bin]);
+
+            const auto levelDb = juce::Decibels::gainToDecibels(peak) - offsetDb;
+            const auto level = juce::jmap(juce::jlimit(minDb, maxDb, levelDb), minDb, maxDb, 0.0f, 1.0f);
+
+            auto& held = t.levels[(size_t) x];
+            const auto next = juce::jmax(level, held - holdDecayPerFrame);
+
+            if (next != held)
+            {
+                held = next;
+                changed = true;
+            }
+        }
+
+        if (changed)
+            rebuildPaths(t);
+
+        return changed;
+    }
+
+    // True when every trace has fallen to the floor
+    bool isSilent() const
+    {
+        for (const auto& trace : traces)
+            for (auto level : trace.levels)
+                if (level > 0.0f)
+                    return false;
+
+        return true;
+    }
+
+    void paint(juce::Graphics& g)
+    {
+        if (width <= 0 || height <= 0)
+            return;
+
+        const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+        if (!gridImage.isValid() || scale != gridScale)
+            renderGrid(scale);
+
+        g.drawImage(gridImage, juce::Rectangle<float>((float) width, (float) height));
+
+        for (const auto& trace : traces)
+        {
+            g.setColour(trace.colour.withAlpha(0.2f));
+            g.fillPath(trace.fillPath);
+
+            g.setColour(trace.colour);
+            g.strokePath(trace.linePath, juce::PathStrokeType(1.0f));
+        }
+    }
+
+private:
+    struct Trace
+    {
+        juce::Colour colour { juce::Colours::grey };
+        std::vector<float> levels;      // 0..1 per pixel column, with peak hold
+        juce::Path linePath, fillPath;
+    };
+
+    // Path::clear() keeps the allocated storage, so steady-state frames don't allocate
+    void rebuildPaths(Trace& t)
+    {
+        const auto h = (float) height;
+
+        t.linePath.clear();
+        t.linePath.startNewSubPath(0.0f, h);
+
+        for (int x = 0; x < width; ++x)
+            t.linePath.lineTo((float) x + 0.5f, h - t.levels[(size_t) x] * h);
+
+        t.fillPath.clear();
+        t.fillPath.addPath(t.linePath);
+        t.fillPath.lineTo((float) width, h);
+        t.fillPath.closeSubPath();
+    }
+
+    float xForFrequency(double frequency) const
+    {
+        const auto halfSize = (1 << fftOrder) / 2;
+        const auto bin = frequency * (1 << fftOrder) / sampleRate;
+        const auto p = 1.0 - std::pow(juce::jmax(0.0, 1.0 - bin / halfSize), 0.2);
+        return (float) (p * width);
+    }
+
+    void renderGrid(float scale)
+    {
+        gridScale = scale;
+        gridImage = juce::Image(juce::Image::RGB, juce::jmax(1, juce::roundToInt(width * scale)),
+                                juce::jmax(1, juce::roundToInt(height * scale)), false);
+
+        juce::Graphics g(gridImage);
+        g.addTransform(juce::AffineTransform::scale(scale));
+        g.fillAll(juce::Colour(0xff121212));
+
+        g.setColour(juce::Colour(0xff1f1f1f));
+
+        for (auto db = maxDb - 20.0f; db > minDb; db -= 20.0f)
+            g.drawHorizontalLine(juce::roundToInt(height * (1.0f - juce::jmap(db, minDb, maxDb, 0.0f, 1.0f))), 0.0f, (float) width);
+
+        if (sampleRate > 0.0)
+            for (auto frequency : { 100.0, 1000.0, 10000.0 })
+                if (frequency < sampleRate * 0.5)
+                    g.drawVerticalLine(juce::roundToInt(xForFrequency(frequency)), 0.0f, (float) height);
+    }
+
+    static constexpr float minDb = -100.0f;
+    static constexpr float maxDb = 0.0f;
+    static constexpr float holdDecayPerFrame = 0.015f;
+
+    int width = 0, height = 0, fftOrder = 0;
+    double sampleRate = 0.0;
+
+    std::vector<int> columnFirstBin;
+    std::array<Trace, (size_t) maxTraces> traces;
+
+    juce::Image gridImage;
+    float gridScale = 1.0f;
+};
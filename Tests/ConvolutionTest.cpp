@@ -0,0 +1,309 @@
+#include <juce_core/juce_core.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_dsp/juce_dsp.h>
+#include "../Source/Effects/ConvolutionEffect.h"
+#include <atomic>
+#include <cmath>
+#include <iostream>
+
+// cmake --build build --target ConvolutionTest
+// ConvolutionTest
+//
+// Checks the two-stage convolver against a direct convolution: the head must
+// play from the first block after prepare(), and when the tail's worker misses
+// its deadline the tail must go silent for the late periods and then carry on
+// in step, or restart cleanly, rather than play out of step.
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int partitionSize = 256;          // tail partition; the head is the first two
+    constexpr int headLength = 2 * partitionSize;
+    constexpr int impulseLength = 16 * partitionSize;
+    constexpr int numPeriods = 40;
+
+    struct TempImpulse
+    {
+        TempImpulse()
+        {
+            juce::Random random(42);
+            samples.resize((size_t) impulseLength);
+            for (int i = 0; i < impulseLength; ++i)
+                samples[(size_t) i] = (random.nextFloat() * 2.0f - 1.0f) * std::exp(-4.0f * (float) i / (float) impulseLength);
+
+            juce::AudioBuffer<float> buffer(1, impulseLength);
+            buffer.copyFrom(0, 0, samples.data(), impulseLength);
+
+            juce::WavAudioFormat wav;
+            std::unique_ptr<juce::OutputStream> stream(file.getFile().createOutputStream());
+            std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream.get(), sampleRate, 1, 32, {}, 0));
+            if (writer != nullptr)
+            {
+                stream.release();
+                writer->writeFromAudioSampleBuffer(buffer, 0, impulseLength);
+            }
+        }
+
+        juce::TemporaryFile file { ".wav" };
+        std::vector<float> samples;
+    };
+
+    std::vector<float> makeNoise(int length)
+    {
+        juce::Random random(7);
+        std::vector<float> noise((size_t) length);
+        for (auto& s : noise)
+            s = random.nextFloat() * 2.0f - 1.0f;
+        return noise;
+    }
+
+    // The tail's share of input convolved with the impulse
+    std::vector<float> convolveTail(const std::vector<float>& input, const std::vector<float>& impulse)
+    {
+        std::vector<float> output(input.size(), 0.0f);
+        for (size_t n = 0; n < input.size(); ++n)
+        {
+            double sum = 0.0;
+            for (size_t m = headLength; m < impulse.size() && m <= n; ++m)
+                sum += (double) impulse[m] * input[n - m];
+            output[n] = (float) sum;
+        }
+        return output;
+    }
+
+    bool check(bool condition, const juce::String& what)
+    {
+        std::cout << "  " << (condition ? "ok     " : "FAIL   ") << "  " << what << std::endl;
+        return condition;
+    }
+
+    // Holds every DspScheduler worker until released, so submitted work waits in the queues
+    class WorkerStall
+    {
+    public:
+        explicit WorkerStall(DspScheduler& schedulerToStall) : scheduler(schedulerToStall) {}
+
+        // The spinning tasks read this object, so wait for them to let go
+        ~WorkerStall()
+        {
+            release();
+
+            while (finished.load() < submitted)
+                juce::Thread::yield();
+        }
+
+        bool begin()
+        {
+            const auto numWorkers = scheduler.getNumWorkers();
+            for (int i = 0; i < numWorkers; ++i, ++submitted)
+                if (!scheduler.submit({ &WorkerStall::spin, this, DspScheduler::deadlineAfter(0.0), nullptr }))
+                    return false;
+
+            const auto timeout = juce::Time::getMillisecondCounter() + 2000;
+            while (started.load() < numWorkers)
+            {
+                if (juce::Time::getMillisecondCounter() > timeout)
+                    return false;
+
+                juce::Thread::yield();
+            }
+
+            return true;
+        }
+
+        void release()
+        {
+            released.store(true);
+        }
+
+    private:
+        static void spin(void* context)
+        {
+            auto& self = *static_cast<WorkerStall*>(context);
+            ++self.started;
+
+            while (!self.released.load())
+                juce::Thread::yield();
+
+            ++self.finished;
+        }
+
+        DspScheduler& scheduler;
+        int submitted = 0;
+        std::atomic<int> started { 0 }, finished { 0 };
+        std::atomic<bool> released { false };
+    };
+
+    bool testHeadIsReady(const TempImpulse& impulse)
+    {
+        std::cout << "Head" << std::endl;
+
+        ConvolutionEffect effect;
+        juce::ValueTree config("Convolution");
+        config.setProperty("file", impulse.file.getFile().getFullPathName(), nullptr);
+        config.setProperty("normalise", false, nullptr);
+        config.setProperty("tail_partition", partitionSize, nullptr);
+        config.setProperty("wet", 1.0f, nullptr);
+        config.setProperty("dry", 0.0f, nullptr);
+        effect.configure(config);
+        effect.prepare({ sampleRate, (juce::uint32) headLength, 1 });
+
+        // The first block after prepare() is all head
+        juce::AudioBuffer<float> buffer(1, headLength);
+        buffer.clear();
+        buffer.setSample(0, 0, 1.0f);
+
+        juce::dsp::AudioBlock<float> block(buffer);
+        effect.process(juce::dsp::ProcessContextReplacing<float>(block));
+
+        float maxError = 0.0f;
+        for (int i = 0; i < headLength; ++i)
+            maxError = juce::jmax(maxError, std::abs(buffer.getSample(0, i) - impulse.samples[(size_t) i]));
+
+        return check(maxError < 1.0e-5f, "first block plays the head, error " + juce::String(maxError));
+    }
+
+    // Plays numPeriods partitions of noise one partition per call, stalling the
+    // workers over stalledHandOffs hand-offs from period firstStalled. Returns
+    // the tail output and the deadlines it reports missing.
+    std::vector<float> playTail(const TempImpulse& impulse, const std::vector<float>& input,
+                                int firstStalled, int stalledHandOffs, int& missed)
+    {
+        juce::SharedResourcePointer<DspScheduler> scheduler;
+        auto partitioned = ImpulseResponseCache::getInstance().get(impulse.file.getFile(), sampleRate, partitionSize, false);
+
+        TailConvolver tail;
+        tail.prepare(partitioned, 1, sampleRate);
+
+        std::vector<float> output(input.size(), 0.0f);
+        std::unique_ptr<WorkerStall> stall;
+
+        for (int period = 0; period < numPeriods; ++period)
+        {
+            if (period == firstStalled)
+            {
+                stall = std::make_unique<WorkerStall>(*scheduler);
+                if (!stall->begin())
+                    std::cout << "  (the workers could not be stalled)" << std::endl;
+            }
+
+            const auto offset = (size_t) (period * partitionSize);
+            const float* in = input.data() + offset;
+            float* out = output.data() + offset;
+
+            juce::dsp::AudioBlock<float> outBlock(&out, 1, (size_t) partitionSize);
+            tail.process(juce::dsp::AudioBlock<const float>(&in, 1, (size_t) partitionSize), outBlock);
+
+            // The first stalled hand-off submits a block; each one after misses
+            if (period == firstStalled + stalledHandOffs)
+                stall.reset();
+
+            // Time for the worker when it isn't stalled
+            juce::Thread::sleep(10);
+        }
+
+        missed = tail.getMissedDeadlines();
+        return output;
+    }
+
+    struct PeriodMatch
+    {
+        int matching = 0, silent = 0, wrong = 0;
+    };
+
+    PeriodMatch matchPeriods(const std::vector<float>& output, const std::vector<float>& reference, int first, int last)
+    {
+        PeriodMatch result;
+
+        for (int period = first; period < last; ++period)
+        {
+            float maxError = 0.0f, peak = 0.0f, outputPeak = 0.0f;
+            for (int i = period * partitionSize; i < (period + 1) * partitionSize; ++i)
+            {
+                maxError = juce::jmax(maxError, std::abs(output[(size_t) i] - reference[(size_t) i]));
+                peak = juce::jmax(peak, std::abs(reference[(size_t) i]));
+                outputPeak = juce::jmax(outputPeak, std::abs(output[(size_t) i]));
+            }
+
+            if (maxError <= 1.0e-4f * juce::jmax(1.0f, peak))
+                ++result.matching;
+            else if (outputPeak == 0.0f)
+                ++result.silent;
+            else
+                ++result.wrong;
+        }
+
+        return result;
+    }
+
+    bool testMissedDeadline(const TempImpulse& impulse)
+    {
+        std::cout << "Tail, one missed deadline" << std::endl;
+
+        const auto input = makeNoise(numPeriods * partitionSize);
+        const auto reference = convolveTail(input, impulse.samples);
+
+        constexpr int stalled = 10;
+        int missed = 0;
+        const auto output = playTail(impulse, input, stalled, 1, missed);
+
+        // The result due at the missed hand-off and the kept partition's come
+        // too late for their periods; everything else plays in step
+        const auto before = matchPeriods(output, reference, 0, stalled + 2);
+        const auto during = matchPeriods(output, reference, stalled + 2, stalled + 4);
+        const auto after = matchPeriods(output, reference, stalled + 4, numPeriods);
+
+        bool passed = check(missed == 1, juce::String(missed) + " missed deadline(s)");
+        passed = check(before.wrong == 0 && before.silent == 0, "in step before the miss") && passed;
+        passed = check(during.wrong == 0 && during.silent == 2, juce::String(during.silent) + " silent period(s) while late") && passed;
+        passed = check(after.wrong == 0 && after.silent == 0, "in step after the miss, no input lost") && passed;
+        return passed;
+    }
+
+    bool testRestart(const TempImpulse& impulse)
+    {
+        std::cout << "Tail, two missed deadlines in a row" << std::endl;
+
+        const auto input = makeNoise(numPeriods * partitionSize);
+
+        constexpr int stalled = 10;
+        int missed = 0;
+        const auto output = playTail(impulse, input, stalled, 2, missed);
+
+        // The partition kept at the first miss is dropped at the second, and
+        // the tail restarts from the one after
+        auto restarted = input;
+        std::fill(restarted.begin(), restarted.begin() + (stalled + 2) * partitionSize, 0.0f);
+
+        const auto restartedReference = convolveTail(restarted, impulse.samples);
+        const auto before = matchPeriods(output, convolveTail(input, impulse.samples), 0, stalled + 2);
+        const auto during = matchPeriods(output, restartedReference, stalled + 2, stalled + 5);
+        const auto after = matchPeriods(output, restartedReference, stalled + 5, numPeriods);
+
+        bool passed = check(missed == 2, juce::String(missed) + " missed deadline(s)");
+        passed = check(before.wrong == 0 && before.silent == 0, "in step before the misses") && passed;
+        passed = check(during.wrong == 0, juce::String(during.silent) + " silent period(s) while late") && passed;
+        passed = check(after.wrong == 0 && after.silent == 0, "restarted in step from the newest input") && passed;
+        return passed;
+    }
+}
+
+int main()
+{
+    TempImpulse impulse;
+
+    int failures = testHeadIsReady(impulse) ? 0 : 1;
+
+    if (juce::SharedResourcePointer<DspScheduler>()->getNumWorkers() == 0)
+    {
+        std::cout << "No DSP workers: the tail runs inline and can't miss a deadline" << std::endl;
+    }
+    else
+    {
+        failures += testMissedDeadline(impulse) ? 0 : 1;
+        failures += testRestart(impulse) ? 0 : 1;
+    }
+
+    std::cout << std::endl << (failures == 0 ? "All passed" : juce::String(failures) + " test(s) failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,372 @@
+#include <juce_core/juce_core.h>
+#include <juce_dsp/juce_dsp.h>
+#include "../Source/EffectChain.h"
+#include "../Source/PresetAnalyzer.h"
+#include <iostream>
+#include <functional>
+#include <map>
+
+// cmake --build build --config Release --target EffectBenchmarks
+// EffectBenchmarks [suite...]   (no arguments runs every suite)
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+    constexpr int numChannels = 2;
+    constexpr double secondsOfAudio = 10.0;
+
+    juce::ValueTree makeConfig(const juce::String& type, std::initializer_list<std::pair<const char*, juce::var>> properties)
+    {
+        juce::ValueTree config("Effect");
+        config.setProperty("type", type, nullptr);
+        for (const auto& p : properties)
+            config.setProperty(p.first, p.second, nullptr);
+        return config;
+    }
+
+    void fillWithNoise(juce::AudioBuffer<float>& buffer, juce::Random& random)
+    {
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        {
+            auto* data = buffer.getWritePointer(ch);
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                data[i] = random.nextFloat() * 2.0f - 1.0f;
+        }
+    }
+
+    // Returns the average cost in nanoseconds per sample frame (all channels) of one instance
+    double measureEffect(const juce::ValueTree& config, int channels = numChannels)
+    {
+        auto effect = EffectChain::createEffect<float>(config.getProperty("type").toString().toStdString());
+        if (!effect)
+            return -1.0;
+
+        effect->configure(config);
+        effect->prepare({ sampleRate, (juce::uint32) blockSize, (juce::uint32) channels });
+
+        juce::AudioBuffer<float> buffer(channels, blockSize);
+        juce::Random random(1234);
+        fillWithNoise(buffer, random);
+
+        const auto numBlocks = (int) (secondsOfAudio * sampleRate / blockSize);
+
+        // Warm up caches and let parameter smoothing settle before timing
+        for (int i = 0; i < 16; ++i)
+        {
+            juce::dsp::AudioBlock<float> block(buffer);
+            effect->process(juce::dsp::ProcessContextReplacing<float>(block));
+        }
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            juce::dsp::AudioBlock<float> block(buffer);
+            effect->process(juce::dsp::ProcessContextReplacing<float>(block));
+        }
+        const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+        return elapsed * 1.0e9 / (numBlocks * (double) blockSize);
+    }
+
+    // RMS output level in dB for noise in, once the tail has built up
+    double measureLevel(const juce::ValueTree& config)
+    {
+        auto effect = EffectChain::createEffect<float>(config.getProperty("type").toString().toStdString());
+        if (!effect)
+            return -100.0;
+
+        effect->configure(config);
+        effect->prepare({ sampleRate, (juce::uint32) blockSize, (juce::uint32) numChannels });
+
+        juce::AudioBuffer<float> buffer(numChannels, blockSize);
+        juce::Random random(1234);
+
+        const auto numBlocks = (int) (2.0 * sampleRate / blockSize);
+        double sumOfSquares = 0.0;
+
+        for (int i = 0; i < 2 * numBlocks; ++i)
+        {
+            fillWithNoise(buffer, random);
+            juce::dsp::AudioBlock<float> block(buffer);
+            effect->process(juce::dsp::ProcessContextReplacing<float>(block));
+
+            if (i >= numBlocks)
+                for (int ch = 0; ch < numChannels; ++ch)
+                    for (int n = 0; n < blockSize; ++n)
+                        sumOfSquares += (double) buffer.getSample(ch, n) * buffer.getSample(ch, n);
+        }
+
+        return juce::Decibels::gainToDecibels(std::sqrt(sumOfSquares / (numBlocks * blockSize * numChannels)), -100.0);
+    }
+
+    void printRow(const juce::String& name, double nsPerSample, double baseline)
+    {
+        const auto realtimeShare = nsPerSample * sampleRate * 1.0e-9 * 100.0;
+        std::cout << name.paddedRight(' ', 36)
+                  << juce::String(nsPerSample, 2).paddedLeft(' ', 10) << " ns/sample"
+                  << juce::String(realtimeShare, 3).paddedLeft(' ', 10) << " % core"
+                  << juce::String(nsPerSample / baseline, 2).paddedLeft(' ', 8) << "x"
+                  << std::endl;
+    }
+
+    //==============================================================================
+    void runReverbSuite()
+    {
+        std::cout << "Reverb: cost per instance, " << numChannels << " channels @ " << sampleRate << " Hz" << std::endl;
+
+        const auto classic = measureEffect(makeConfig("Reverb", { { "room_size", 0.8f } }));
+        printRow("classic (juce::dsp::Reverb)", classic, classic);
+        printRow("fdn, 8 lines", measureEffect(makeConfig("Reverb", { { "mode", "fdn" }, { "lines", 8 }, { "room_size", 0.8f } })), classic);
+        printRow("fdn, 16 lines", measureEffect(makeConfig("Reverb", { { "mode", "fdn" }, { "lines", 16 }, { "room_size", 0.8f } })), classic);
+        std::cout << std::endl;
+
+        // The engines share a gain law, so their wet levels should be close
+        std::cout << "Reverb: wet level for noise in, relative to classic" << std::endl;
+
+        const auto wetOnly = [](const char* mode, int lines)
+        {
+            return makeConfig("Reverb", { { "mode", mode }, { "lines", lines }, { "room_size", 0.8f }, { "wet", 1.0f }, { "dry", 0.0f } });
+        };
+
+        const auto classicLevel = measureLevel(wetOnly("classic", 8));
+        for (const auto lines : { 8, 16 })
+            std::cout << ("fdn, " + juce::String(lines) + " lines").paddedRight(' ', 36)
+                      << juce::String(measureLevel(wetOnly("fdn", lines)) - classicLevel, 1).paddedLeft(' ', 10) << " dB"
+                      << std::endl;
+        std::cout << std::endl;
+    }
+
+    // Ensemble modes against the single-voice JUCE processors, per voice
+    void runEnsembleSuite()
+    {
+        for (const auto* type : { "Chorus", "Phaser" })
+        {
+            std::cout << type << ": cost per instance, " << numChannels << " channels @ " << sampleRate << " Hz" << std::endl;
+
+            const auto classic = measureEffect(makeConfig(type, { { "rate", 0.8f }, { "depth", 0.3f } }));
+            printRow("classic, 1 voice", classic, classic);
+
+            for (const auto voices : { 1, 2, 4, 8 })
+            {
+                const auto cost = measureEffect(makeConfig(type, { { "mode", "ensemble" }, { "voices", voices }, { "rate", 0.8f }, { "depth", 0.3f } }));
+                printRow("ensemble, " + juce::String(voices) + " voices", cost, classic);
+                printRow("  per voice", cost / voices, classic);
+            }
+
+            std::cout << std::endl;
+        }
+    }
+
+    // The shared dynamics engine: cost per channel as the bus widens, and of each option
+    void runDynamicsSuite()
+    {
+        std::cout << "Dynamics: cost per channel @ " << sampleRate << " Hz" << std::endl;
+
+        const auto compressor = makeConfig("Compressor", { { "threshold", -18.0f }, { "ratio", 3.0f } });
+        const auto baseline = measureEffect(compressor) / numChannels;
+
+        for (const auto channels : { 1, 2, 6, 8, 12, 16, 32 })
+        {
+            printRow("Compressor, " + juce::String(channels) + " channels", measureEffect(compressor, channels) / channels, baseline);
+            printRow("  link: all", measureEffect(makeConfig("Compressor", { { "threshold", -18.0f }, { "ratio", 3.0f }, { "link", "all" } }), channels) / channels, baseline);
+        }
+
+        printRow("Compressor, knee: 6", measureEffect(makeConfig("Compressor", { { "threshold", -18.0f }, { "ratio", 3.0f }, { "knee", 6.0f } })) / numChannels, baseline);
+        printRow("Compressor, detection: rms", measureEffect(makeConfig("Compressor", { { "threshold", -18.0f }, { "ratio", 3.0f }, { "detection", "rms" } })) / numChannels, baseline);
+        printRow("Compressor, lookahead: 5", measureEffect(makeConfig("Compressor", { { "threshold", -18.0f }, { "ratio", 3.0f }, { "lookahead", 5.0f } })) / numChannels, baseline);
+        printRow("Limiter", measureEffect(makeConfig("Limiter", { { "threshold", -1.0f } })) / numChannels, baseline);
+        printRow("NoiseGate", measureEffect(makeConfig("NoiseGate", { { "threshold", -50.0f } })) / numChannels, baseline);
+        printRow("NoiseGate, hysteresis: 6", measureEffect(makeConfig("NoiseGate", { { "threshold", -50.0f }, { "hysteresis", 6.0f } })) / numChannels, baseline);
+        std::cout << std::endl;
+    }
+
+    // Level of a sine through a wet-only delay of 480.5 samples, in dB. Half a
+    // sample is the worst case for every interpolator's high-frequency loss.
+    double measureDelayResponse(const juce::String& interpolation, double frequency)
+    {
+        auto config = makeConfig("Delay", { { "interpolation", interpolation }, { "time", 480.5 / sampleRate },
+                                            { "feedback", 0.0f }, { "mix", 1.0f } });
+
+        auto effect = EffectChain::createEffect<float>("Delay");
+        effect->configure(config);
+        effect->prepare({ sampleRate, (juce::uint32) blockSize, 1 });
+
+        juce::AudioBuffer<float> buffer(1, blockSize);
+        double phase = 0.0, energy = 0.0;
+        const auto numBlocks = (int) (0.5 * sampleRate / blockSize);
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            for (int i = 0; i < blockSize; ++i, phase += juce::MathConstants<double>::twoPi * frequency / sampleRate)
+                buffer.setSample(0, i, (float) std::sin(phase));
+
+            juce::dsp::AudioBlock<float> block(buffer);
+            effect->process(juce::dsp::ProcessContextReplacing<float>(block));
+
+            // Past the delay and the parameter ramps
+            if (b >= numBlocks / 2)
+                for (int i = 0; i < blockSize; ++i)
+                    energy += buffer.getSample(0, i) * buffer.getSample(0, i);
+        }
+
+        const auto inputEnergy = 0.5 * (numBlocks - numBlocks / 2) * blockSize;
+        return juce::Decibels::gainToDecibels(std::sqrt(energy / inputEnergy), -200.0);
+    }
+
+    // Delay interpolation: cost per instance, and the high-frequency loss
+    // each one has at a fractional delay
+    void runDelaySuite()
+    {
+        std::cout << "Delay interpolation: " << numChannels << " channels @ " << sampleRate << " Hz; level at a delay of 480.5 samples" << std::endl;
+
+        const auto linear = measureEffect(makeConfig("Delay", { { "time", 0.35f }, { "feedback", 0.4f } }));
+
+        for (const auto* interpolation : { "linear", "lagrange3", "lagrange5", "thiran", "sinc" })
+        {
+            const auto cost = measureEffect(makeConfig("Delay", { { "interpolation", interpolation }, { "time", 0.35f }, { "feedback", 0.4f } }));
+            printRow(interpolation, cost, linear);
+
+            std::cout << "  ";
+            for (const auto frequency : { 1000.0, 5000.0, 10000.0, 15000.0, 20000.0 })
+                std::cout << juce::String(frequency / 1000.0, 0) << " kHz " << juce::String(measureDelayResponse(interpolation, frequency), 2) << " dB   ";
+            std::cout << std::endl;
+        }
+
+        std::cout << std::endl;
+    }
+
+    // Returns the average cost in nanoseconds per sample frame of a whole chain
+    double measureChain(const juce::String& yaml, int hostBlockSize, int subBlockSize)
+    {
+        EffectChain chain;
+        chain.setSubBlockSize(subBlockSize);
+        chain.prepare({ sampleRate, (juce::uint32) hostBlockSize, (juce::uint32) numChannels });
+
+        if (chain.loadFromYaml(yaml).failed())
+            return -1.0;
+
+        juce::AudioBuffer<float> buffer(numChannels, hostBlockSize);
+        juce::Random random(1234);
+        fillWithNoise(buffer, random);
+
+        const auto numBlocks = juce::jmax(1, (int) (secondsOfAudio * sampleRate / hostBlockSize));
+
+        for (int i = 0; i < 4; ++i)
+            chain.process(buffer);
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        for (int i = 0; i < numBlocks; ++i)
+            chain.process(buffer);
+        const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+        return elapsed * 1.0e9 / (numBlocks * (double) hostBlockSize);
+    }
+
+    void runSubBlockSuite()
+    {
+        // A typical mixing chain with enough state per effect to fall out of L1
+        const juce::String chainYaml =
+            "- type: Filter\n  mode: HighPass\n  frequency: 80.0\n"
+            "- type: Compressor\n  threshold: -18.0\n  ratio: 3.0\n"
+            "- type: Chorus\n  rate: 0.8\n  depth: 0.3\n  mix: 0.4\n"
+            "- type: Phaser\n  rate: 0.3\n  depth: 0.5\n"
+            "- type: Delay\n  time: 0.35\n  feedback: 0.4\n  mix: 0.3\n"
+            "- type: Distortion\n  drive: 6.0\n"
+            "- type: Limiter\n  threshold: -1.0\n";
+
+        for (const auto hostBlockSize : { 1024, 4096 })
+        {
+            std::cout << "Sub-block slicing: 7-effect chain, " << hostBlockSize << "-sample host blocks" << std::endl;
+
+            const auto whole = measureChain(chainYaml, hostBlockSize, 0);
+            printRow("whole host block", whole, whole);
+
+            for (const auto subBlockSize : { 32, 64, 128, 256, 512 })
+                printRow("slices of " + juce::String(subBlockSize), measureChain(chainYaml, hostBlockSize, subBlockSize), whole);
+
+            std::cout << std::endl;
+        }
+    }
+
+    // Measures what PresetAnalyzer's cost table assumes, per channel
+    void runCostSuite()
+    {
+        std::cout << "Analyzer cost table: ns per channel and sample, " << numChannels << " channels @ " << sampleRate << " Hz" << std::endl;
+
+        const std::vector<juce::ValueTree> configs {
+            makeConfig("Gain", { { "gain_db", -6.0f } }),
+            makeConfig("Filter", { { "mode", "LowPass" }, { "frequency", 1000.0f } }),
+            makeConfig("Compressor", { { "threshold", -18.0f }, { "ratio", 3.0f } }),
+            makeConfig("Limiter", { { "threshold", -1.0f } }),
+            makeConfig("NoiseGate", { { "threshold", -50.0f } }),
+            makeConfig("Chorus", { { "rate", 0.8f }, { "depth", 0.3f } }),
+            makeConfig("Chorus", { { "mode", "ensemble" }, { "voices", 8 }, { "rate", 0.8f }, { "depth", 0.3f } }),
+            makeConfig("Distortion", { { "drive", 6.0f } }),
+            makeConfig("Phaser", { { "rate", 0.3f }, { "depth", 0.5f } }),
+            makeConfig("Phaser", { { "mode", "ensemble" }, { "voices", 8 }, { "rate", 0.3f }, { "depth", 0.5f } }),
+            makeConfig("Delay", { { "time", 0.35f }, { "feedback", 0.4f } }),
+            makeConfig("Delay", { { "interpolation", "lagrange3" }, { "time", 0.35f }, { "feedback", 0.4f } }),
+            makeConfig("Delay", { { "interpolation", "lagrange5" }, { "time", 0.35f }, { "feedback", 0.4f } }),
+            makeConfig("Delay", { { "interpolation", "thiran" }, { "time", 0.35f }, { "feedback", 0.4f } }),
+            makeConfig("Delay", { { "interpolation", "sinc" }, { "time", 0.35f }, { "feedback", 0.4f } }),
+            makeConfig("LadderFilter", { { "mode", "LP24" }, { "frequency", 800.0f } }),
+            makeConfig("Panner", { { "pan", 0.3f } }),
+            makeConfig("Reverb", { { "room_size", 0.8f } }),
+            makeConfig("Reverb", { { "mode", "fdn" }, { "lines", 8 }, { "room_size", 0.8f } }),
+            makeConfig("Reverb", { { "mode", "fdn" }, { "lines", 16 }, { "room_size", 0.8f } }),
+        };
+
+        for (const auto& config : configs)
+        {
+            const auto measured = measureEffect(config) / numChannels;
+            const auto* cost = PresetAnalyzer::getEffectCost(config);
+            const auto assumed = cost != nullptr ? cost->nsPerSample : 0.0;
+
+            std::cout << PresetAnalyzer::getCostVariant(config).paddedRight(' ', 36)
+                      << juce::String(measured, 2).paddedLeft(' ', 10) << " measured"
+                      << juce::String(assumed, 2).paddedLeft(' ', 10) << " in table"
+                      << std::endl;
+        }
+
+        std::cout << std::endl;
+    }
+
+    const std::map<juce::String, std::function<void()>>& getSuites()
+    {
+        static const std::map<juce::String, std::function<void()>> suites {
+            { "costs", runCostSuite },
+            { "delay", runDelaySuite },
+            { "dynamics", runDynamicsSuite },
+            { "ensemble", runEnsembleSuite },
+            { "reverb", runReverbSuite },
+            { "subblock", runSubBlockSuite },
+        };
+        return suites;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const auto& suites = getSuites();
+
+    if (argc <= 1)
+    {
+        for (const auto& suite : suites)
+            suite.second();
+        return 0;
+    }
+
+    for (int i = 1; i < argc; ++i)
+    {
+        auto it = suites.find(juce::String(argv[i]).toLowerCase());
+        if (it == suites.end())
+        {
+            std::cerr << "Unknown benchmark suite: " << argv[i] << std::endl;
+            return 1;
+        }
+        it->second();
+    }
+
+    return 0;
+}
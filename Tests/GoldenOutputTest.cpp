@@ -0,0 +1,409 @@
+#include <juce_core/juce_core.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_dsp/juce_dsp.h>
+#include "../Source/EffectChain.h"
+#include <cstring>
+#include <iostream>
+
+// cmake --build build --config Release --target GoldenOutputTest
+// GoldenOutputTest [options] [preset...]   (no presets: every preset in --presets)
+//
+// Renders presets over fixed test signals and compares the output with the
+// reference renders in --references. After a change that is meant to alter
+// the sound, record new references with --update and commit them.
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+    constexpr int numChannels = 2;
+
+    // Each preset renders one file: the signals in this order, each followed
+    // by silence so tails are compared too
+    struct Segment
+    {
+        const char* name;
+        double signalSeconds;
+        double tailSeconds;
+    };
+
+    constexpr Segment segments[] = {
+        { "impulse", 0.0,  0.25 },
+        { "sweep",   0.5,  0.25 },
+        { "noise",   0.1,  0.25 },
+    };
+
+    int toSamples(double seconds) { return juce::roundToInt(seconds * sampleRate); }
+
+    int getSegmentLength(const Segment& s) { return juce::jmax(1, toSamples(s.signalSeconds)) + toSamples(s.tailSeconds); }
+
+    juce::AudioBuffer<float> makeTestSignal()
+    {
+        int total = 0;
+        for (const auto& s : segments)
+            total += getSegmentLength(s);
+
+        juce::AudioBuffer<float> signal(numChannels, total);
+        signal.clear();
+
+        int start = 0;
+
+        // Unit impulse on every channel
+        for (int ch = 0; ch < numChannels; ++ch)
+            signal.setSample(ch, start, 1.0f);
+        start += getSegmentLength(segments[0]);
+
+        // Exponential sine sweep, 20 Hz to 20 kHz at -6 dBFS, the same on every channel
+        {
+            const auto length = toSamples(segments[1].signalSeconds);
+            const auto ratio = std::log(20000.0 / 20.0);
+
+            for (int i = 0; i < length; ++i)
+            {
+                const auto t = i / sampleRate;
+                const auto phase = juce::MathConstants<double>::twoPi * 20.0 * segments[1].signalSeconds / ratio
+                                 * (std::exp(t / segments[1].signalSeconds * ratio) - 1.0);
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                    signal.setSample(ch, start + i, (float) (0.5 * std::sin(phase)));
+            }
+
+            start += getSegmentLength(segments[1]);
+        }
+
+        // White noise at -12 dBFS, a different seed per channel
+        {
+            const auto length = toSamples(segments[2].signalSeconds);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                juce::Random random(1234 + ch);
+                for (int i = 0; i < length; ++i)
+                    signal.setSample(ch, start + i, (random.nextFloat() * 2.0f - 1.0f) * 0.25f);
+            }
+        }
+
+        return signal;
+    }
+
+    juce::Result render(const juce::File& preset, juce::AudioBuffer<float>& output)
+    {
+        EffectChain chain;
+        chain.setFileDirectory(preset.getParentDirectory());
+        chain.setPrecision(EffectChain::Precision::Single);
+        chain.prepare({ sampleRate, (juce::uint32) blockSize, (juce::uint32) numChannels });
+
+        const auto result = chain.loadFromSource(preset.loadFileAsString());
+        if (result.failed())
+            return result;
+
+        output = makeTestSignal();
+
+        juce::AudioBuffer<float> block;
+        for (int start = 0; start < output.getNumSamples(); start += blockSize)
+        {
+            const auto length = juce::jmin(blockSize, output.getNumSamples() - start);
+            block.setDataToReferTo(output.getArrayOfWritePointers(), numChannels, start, length);
+            chain.process(block);
+        }
+
+        return juce::Result::ok();
+    }
+
+    //==============================================================================
+    // How closely a render has to match its reference
+    struct Tolerance
+    {
+        enum class Mode { Exact, Ulp, Decibels };
+
+        Mode mode = Mode::Decibels;
+        double value = -100.0;  // ULPs, or dB of the error relative to the segment's peak
+
+        static bool parse(const juce::String& text, Tolerance& result)
+        {
+            if (text == "exact")
+            {
+                result = { Mode::Exact, 0.0 };
+                return true;
+            }
+
+            if (text.startsWith("ulp:"))
+            {
+                result = { Mode::Ulp, text.fromFirstOccurrenceOf(":", false, false).getDoubleValue() };
+                return result.value >= 0.0;
+            }
+
+            if (text.startsWith("db:"))
+            {
+                result = { Mode::Decibels, text.fromFirstOccurrenceOf(":", false, false).getDoubleValue() };
+                return result.value < 0.0;
+            }
+
+            return false;
+        }
+
+        juce::String describe() const
+        {
+            switch (mode)
+            {
+                case Mode::Exact:    return "bit-exact";
+                case Mode::Ulp:      return "within " + juce::String((int) value) + " ULP";
+                case Mode::Decibels: return "error below " + juce::String(value, 1) + " dB";
+            }
+
+            return {};
+        }
+    };
+
+    // Distance between two floats in representable steps
+    juce::int64 ulpDistance(float a, float b)
+    {
+        auto ordered = [](float x)
+        {
+            juce::int32 bits;
+            std::memcpy(&bits, &x, sizeof(bits));
+            return bits < 0 ? (juce::int64) std::numeric_limits<juce::int32>::min() - bits : (juce::int64) bits;
+        };
+
+        return std::abs(ordered(a) - ordered(b));
+    }
+
+    struct Difference
+    {
+        juce::int64 maxUlp = 0;
+        float maxError = 0.0f;
+        float referencePeak = 0.0f;
+        bool nonFinite = false;
+
+        // Error relative to the reference's peak; an all-silent reference is
+        // compared against full scale
+        double getErrorDb() const
+        {
+            const auto scale = referencePeak > 1.0e-6f ? referencePeak : 1.0f;
+            return juce::Decibels::gainToDecibels((double) maxError / scale, -300.0);
+        }
+
+        bool passes(const Tolerance& tolerance) const
+        {
+            if (nonFinite)
+                return false;
+
+            switch (tolerance.mode)
+            {
+                case Tolerance::Mode::Exact:    return maxUlp == 0;
+                case Tolerance::Mode::Ulp:      return (double) maxUlp <= tolerance.value;
+                case Tolerance::Mode::Decibels: return maxError == 0.0f || getErrorDb() <= tolerance.value;
+            }
+
+            return false;
+        }
+    };
+
+    Difference compare(const juce::AudioBuffer<float>& actual, const juce::AudioBuffer<float>& reference, int start, int length)
+    {
+        Difference d;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto* a = actual.getReadPointer(ch, start);
+            const auto* r = reference.getReadPointer(ch, start);
+
+            for (int i = 0; i < length; ++i)
+            {
+                if (!std::isfinite(a[i]))
+                {
+                    d.nonFinite = true;
+                    continue;
+                }
+
+                d.maxUlp = juce::jmax(d.maxUlp, ulpDistance(a[i], r[i]));
+                d.maxError = juce::jmax(d.maxError, std::abs(a[i] - r[i]));
+                d.referencePeak = juce::jmax(d.referencePeak, std::abs(r[i]));
+            }
+        }
+
+        return d;
+    }
+
+    //==============================================================================
+    // 32-bit float WAV, so references round-trip exactly
+    bool writeWav(const juce::File& file, const juce::AudioBuffer<float>& buffer)
+    {
+        file.deleteFile();
+
+        auto stream = file.createOutputStream();
+        if (stream == nullptr)
+            return false;
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream.get(), sampleRate, (unsigned int) numChannels, 32, {}, 0));
+        if (writer == nullptr)
+            return false;
+
+        stream.release();   // the writer owns it now
+        return writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+    }
+
+    bool readWav(const juce::File& file, juce::AudioBuffer<float>& buffer)
+    {
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatReader> reader(wav.createReaderFor(file.createInputStream().release(), true));
+        if (reader == nullptr || (int) reader->numChannels != numChannels)
+            return false;
+
+        buffer.setSize(numChannels, (int) reader->lengthInSamples);
+        return reader->read(&buffer, 0, buffer.getNumSamples(), 0, true, true);
+    }
+
+    //==============================================================================
+    struct Options
+    {
+        juce::File presetDirectory = juce::File::getCurrentWorkingDirectory().getChildFile("example");
+        juce::File referenceDirectory = juce::File::getCurrentWorkingDirectory().getChildFile("Tests/Golden");
+        juce::File failureDirectory;
+        Tolerance tolerance;
+        bool update = false;
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: GoldenOutputTest [options] [preset...]" << std::endl
+                  << "  --presets <dir>           presets to test when none are named, default ./example" << std::endl
+                  << "  --references <dir>        reference renders, default ./Tests/Golden" << std::endl
+                  << "  --tolerance <mode>        exact, ulp:<n> or db:<max error>, default db:-100" << std::endl
+                  << "  --write-failures <dir>    save the renders that don't match, for listening" << std::endl
+                  << "  --update                  record new references instead of comparing" << std::endl;
+    }
+
+    bool testPreset(const juce::File& preset, const Options& options)
+    {
+        const auto referenceFile = options.referenceDirectory.getChildFile(preset.getFileNameWithoutExtension() + ".wav");
+        std::cout << preset.getFileName() << std::endl;
+
+        juce::AudioBuffer<float> output;
+        const auto result = render(preset, output);
+        if (result.failed())
+        {
+            std::cout << "  FAIL     " << result.getErrorMessage() << std::endl;
+            return false;
+        }
+
+        if (options.update)
+        {
+            if (!options.referenceDirectory.createDirectory() || !writeWav(referenceFile, output))
+            {
+                std::cout << "  FAIL     Couldn't write " << referenceFile.getFullPathName() << std::endl;
+                return false;
+            }
+
+            std::cout << "  updated  " << referenceFile.getFullPathName() << std::endl;
+            return true;
+        }
+
+        juce::AudioBuffer<float> reference;
+        if (!referenceFile.existsAsFile() || !readWav(referenceFile, reference))
+        {
+            std::cout << "  FAIL     No reference at " << referenceFile.getFullPathName() << ", record one with --update" << std::endl;
+            return false;
+        }
+
+        if (reference.getNumSamples() != output.getNumSamples())
+        {
+            std::cout << "  FAIL     Reference has " << reference.getNumSamples() << " samples, the render "
+                      << output.getNumSamples() << "; the test signals changed, record new references" << std::endl;
+            return false;
+        }
+
+        bool passed = true;
+        int start = 0;
+
+        for (const auto& segment : segments)
+        {
+            const auto length = getSegmentLength(segment);
+            const auto d = compare(output, reference, start, length);
+            const auto ok = d.passes(options.tolerance);
+            passed = passed && ok;
+
+            std::cout << "  " << (ok ? "ok     " : "FAIL   ") << "  " << juce::String(segment.name).paddedRight(' ', 8)
+                      << (d.nonFinite ? juce::String("NaN/Inf in output") :
+                          "max " + juce::String(d.maxUlp) + " ULP, error " + (d.maxError == 0.0f ? juce::String("none") : juce::String(d.getErrorDb(), 1) + " dB"))
+                      << std::endl;
+
+            start += length;
+        }
+
+        if (!passed && options.failureDirectory != juce::File())
+        {
+            options.failureDirectory.createDirectory();
+            writeWav(options.failureDirectory.getChildFile(preset.getFileNameWithoutExtension() + ".actual.wav"), output);
+        }
+
+        return passed;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    juce::Array<juce::File> presets;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const juce::String arg(argv[i]);
+        const auto hasValue = i + 1 < argc;
+        const auto cwd = juce::File::getCurrentWorkingDirectory();
+
+        if (arg == "--help" || arg == "-h")
+        {
+            printUsage();
+            return 0;
+        }
+
+        if (arg == "--update")                             options.update = true;
+        else if (arg == "--presets" && hasValue)           options.presetDirectory = cwd.getChildFile(argv[++i]);
+        else if (arg == "--references" && hasValue)        options.referenceDirectory = cwd.getChildFile(argv[++i]);
+        else if (arg == "--write-failures" && hasValue)    options.failureDirectory = cwd.getChildFile(argv[++i]);
+        else if (arg == "--tolerance" && hasValue)
+        {
+            if (!Tolerance::parse(juce::String(argv[++i]).toLowerCase(), options.tolerance))
+            {
+                std::cerr << "Invalid tolerance: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (arg.startsWith("--"))
+        {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage();
+            return 1;
+        }
+        else
+        {
+            presets.add(cwd.getChildFile(arg));
+        }
+    }
+
+    if (presets.isEmpty())
+    {
+        for (const auto& entry : juce::RangedDirectoryIterator(options.presetDirectory, false, "*.yaml;*.yml;*.json;*.xml"))
+            presets.add(entry.getFile());
+
+        presets.sort();
+    }
+
+    if (presets.isEmpty())
+    {
+        std::cerr << "No presets found in " << options.presetDirectory.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    if (!options.update)
+        std::cout << "Tolerance: " << options.tolerance.describe() << std::endl << std::endl;
+
+    int failures = 0;
+    for (const auto& preset : presets)
+        failures += testPreset(preset, options) ? 0 : 1;
+
+    std::cout << std::endl << (presets.size() - failures) << " of " << presets.size() << " presets passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,357 @@
+#include <juce_core/juce_core.h>
+#include <juce_dsp/juce_dsp.h>
+#include "../Source/EffectChain.h"
+#include "../Source/RealtimeCheck.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#if defined(__linux__) && defined(__GLIBC__)
+ #include <dlfcn.h>
+ #include <pthread.h>
+ #define PRESET_ENGINE_TRAP_LIBC 1
+#else
+ #define PRESET_ENGINE_TRAP_LIBC 0
+#endif
+
+// cmake --build build --target RealtimeSafetyTest
+// RealtimeSafetyTest [preset...]   (no presets: every preset in ./example)
+//
+// Plays each preset on an audio thread while the main thread reloads it,
+// changes its parameters, switches programs and evicts them under a small
+// memory budget. Any heap allocation, free or mutex lock made inside
+// EffectChain::process() or selectWarmProgram() is reported with the stack
+// that made it, and fails the test.
+//
+// operator new and delete are trapped everywhere. On glibc, malloc, free and
+// pthread_mutex_lock are trapped too, which also catches allocations made
+// from C code and the mutexes inside std::mutex, juce::CriticalSection and
+// libstdc++'s atomic shared_ptr functions.
+
+#if ! PRESET_ENGINE_RT_CHECK
+ #error "RealtimeSafetyTest needs PRESET_ENGINE_RT_CHECK=1"
+#endif
+
+namespace
+{
+    struct Violation
+    {
+        juce::String what;
+        juce::String stack;
+        int count = 0;
+    };
+
+    std::mutex violationLock;
+    std::map<juce::String, Violation>& getViolations()
+    {
+        static std::map<juce::String, Violation> violations;
+        return violations;
+    }
+
+    void report(const char* what)
+    {
+        if (!RealtimeCheck::isInRealtimeScope())
+            return;
+
+        // Recording allocates and locks; don't trap that
+        const RealtimeCheck::ScopedSuspend suspend;
+
+        auto stack = juce::SystemStats::getStackBacktrace();
+        const auto key = juce::String(what) + stack;
+
+        const std::lock_guard<std::mutex> lock(violationLock);
+        auto& v = getViolations()[key];
+        v.what = what;
+        v.stack = stack;
+        ++v.count;
+    }
+}
+
+//==============================================================================
+// Allocation traps
+#if PRESET_ENGINE_TRAP_LIBC
+extern "C"
+{
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void* __libc_memalign(size_t, size_t);
+    void  __libc_free(void*);
+
+    void* malloc(size_t size)                   { report("malloc");  return __libc_malloc(size); }
+    void* calloc(size_t n, size_t size)         { report("calloc");  return __libc_calloc(n, size); }
+    void* realloc(void* p, size_t size)         { report("realloc"); return __libc_realloc(p, size); }
+    void* aligned_alloc(size_t a, size_t size)  { report("aligned_alloc"); return __libc_memalign(a, size); }
+
+    void free(void* p)
+    {
+        if (p != nullptr)
+            report("free");
+
+        __libc_free(p);
+    }
+
+    int posix_memalign(void** result, size_t alignment, size_t size)
+    {
+        report("posix_memalign");
+        *result = __libc_memalign(alignment, size);
+        return *result != nullptr ? 0 : ENOMEM;
+    }
+
+    int pthread_mutex_lock(pthread_mutex_t* mutex)
+    {
+        using LockFunction = int (*)(pthread_mutex_t*);
+        static const auto realLock = reinterpret_cast<LockFunction>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+
+        report("pthread_mutex_lock");
+        return realLock(mutex);
+    }
+}
+#endif
+
+// With the libc traps, new and delete are caught in malloc and free
+void* operator new(size_t size)
+{
+   #if ! PRESET_ENGINE_TRAP_LIBC
+    report("operator new");
+   #endif
+
+    if (auto* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)                                 { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept   { try { return operator new(size); } catch (...) { return nullptr; } }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { try { return operator new(size); } catch (...) { return nullptr; } }
+
+void operator delete(void* p) noexcept
+{
+   #if ! PRESET_ENGINE_TRAP_LIBC
+    if (p != nullptr)
+        report("operator delete");
+   #endif
+
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept                          { operator delete(p); }
+void operator delete(void* p, size_t) noexcept                    { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept                  { operator delete(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept     { operator delete(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept   { operator delete(p); }
+
+//==============================================================================
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+
+    // Every preset is played on a stereo bus and on the widest bus the plugin
+    // accepts (PresetEngineAudioProcessor::maxBusChannels)
+    constexpr int busWidths[] = { 2, 31 };
+
+    // Plays the chain on its own thread until stopped, with the host's
+    // buffers allocated up front. Programs are switched from here, as a MIDI
+    // program change would.
+    class AudioThread
+    {
+    public:
+        AudioThread(EffectChain& c, int numChannels, int programsToCycle) : chain(c), numPrograms(programsToCycle)
+        {
+            buffer.setSize(numChannels, blockSize);
+            thread = std::thread([this] { run(); });
+        }
+
+        ~AudioThread()
+        {
+            stop.store(true);
+            thread.join();
+        }
+
+        int getBlocksProcessed() const { return blocks.load(); }
+        void setProgramsToCycle(int count) { numPrograms.store(count); }
+
+    private:
+        void run()
+        {
+            juce::Random random(42);
+            int program = 0;
+
+            while (!stop.load())
+            {
+                for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+                {
+                    auto* data = buffer.getWritePointer(ch);
+                    for (int i = 0; i < blockSize; ++i)
+                        data[i] = (random.nextFloat() * 2.0f - 1.0f) * 0.25f;
+                }
+
+                const auto programs = numPrograms.load();
+                if (programs > 1 && blocks.load() % 16 == 15)
+                    chain.selectWarmProgram(program = (program + 1) % programs);
+
+                chain.process(buffer);
+                blocks.fetch_add(1);
+
+                // Leave the main thread time to reload between blocks
+                std::this_thread::yield();
+            }
+        }
+
+        EffectChain& chain;
+        std::atomic<int> numPrograms;
+        juce::AudioBuffer<float> buffer;
+        std::atomic<bool> stop { false };
+        std::atomic<int> blocks { 0 };
+        std::thread thread;
+    };
+
+    void waitForBlocks(const AudioThread& audio, int count)
+    {
+        const auto target = audio.getBlocksProcessed() + count;
+        while (audio.getBlocksProcessed() < target)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Every numeric setting scaled a little, as if a control had been moved
+    juce::ValueTree withChangedParameters(const juce::ValueTree& tree, float scale)
+    {
+        auto changed = tree.createCopy();
+
+        std::function<void(juce::ValueTree)> visit = [&](juce::ValueTree node)
+        {
+            for (int i = 0; i < node.getNumProperties(); ++i)
+            {
+                const auto name = node.getPropertyName(i);
+                const auto value = node.getProperty(name);
+
+                if ((value.isDouble() || value.isInt()) && name != juce::Identifier("repeat") && name != juce::Identifier("channels"))
+                    node.setProperty(name, static_cast<double>(value) * scale, nullptr);
+            }
+
+            for (auto child : node)
+                visit(child);
+        };
+
+        visit(changed);
+        return changed;
+    }
+
+    juce::Result testPreset(const juce::File& file, int numChannels)
+    {
+        const auto source = file.loadFileAsString();
+
+        juce::ValueTree tree;
+        auto result = EffectChain::parse(source, tree);
+        if (result.failed())
+            return result;
+
+        EffectChain chain;
+        chain.setFileDirectory(file.getParentDirectory());
+        chain.setTransition(0.02, 0.2);
+        chain.prepare({ sampleRate, (juce::uint32) blockSize, (juce::uint32) numChannels });
+
+        result = chain.loadFromSource(source);
+        if (result.failed())
+            return result;
+
+        // Two programs: the preset and a variant, so program changes swap graphs
+        chain.setProgram(1, source);
+        chain.getMeters().subscribe(1);
+
+        AudioThread audio(chain, numChannels, 2);
+        waitForBlocks(audio, 32);
+
+        for (int round = 0; round < 4; ++round)
+        {
+            // Parameter changes: rebuilt and crossfaded in while audio runs
+            result = chain.loadFromValueTree(withChangedParameters(tree, round % 2 == 0 ? 0.9f : 1.1f));
+            if (result.failed())
+                return result;
+
+            waitForBlocks(audio, 16);
+
+            // Reload of the original
+            result = chain.loadFromSource(source);
+            if (result.failed())
+                return result;
+
+            waitForBlocks(audio, 16);
+            chain.releaseRetiredGraphs();
+        }
+
+        // Program eviction: with a budget that keeps only the current program
+        // warm, slots are built and dropped while the audio thread switches
+        // between them
+        for (int i = 2; i < 4; ++i)
+            chain.setProgram(i, source);
+
+        audio.setProgramsToCycle(4);
+
+        for (int round = 0; round < 8; ++round)
+        {
+            chain.setProgramMemoryBudget(round % 2 == 0 ? 1 : (size_t) 256 * 1024 * 1024);
+            chain.setProgram(round % 4, source);
+            chain.releaseRetiredGraphs();
+            waitForBlocks(audio, 8);
+            chain.releaseRetiredGraphs();
+        }
+
+        chain.getMeters().unsubscribe(1);
+        return juce::Result::ok();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::Array<juce::File> presets;
+    const auto cwd = juce::File::getCurrentWorkingDirectory();
+
+    for (int i = 1; i < argc; ++i)
+        presets.add(cwd.getChildFile(argv[i]));
+
+    if (presets.isEmpty())
+    {
+        for (const auto& entry : juce::RangedDirectoryIterator(cwd.getChildFile("example"), false, "*.yaml;*.yml;*.json;*.xml"))
+            presets.add(entry.getFile());
+
+        presets.sort();
+    }
+
+    if (presets.isEmpty())
+    {
+        std::cerr << "No presets found" << std::endl;
+        return 1;
+    }
+
+    bool failed = false;
+
+    for (const auto& preset : presets)
+    {
+        for (const auto numChannels : busWidths)
+        {
+            const auto result = testPreset(preset, numChannels);
+            std::cout << preset.getFileName() << " (" << numChannels << " channels): "
+                      << (result.wasOk() ? juce::String("played") : "FAIL " + result.getErrorMessage()) << std::endl;
+            failed = failed || result.failed();
+        }
+    }
+
+    const std::lock_guard<std::mutex> lock(violationLock);
+    const auto& violations = getViolations();
+
+    for (const auto& entry : violations)
+        std::cout << std::endl << entry.second.what << " on the audio thread (" << entry.second.count << "x)" << std::endl
+                  << entry.second.stack << std::endl;
+
+    std::cout << std::endl << violations.size() << " realtime-safety violations" << std::endl;
+    return failed || !violations.empty() ? 1 : 0;
+}
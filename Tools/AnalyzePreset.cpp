@@ -0,0 +1,123 @@
+#include <juce_core/juce_core.h>
+#include <juce_dsp/juce_dsp.h>
+#include "../Source/EffectChain.h"
+#include "../Source/PresetAnalyzer.h"
+#include <iostream>
+
+// cmake --build build --config Release --target AnalyzePreset
+// AnalyzePreset [options] preset...
+//
+// Checks each preset and predicts its CPU and memory cost. Exits with 1 when
+// any preset has an error or goes over a budget.
+
+namespace
+{
+    void printUsage()
+    {
+        std::cout << "Usage: AnalyzePreset [options] preset..." << std::endl
+                  << "  --sample-rate <Hz>       default 48000" << std::endl
+                  << "  --block <samples>        host block size, default 512" << std::endl
+                  << "  --channels <n>           default 2" << std::endl
+                  << "  --sub-block <samples>    internal slice size, default 0 (whole blocks)" << std::endl
+                  << "  --double                 double-precision host" << std::endl
+                  << "  --cpu-budget <percent>   of one core, per track" << std::endl
+                  << "  --memory-budget <MB>" << std::endl
+                  << "  --no-build               skip building the preset after the static checks" << std::endl;
+    }
+
+    // Builds and prepares the preset, which catches what the static checks
+    // can't see, such as buses feeding each other or a missing impulse file
+    juce::Result tryBuild(const juce::File& file, const juce::String& source, const PresetAnalyzer::Settings& settings)
+    {
+        EffectChain chain;
+        chain.setFileDirectory(file.getParentDirectory());
+        chain.setPrecision(settings.precision);
+        chain.setSubBlockSize(settings.subBlockSize);
+        chain.prepare(settings.spec);
+        return chain.loadFromSource(source);
+    }
+
+    bool analyzeFile(const juce::File& file, const PresetAnalyzer::Settings& settings, bool build)
+    {
+        std::cout << file.getFullPathName() << std::endl;
+
+        if (!file.existsAsFile())
+        {
+            std::cout << "  error    File not found" << std::endl << std::endl;
+            return false;
+        }
+
+        const auto source = file.loadFileAsString();
+        auto report = PresetAnalyzer::analyzeSource(source, settings);
+
+        if (build && !report.hasErrors())
+        {
+            const auto result = tryBuild(file, source, settings);
+            if (result.failed())
+                report.issues.push_back({ PresetAnalyzer::Issue::Severity::Error, {}, "Build failed: " + result.getErrorMessage() });
+        }
+
+        for (const auto& issue : report.issues)
+        {
+            const auto label = issue.severity == PresetAnalyzer::Issue::Severity::Error ? "error  " : "warning";
+            std::cout << "  " << label << "  " << (issue.path.isNotEmpty() ? issue.path + ": " : juce::String()) << issue.message << std::endl;
+        }
+
+        std::cout << "  " << report.numEffects << " effects, "
+                  << juce::String(report.getCpuLoad(settings.spec.sampleRate) * 100.0, 2) << " % of a core ("
+                  << juce::String(report.nsPerSample, 1) << " ns/sample), "
+                  << juce::File::descriptionOfSizeInBytes((juce::int64) report.memoryBytes) << std::endl << std::endl;
+
+        return !report.hasErrors();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    PresetAnalyzer::Settings settings;
+    juce::Array<juce::File> files;
+    bool build = true;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const juce::String arg(argv[i]);
+        const auto hasValue = i + 1 < argc;
+
+        if (arg == "--help" || arg == "-h")
+        {
+            printUsage();
+            return 0;
+        }
+
+        if (arg == "--double")                        settings.precision = EffectChain::Precision::Double;
+        else if (arg == "--no-build")                 build = false;
+        else if (arg == "--sample-rate" && hasValue)  settings.spec.sampleRate = juce::String(argv[++i]).getDoubleValue();
+        else if (arg == "--block" && hasValue)        settings.spec.maximumBlockSize = (juce::uint32) juce::String(argv[++i]).getIntValue();
+        else if (arg == "--channels" && hasValue)     settings.spec.numChannels = (juce::uint32) juce::String(argv[++i]).getIntValue();
+        else if (arg == "--sub-block" && hasValue)    settings.subBlockSize = juce::String(argv[++i]).getIntValue();
+        else if (arg == "--cpu-budget" && hasValue)   settings.cpuBudget = juce::String(argv[++i]).getDoubleValue() * 0.01;
+        else if (arg == "--memory-budget" && hasValue) settings.memoryBudget = (size_t) (juce::String(argv[++i]).getDoubleValue() * 1024.0 * 1024.0);
+        else if (arg.startsWith("--"))
+        {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage();
+            return 1;
+        }
+        else
+        {
+            files.add(juce::File::getCurrentWorkingDirectory().getChildFile(arg));
+        }
+    }
+
+    if (files.isEmpty() || settings.spec.sampleRate <= 0.0 || settings.spec.maximumBlockSize == 0 || settings.spec.numChannels == 0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    bool allPassed = true;
+    for (const auto& file : files)
+        allPassed = analyzeFile(file, settings, build) && allPassed;
+
+    return allPassed ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <juce_core/juce_core.h>
+#include <juce_dsp/juce_dsp.h>
+#include "EffectChain.h"
+#include "PresetAnalyzer.h"
+#include <mutex>
+#include <vector>
+
+// cmake -B build -DPRESET_ENGINE_PYTHON=ON && cmake --build build --target preset_engine_native
+//
+// Renders presets from Python. Audio is a NumPy array of shape (channels, samples),
+// or (samples,) for mono, processed in place: the chain reads and writes the
+// array's own memory, and the GIL is released while it runs.
+
+namespace py = pybind11;
+
+namespace
+{
+    // Pointers to the start of each channel of a (channels, samples) or (samples,)
+    // array. Channels may be strided, but samples within a channel must be contiguous.
+    template <typename SampleType>
+    std::vector<SampleType*> getChannelPointers(const py::array& audio, const char* argumentName, int& numSamples)
+    {
+        const std::string name(argumentName);
+
+        if (!audio.dtype().is(py::dtype::of<SampleType>()))
+            throw py::type_error(name + " must be " + (std::is_same<SampleType, float>::value ? "float32" : "float64")
+                                 + ", convert it with .astype() first");
+
+        if (audio.ndim() != 1 && audio.ndim() != 2)
+            throw py::value_error(name + " must have shape (channels, samples) or (samples,)");
+
+        const auto sampleAxis = audio.ndim() - 1;
+        if (audio.shape(sampleAxis) > 1 && audio.strides(sampleAxis) != (py::ssize_t) sizeof(SampleType))
+            throw py::value_error(name + " must be contiguous along the sample axis, use np.ascontiguousarray()");
+
+        const auto numChannels = audio.ndim() == 2 ? (int) audio.shape(0) : 1;
+        const auto channelStride = audio.ndim() == 2 ? audio.strides(0) : 0;
+        numSamples = (int) audio.shape(sampleAxis);
+
+        auto* base = static_cast<char*>(const_cast<void*>(audio.data()));
+
+        std::vector<SampleType*> channels;
+        for (int ch = 0; ch < numChannels; ++ch)
+            channels.push_back(reinterpret_cast<SampleType*>(base + ch * channelStride));
+
+        return channels;
+    }
+
+    class PyEffectChain
+    {
+    public:
+        void prepare(double sampleRate, int blockSize, int numChannels, bool doublePrecision, int subBlockSize)
+        {
+            if (sampleRate <= 0.0 || blockSize <= 0 || numChannels <= 0)
+                throw py::value_error("sample_rate, block_size and channels must be positive");
+
+            const std::lock_guard<std::mutex> lock(processLock);
+
+            spec = { sampleRate, (juce::uint32) blockSize, (juce::uint32) numChannels };
+            chain.setPrecision(doublePrecision ? EffectChain::Precision::Double : EffectChain::Precision::Single);
+            chain.setSubBlockSize(subBlockSize);
+            chain.prepare(spec);
+            prepared = true;
+        }
+
+        // YAML, JSON or XML; raises RuntimeError with the loader's message.
+        // fileDirectory, when not empty, is where relative "file:" paths
+        // resolve from now on (relative to the working directory itself).
+        void load(const std::string& source, const std::string& fileDirectory)
+        {
+            juce::Result result = juce::Result::ok();
+
+            if (!fileDirectory.empty())
+                chain.setFileDirectory(juce::File::getCurrentWorkingDirectory().getChildFile(juce::String::fromUTF8(fileDirectory.c_str())));
+
+            {
+                py::gil_scoped_release release;
+                result = chain.loadFromSource(juce::String::fromUTF8(source.c_str()));
+                chain.releaseRetiredGraphs();
+            }
+
+            if (result.failed())
+                throw std::runtime_error(result.getErrorMessage().toStdString());
+        }
+
+        void process(py::array audio, py::object sidechain)
+        {
+            if (!prepared)
+                throw std::runtime_error("call prepare() before process()");
+
+            if (!audio.writeable())
+                throw py::value_error("audio is read-only");
+
+            if (audio.dtype().is(py::dtype::of<double>()))
+                processArray<double>(audio, sidechain);
+            else
+                processArray<float>(audio, sidechain);
+        }
+
+        void reset()
+        {
+            const std::lock_guard<std::mutex> lock(processLock);
+            chain.reset();
+        }
+
+    private:
+        template <typename SampleType>
+        void processArray(const py::array& audio, const py::object& sidechain)
+        {
+            int numSamples = 0;
+            auto channels = getChannelPointers<SampleType>(audio, "audio", numSamples);
+
+            if (channels.size() != (size_t) spec.numChannels)
+                throw py::value_error("audio has " + std::to_string(channels.size()) + " channels but the chain was prepared for "
+                                      + std::to_string(spec.numChannels));
+
+            // Held until processing ends, in case the sidechain had to be converted to an array
+            py::array keyArray;
+            std::vector<const SampleType*> keyChannels;
+
+            if (!sidechain.is_none())
+            {
+                keyArray = py::array::ensure(sidechain);
+                if (!keyArray)
+                    throw py::type_error("sidechain must be a NumPy array");
+
+                int keySamples = 0;
+                for (auto* channel : getChannelPointers<SampleType>(keyArray, "sidechain", keySamples))
+                    keyChannels.push_back(channel);
+
+                if (keySamples < numSamples)
+                    throw py::value_error("sidechain is shorter than audio");
+            }
+
+            py::gil_scoped_release release;
+            const std::lock_guard<std::mutex> lock(processLock);
+
+            // The chain was prepared for blocks of at most spec.maximumBlockSize
+            const auto blockSize = (int) spec.maximumBlockSize;
+            std::vector<SampleType*> blockChannels(channels.size());
+            std::vector<const SampleType*> blockKeys(keyChannels.size());
+            juce::AudioBuffer<SampleType> buffer;
+
+            for (int start = 0; start < numSamples; start += blockSize)
+            {
+                const auto length = juce::jmin(blockSize, numSamples - start);
+
+                for (size_t ch = 0; ch < channels.size(); ++ch)
+                    blockChannels[ch] = channels[ch] + start;
+
+                for (size_t ch = 0; ch < keyChannels.size(); ++ch)
+                    blockKeys[ch] = keyChannels[ch] + start;
+
+                buffer.setDataToReferTo(blockChannels.data(), (int) blockChannels.size(), length);
+
+                juce::dsp::AudioBlock<const SampleType> key;
+                if (!blockKeys.empty())
+                    key = juce::dsp::AudioBlock<const SampleType>(blockKeys.data(), blockKeys.size(), (size_t) length);
+
+                chain.process(buffer, key);
+            }
+        }
+
+        EffectChain chain;
+        juce::dsp::ProcessSpec spec { 48000.0, 512, 2 };
+        bool prepared = false;
+
+        // One process() at a time; load() may run alongside, the chain swaps graphs safely
+        std::mutex processLock;
+    };
+
+    py::dict analyze(const std::string& source, double sampleRate, int blockSize, int numChannels,
+                     bool doublePrecision, int subBlockSize)
+    {
+        PresetAnalyzer::Settings settings;
+        settings.spec = { sampleRate, (juce::uint32) blockSize, (juce::uint32) numChannels };
+        settings.precision = doublePrecision ? EffectChain::Precision::Double : EffectChain::Precision::Single;
+        settings.subBlockSize = subBlockSize;
+
+        PresetAnalyzer::Report report;
+        {
+            py::gil_scoped_release release;
+            report = PresetAnalyzer::analyzeSource(juce::String::fromUTF8(source.c_str()), settings);
+        }
+
+        py::list errors, warnings;
+        for (const auto& issue : report.issues)
+        {
+            const auto text = (issue.path.isNotEmpty() ? issue.path + ": " : juce::String()) + issue.message;
+            (issue.severity == PresetAnalyzer::Issue::Severity::Error ? errors : warnings).append(text.toStdString());
+        }
+
+        py::dict result;
+        result["errors"] = errors;
+        result["warnings"] = warnings;
+        result["num_effects"] = report.numEffects;
+        result["ns_per_sample"] = report.nsPerSample;
+        result["cpu_load"] = report.getCpuLoad(sampleRate);
+        result["memory_bytes"] = report.memoryBytes;
+        return result;
+    }
+}
+
+PYBIND11_MODULE(preset_engine_native, m)
+{
+    m.doc() = "Native PresetEngine effect chain: render presets over NumPy arrays in place";
+
+    py::class_<PyEffectChain>(m, "EffectChain")
+        .def(py::init<>())
+        .def("prepare", &PyEffectChain::prepare,
+             py::arg("sample_rate"), py::arg("block_size") = 512, py::arg("channels") = 2,
+             py::arg("double_precision") = false, py::arg("sub_block_size") = 0,
+             "Sets the processing format. Arrays passed to process() may be any length; they run in blocks of block_size.")
+        .def("load", &PyEffectChain::load, py::arg("source"), py::arg("file_directory") = std::string(),
+             "Loads a YAML, JSON or XML preset. Relative 'file:' paths (impulse responses) resolve against "
+             "file_directory, which is kept for later loads. Raises RuntimeError if it doesn't build.")
+        .def("process", &PyEffectChain::process, py::arg("audio"), py::arg("sidechain") = py::none(),
+             "Processes a float32 or float64 array of shape (channels, samples) in place.")
+        .def("reset", &PyEffectChain::reset, "Clears delay lines, reverb tails and envelopes.");
+
+    m.def("analyze", &analyze,
+          py::arg("source"), py::arg("sample_rate") = 48000.0, py::arg("block_size") = 512, py::arg("channels") = 2,
+          py::arg("double_precision") = false, py::arg("sub_block_size") = 0,
+          "Checks a preset without building it and predicts its CPU load and memory.");
+}
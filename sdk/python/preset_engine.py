@@ -11,18 +11,22 @@ class Effect:
         for k, v in self.params.items():
             if isinstance(v, Parameter):
                 d[k] = v.to_dict()
+            elif isinstance(v, list) and all(isinstance(e, Effect) for e in v):
+                d[k] = [e.to_dict() for e in v]
             else:
                 d[k] = v
         return d
 
 class Parameter:
-    def __init__(self, value, ui=None, style=None, min_val=None, max_val=None, options=None):
+    def __init__(self, value, ui=None, style=None, min_val=None, max_val=None, options=None, mod=None, amount=None):
         self.value = value
         self.ui = ui
         self.style = style
         self.min = min_val
         self.max = max_val
         self.options = options
+        self.mod = mod
+        self.amount = amount
 
     def to_dict(self):
         d = {"value": self.value}
@@ -31,6 +35,8 @@ class Parameter:
         if self.min is not None: d["min"] = self.min
         if self.max is not None: d["max"] = self.max
         if self.options: d["options"] = self.options
+        if self.mod: d["mod"] = self.mod
+        if self.amount is not None: d["amount"] = self.amount
         return d
 
 class Chain:
@@ -47,6 +53,20 @@ class Chain:
     def to_yaml(self):
         return yaml.dump([e.to_dict() for e in self.effects], sort_keys=False)
 
+    def render(self, audio, sample_rate, block_size=512):
+        """Processes a NumPy array of shape (channels, samples) through this chain, in place.
+
+        Needs the native module (build with -DPRESET_ENGINE_PYTHON=ON). For many
+        renders, keep one preset_engine_native.EffectChain and call load() on it.
+        """
+        import preset_engine_native
+        channels = 1 if audio.ndim == 1 else audio.shape[0]
+        engine = preset_engine_native.EffectChain()
+        engine.prepare(sample_rate, block_size, channels)
+        engine.load(self.to_json())
+        engine.process(audio)
+        return audio
+
 # --- Effect Wrappers ---
 
 def Gain(db=0.0, ui=False):
@@ -64,3 +84,16 @@ def Filter(mode="LowPass", freq=1000.0, q=0.7, ui=False):
 
 def Reverb(size=0.5, wet=0.33):
     return Effect("Reverb", room_size=size, wet=wet)
+
+def Modulator(name, source="lfo", rate=1.0, **kwargs):
+    """Control source; route it with Parameter(value, mod=name, amount=...)."""
+    return Effect("Modulator", name=name, source=source, rate=rate, **kwargs)
+
+def Send(bus, level=0.0):
+    """Adds the signal at this point to a named Bus, level in dB."""
+    return Effect("Send", bus=bus, level=level)
+
+def Bus(name, effects, level=0.0, output=None):
+    """Shared effects fed by Send(name); mixed into the output, or into another bus."""
+    kwargs = {"output": output} if output else {}
+    return Effect("Bus", name=name, level=level, children=effects, **kwargs)